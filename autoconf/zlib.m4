@@ -60,4 +60,55 @@ LIBS=$am_save_LIBS
 LDFLAGS=$am_save_LDFLAGS
 
 
+])
+
+dnl AM_LIBDEFLATE
+dnl libdeflate is optional. If requested with --with-libdeflate, it is used
+dnl instead of zlib for compressing requests and decompressing answers.
+AC_DEFUN([AM_LIBDEFLATE],[dnl
+AC_ARG_WITH([libdeflate],
+	[  --with-libdeflate[[=PATH]] Use libdeflate for compression (optional)],
+	[libdeflate_prefix="$withval"],
+	[libdeflate_prefix="no"])
+
+report_have_libdeflate="no"
+if test "$libdeflate_prefix" != "no"
+then
+	AC_MSG_CHECKING([for libdeflate library and headers])
+	am_save_CPPFLAGS="$CPPFLAGS"
+	am_save_LIBS="$LIBS"
+	LIBDEFLATE_LIBS="-ldeflate"
+	LIBDEFLATE_CFLAGS=""
+	if test "$libdeflate_prefix" != "yes"
+	then
+		LIBDEFLATE_LIBS="-L$libdeflate_prefix/lib -ldeflate"
+		LIBDEFLATE_CFLAGS="-I$libdeflate_prefix/include"
+	fi
+	LIBS="$LIBS $LIBDEFLATE_LIBS"
+	CPPFLAGS="$CPPFLAGS $LIBDEFLATE_CFLAGS"
+    AC_LINK_IFELSE(
+      [[
+         #include <libdeflate.h>
+         int main()
+         {
+            struct libdeflate_decompressor *d=libdeflate_alloc_decompressor();
+            libdeflate_free_decompressor(d);
+            return 0;
+         }
+      ]],
+      [AC_MSG_RESULT(yes)
+      AC_DEFINE(HAVE_LIBDEFLATE, 1, [ Define if you have libdeflate. ])
+      ZLIB_LIBS="$ZLIB_LIBS $LIBDEFLATE_LIBS"
+      ZLIB_CFLAGS="$ZLIB_CFLAGS $LIBDEFLATE_CFLAGS"
+      report_have_libdeflate="yes"
+      ],
+      [
+         AC_MSG_RESULT(no)
+         AC_MSG_ERROR([libdeflate library and/or headers not found--see https://github.com/ebiggers/libdeflate])
+      ]
+    )
+	CPPFLAGS=$am_save_CPPFLAGS
+	LIBS=$am_save_LIBS
+fi
+
 ])
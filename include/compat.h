@@ -37,6 +37,59 @@ const char *irislwz_GetSocketError(int code);
 int irislwz_TranslateSocketError();
 int irislwz_TranslateGaiError(int e);
 
+struct sockaddr;
+int irislwz_ConnectAddress(IRISLWZ_HANDLE *handle, const struct sockaddr *addr, int addrlen);
+int irislwz_PoolConnect(IRISLWZ_HANDLE *handle);
+int irislwz_IsConnected(IRISLWZ_HANDLE *handle);
+long long irislwz_GetTime();
+int irislwz_Deflate(IRISLWZ_HANDLE *handle, char *dst, int *dstlen, const char *src, int size);
+int irislwz_DeflatedSize(IRISLWZ_HANDLE *handle, const char *buffer, int size);
+int irislwz_Inflate(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *response);
+void irislwz_FreeCodec(IRISLWZ_HANDLE *handle);
+int irislwz_ParsePacket(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *packet);
+void irislwz_FreeDocument(void *doc);
+void irislwz_ReleasePackets(IRISLWZ_HANDLE *handle);
+int irislwz_QueryPayload(IRISLWZ_HANDLE *handle, const char *payload, int bytes, int validate);
+int irislwz_PipelineSendPayload(IRISLWZ_HANDLE *handle, const char *payload, int bytes, void *privatedata, int validate);
+int dchk_BuildRequest(IRISLWZ_HANDLE *handle, DCHK_RECORD **next, int maxdomainsperquery, char *payload, DCHK_DOMAINLIST *domainset, int *validate);
+int irislwz_ScanPacket(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *packet);
+int dchk_ScanResult(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *domainset);
+int dchk_ScanSize(IRISLWZ_HANDLE *handle);
+int dchk_ScanOther(IRISLWZ_HANDLE *handle, char *type, int typesize, char *desc, int descsize);
+int dchk_IDNA_ToASCII(const char *domain, int len, char *buffer, int buffersize);
+int dchk_DecodeUTF8(const unsigned char **p, const unsigned char *end);
+int dchk_IsUTF8(const char *string, int len);
+int dchk_ValidateRecord(IRISLWZ_HANDLE *handle, DCHK_RECORD *r);
+int irislwz_CopyPool(IRISLWZ_HANDLE *handle, IRISLWZ_HANDLE *source, int resolve);
+struct sockaddr_storage;
+int irislwz_GetServerAddresses(IRISLWZ_HANDLE *handle, int index, const struct sockaddr_storage **addr, const int **addrlen);
+int irislwz_SetServerAddresses(IRISLWZ_HANDLE *handle, int index, const struct sockaddr_storage *addr, const int *addrlen, int num);
+void irislwz_CopySettings(IRISLWZ_HANDLE *handle, IRISLWZ_HANDLE *source);
+void irislwz_FreeString(IRISLWZ_HANDLE *handle, char *string);
+void irislwz_MovePackets(IRISLWZ_HANDLE *handle, IRISLWZ_HANDLE *source);
+const char *irislwz_GetAuthorityOfDomain(IRISLWZ_HANDLE *handle, const char *domain);
+int dchk_SetRouteServers(IRISLWZ_HANDLE *handle, DCHK_ROUTES *routes, int route);
+int dchk_GetCachedServers(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, const char *tld);
+void dchk_CacheServers(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, const char *tld, const char *replacement, int ttl);
+void dchk_CacheFailure(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, const char *tld);
+DCHK_ROUTES *dchk_RetainRoutes(DCHK_ROUTES *routes);
+DCHK_DNSCACHE *dchk_RetainDNSCache(DCHK_DNSCACHE *cache);
+
+/*
+ * Reference counters are changed by atomic operations, so shared objects can be used and
+ * released by multiple threads at the same time.
+ */
+#ifdef _WIN32
+	#define irislwz_AtomicIncrement(p)	InterlockedIncrement(p)
+	#define irislwz_AtomicDecrement(p)	InterlockedDecrement(p)
+#elif defined(__GNUC__)
+	#define irislwz_AtomicIncrement(p)	__sync_add_and_fetch(p,1)
+	#define irislwz_AtomicDecrement(p)	__sync_sub_and_fetch(p,1)
+#else
+	#define irislwz_AtomicIncrement(p)	(++(*(p)))
+	#define irislwz_AtomicDecrement(p)	(--(*(p)))
+#endif
+
 
 #ifndef HAVE_STRNDUP
 char *strndup(const char *str, size_t len);
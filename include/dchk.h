@@ -36,6 +36,19 @@
 #define DCHK_VERSION_MINOR	5
 #define DCHK_VERSION_BUILD	8
 
+#define IRISLWZ_RTT_HISTORY	32			// Number of round trip times kept for hedged requests
+
+// Compression policies for irislwz_SetCompression
+#define IRISLWZ_COMPRESSION_OFF		0
+#define IRISLWZ_COMPRESSION_ALWAYS	1
+#define IRISLWZ_COMPRESSION_AUTO	2
+
+// Retention policies for irislwz_SetRetention
+#define IRISLWZ_RETAIN_NONE			0
+#define IRISLWZ_RETAIN_REQUEST		1
+#define IRISLWZ_RETAIN_RESPONSE		2
+#define IRISLWZ_RETAIN_ALL			3
+
 
 #include <stdarg.h>
 
@@ -63,6 +76,9 @@ typedef struct {
 	char *uncompressed_payload;
 	int size_uncompressed;
 	char *beautified;
+	char shared;
+	char scanned;
+	void *doc;
 } IRISLWZ_PACKET;
 
 
@@ -96,6 +112,31 @@ typedef struct {
 	int test_tid;
 	int test_authlen;
 	int test_truncate;
+	int window;
+	int batch;
+	void *pipeline;
+	unsigned short lasttid;
+	int retries;
+	int srtt, rttvar, rto;
+	int hedge;
+	int rtthistory[IRISLWZ_RTT_HISTORY];
+	int rtthistorycount;
+	void *pool;
+	char *rxbuffer;
+	int rxbuffersize;
+	int deflateLevel;
+	int deflateStrategy;
+	int deflateThreshold;
+	char *inflatebuffer;
+	int inflatebuffersize;
+	int maxInflateRatio;
+	void *codec;
+	char retain;
+	char idnToASCII;
+	char localValidation;
+	void *config;
+	void *routes;
+	void *dnscache;
 
 } IRISLWZ_HANDLE;
 
@@ -105,6 +146,7 @@ typedef struct __dchk_record {
 	char *domain;
 	char *lastdatabaseupdate;
 	char *status;
+	char checkedLocally;
 } DCHK_RECORD;
 
 typedef struct {
@@ -112,6 +154,19 @@ typedef struct {
 	int num;
 } DCHK_DOMAINLIST;
 
+typedef struct {
+	IRISLWZ_HANDLE *handle;
+	void *queue;
+	void *privatedata;
+	int pollfd;
+	int pending;
+	int maxdomainsperquery;
+} DCHK_ENGINE;
+
+typedef struct __irislwz_config DCHK_CONFIG;
+typedef struct __dchk_routes DCHK_ROUTES;
+typedef struct __dchk_dnscache DCHK_DNSCACHE;
+
 // IRISLWZ
 
 const char *irislwz_GetVersion();
@@ -120,6 +175,7 @@ const char *irislwz_GetReleaseDate();
 int irislwz_CheckMinVersion (int major, int minor, int build);
 
 int irislwz_InitWSA();
+int irislwz_InitLibrary();
 int irislwz_Init(IRISLWZ_HANDLE *handle);
 int irislwz_Exit(IRISLWZ_HANDLE *handle);
 int irislwz_UseRFC1950(IRISLWZ_HANDLE *handle, int flag);
@@ -133,6 +189,10 @@ const char *irislwz_GetHostname(IRISLWZ_HANDLE *handle);
 int irislwz_GetPort(IRISLWZ_HANDLE *handle);
 int irislwz_AcceptDeflated(IRISLWZ_HANDLE *handle, int flag);
 int irislwz_SendDeflated(IRISLWZ_HANDLE *handle, int flag);
+int irislwz_SetCompression(IRISLWZ_HANDLE *handle, int mode, int level, int strategy);
+int irislwz_SetCompressionThreshold(IRISLWZ_HANDLE *handle, int bytes);
+int irislwz_SetMaxInflateRatio(IRISLWZ_HANDLE *handle, int ratio);
+int irislwz_SetRetention(IRISLWZ_HANDLE *handle, int flags);
 int irislwz_IgnoreInvalidXML(IRISLWZ_HANDLE *handle, int flag);
 int irislwz_Connect(IRISLWZ_HANDLE *handle);
 int irislwz_Disconnect(IRISLWZ_HANDLE *handle);
@@ -142,6 +202,7 @@ void irislwz_Debug(IRISLWZ_HANDLE *handle, int level, const char *fmt, ...);
 int irislwz_Talk(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *request, IRISLWZ_PACKET *response);
 int irislwz_QueryVersion(IRISLWZ_HANDLE *handle);
 int irislwz_Validate(IRISLWZ_HANDLE *handle, const char *xml, char **beautified);
+const char *irislwz_GetBeautified(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *packet);
 void irislwz_FreePacket(IRISLWZ_PACKET *p);
 int irislwz_PrepareQuery(IRISLWZ_HANDLE *handle);
 int irislwz_GetCompressedSize(const char *buffer, int size, int rfc1950);
@@ -157,10 +218,45 @@ int irislwz_TestSetAuthorityLength(IRISLWZ_HANDLE *handle, int bytes);
 int irislwz_TestCorruptCompression(IRISLWZ_HANDLE *handle, int flag);
 int irislwz_TestCleanup(IRISLWZ_HANDLE *handle);
 int irislwz_CheckResponse(IRISLWZ_HANDLE *handle);
+int irislwz_SetWindow(IRISLWZ_HANDLE *handle, int requests);
+int irislwz_SetBatchSize(IRISLWZ_HANDLE *handle, int packets);
+int irislwz_SetRetries(IRISLWZ_HANDLE *handle, int retries);
+int irislwz_GetRTO(IRISLWZ_HANDLE *handle);
+int irislwz_SetHedging(IRISLWZ_HANDLE *handle, int percentile);
+int irislwz_PipelineSend(IRISLWZ_HANDLE *handle, const char *payload, int bytes, void *privatedata);
+int irislwz_PipelineFlush(IRISLWZ_HANDLE *handle);
+int irislwz_PipelineReceive(IRISLWZ_HANDLE *handle, void **privatedata);
+int irislwz_PipelineOutstanding(IRISLWZ_HANDLE *handle);
+void irislwz_PipelineReset(IRISLWZ_HANDLE *handle);
+int irislwz_PipelinePoll(IRISLWZ_HANDLE *handle, void **privatedata);
+int irislwz_PipelineExpire(IRISLWZ_HANDLE *handle, void **privatedata);
+int irislwz_PipelineCancel(IRISLWZ_HANDLE *handle, void **privatedata);
+int irislwz_PipelineNextTimeout(IRISLWZ_HANDLE *handle);
+int irislwz_GetSocket(IRISLWZ_HANDLE *handle);
+int irislwz_CloneHandle(IRISLWZ_HANDLE *handle, IRISLWZ_HANDLE *source);
+DCHK_CONFIG *irislwz_NewConfig(IRISLWZ_HANDLE *handle);
+DCHK_CONFIG *irislwz_RetainConfig(DCHK_CONFIG *config);
+void irislwz_ReleaseConfig(DCHK_CONFIG *config);
+int irislwz_InitFromConfig(IRISLWZ_HANDLE *handle, DCHK_CONFIG *config);
+int irislwz_AddServer(IRISLWZ_HANDLE *handle, const char *host, int port, int priority, int weight);
+void irislwz_ClearServers(IRISLWZ_HANDLE *handle);
+int irislwz_GetServerCount(IRISLWZ_HANDLE *handle);
+int irislwz_GetServer(IRISLWZ_HANDLE *handle, int index, const char **host, int *port, int *priority, int *weight);
+int irislwz_SelectServer(IRISLWZ_HANDLE *handle);
+void irislwz_ServerFailed(IRISLWZ_HANDLE *handle);
 
 // DCHK
 int dchk_SetHostByDNS(IRISLWZ_HANDLE *handle, const char *tld);
+DCHK_DNSCACHE *dchk_NewDNSCache();
+void dchk_FreeDNSCache(DCHK_DNSCACHE *cache);
+int dchk_SetDNSCacheNegativeTTL(DCHK_DNSCACHE *cache, int seconds);
+int dchk_SetDNSCache(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache);
+int dchk_LoadDNSCache(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, const char *filename);
+int dchk_SaveDNSCache(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, const char *filename);
 int dchk_QueryDomainList(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list, int maxdomainsperquery);
+int dchk_QueryDomainListStriped(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list, int maxdomainsperquery);
+int dchk_QueryDomainListParallel(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list, int maxdomainsperquery, int threads);
+int dchk_QueryDomainListByAuthority(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list, int maxdomainsperquery, int threads);
 int dchk_QueryDomain(IRISLWZ_HANDLE *handle, const char *domain, char **status, char **dbupdate);
 int dchk_XML_ParseResult(IRISLWZ_HANDLE *handle,DCHK_DOMAINLIST *domainset);
 int dchk_XML_ParseDomain(IRISLWZ_HANDLE *handle, void *node, DCHK_RECORD *r);
@@ -173,6 +269,35 @@ int dchk_AddnDomain(DCHK_DOMAINLIST *list, const char *domain, int n);
 int dchk_ExplodeDomain(DCHK_DOMAINLIST *list, const char *string,const char *delimiter);
 int dchk_PrintResults(DCHK_DOMAINLIST *list);
 int dchk_EscapeSpecialChars(const char *string, char *buffer, int buffersize);
+int dchk_BuildBundle(IRISLWZ_HANDLE *handle, DCHK_RECORD **next, int maxdomainsperquery, char *payload, DCHK_DOMAINLIST *domainset);
+int dchk_ToASCII(IRISLWZ_HANDLE *handle, const char *domain, char *buffer, int buffersize);
+int dchk_SetIDNConversion(IRISLWZ_HANDLE *handle, int flag);
+int dchk_SetLocalValidation(IRISLWZ_HANDLE *handle, int flag);
+int dchk_ValidateDomainList(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list);
+DCHK_ROUTES *dchk_NewRoutes();
+void dchk_FreeRoutes(DCHK_ROUTES *routes);
+int dchk_AddRoute(DCHK_ROUTES *routes, const char *suffix, const char *authority, const char *servers);
+int dchk_LoadRoutes(IRISLWZ_HANDLE *handle, DCHK_ROUTES *routes, const char *filename);
+int dchk_SetRoutes(IRISLWZ_HANDLE *handle, DCHK_ROUTES *routes);
+int dchk_FindRoute(DCHK_ROUTES *routes, const char *domain);
+int dchk_GetRouteCount(DCHK_ROUTES *routes);
+const char *dchk_GetRouteAuthority(DCHK_ROUTES *routes, int route);
+
+// DCHK Engine
+int dchk_engine_Init(DCHK_ENGINE *engine, IRISLWZ_HANDLE *handle);
+int dchk_engine_Exit(DCHK_ENGINE *engine);
+void dchk_engine_Cancel(DCHK_ENGINE *engine);
+void dchk_engine_SetMaxDomainsPerQuery(DCHK_ENGINE *engine, int count);
+int dchk_engine_SubmitDomain(DCHK_ENGINE *engine, const char *domain,
+		void (*callback)(DCHK_ENGINE *engine, DCHK_RECORD *record, int error, void *privatedata),
+		void *privatedata);
+int dchk_engine_SubmitPayload(DCHK_ENGINE *engine, const char *payload, int bytes,
+		void (*callback)(DCHK_ENGINE *engine, IRISLWZ_HANDLE *handle, int error, void *privatedata),
+		void *privatedata);
+int dchk_engine_Run(DCHK_ENGINE *engine, int timeout);
+int dchk_engine_Pending(DCHK_ENGINE *engine);
+int dchk_engine_GetFd(DCHK_ENGINE *engine);
+int dchk_engine_NextTimeout(DCHK_ENGINE *engine);
 
 // Error handling
 const char *irislwz_GetError(int code);
@@ -251,6 +376,7 @@ class CIrisLWZ : public CError
 		//!\name Constructures and Destructures
 		//@{
 		CIrisLWZ();
+		CIrisLWZ(DCHK_CONFIG *config);
 		~CIrisLWZ();
 		//@}
 
@@ -263,14 +389,28 @@ class CIrisLWZ : public CError
 		int		SetMaximumResponseLength(int bytes);
 		int		AcceptDeflated(int flag);
 		int		SendDeflated(int flag);
+		int		SetCompression(int mode, int level=9, int strategy=0);
+		int		SetCompressionThreshold(int bytes);
+		int		SetMaxInflateRatio(int ratio);
+		int		SetRetention(int flags);
 		int		IgnoreInvalidXML(int flag);
 		int		UseRFC1950(int flag);
+		int		SetWindow(int requests);
+		int		SetBatchSize(int packets);
+		int		SetRetries(int retries);
+		int		GetRTO();
+		int		SetHedging(int percentile);
 		void	SetDebugLevel(int level);
 		void	SetDebugHandler(void (*DebugHandler)(int, const char *, void *), void *privatedata);
+		DCHK_CONFIG *NewConfig();
 		//@}
 		//!\name CIrisLWZ Connection
 		//@{
 		int		SetHost(const char *host, int port=715);
+		int		AddServer(const char *host, int port=715, int priority=0, int weight=0);
+		void	ClearServers();
+		int		GetServerCount();
+		int		SelectServer();
 		int		Connect();
 		int		Disconnect();
 		const char *GetHostname();
@@ -290,6 +430,7 @@ class CIrisLWZ : public CError
 		//!\name CIrisLWZ Tools
 		//@{
 		int		Validate(const char *xml, char **beautified);
+		const char *GetBeautified(IRISLWZ_PACKET *p=NULL);
 		int		GetCompressedSize(const char *buffer, int size);
 		//@}
 
@@ -332,21 +473,70 @@ class CDchk : public CIrisLWZ
 		//!\name Constructures and Destructures
 		//@{
 		CDchk();
+		CDchk(DCHK_CONFIG *config);
 		~CDchk();
 		//@}
 		//!\name CDchk Options
 		//@{
 		int		SetHostByDNS(const char *tld);
 		void	SetMaxDomainsPerQuery(int count);
+		int		SetIDNConversion(int flag);
+		int		SetLocalValidation(int flag);
+		int		SetRoutes(DCHK_ROUTES *routes);
+		int		SetDNSCache(DCHK_DNSCACHE *cache);
+		//@}
+		//!\name CDchk Helper
+		//@{
+		int		ToASCII(const char *domain, char *buffer, int buffersize);
+		int		ValidateDomainList(CDomainList &list);
 		//@}
 		//!\name CDchk Queries
 		//@{
 		int		QueryDomainList(CDomainList &list);
+		int		QueryDomainListStriped(CDomainList &list);
+		int		QueryDomainListParallel(CDomainList &list, int threads);
+		int		QueryDomainListByAuthority(CDomainList &list, int threads=0);
 		int		QueryDomain(const char *domain, char **status, char **dbupdate);
 		int		PrintResults(CDomainList &list);
 		//@}
 };
 
+class CEngine : public CError
+{
+	private:
+		DCHK_ENGINE engine;
+		static void DomainCallback(DCHK_ENGINE *engine, DCHK_RECORD *record, int error, void *privatedata);
+		static void PayloadCallback(DCHK_ENGINE *engine, IRISLWZ_HANDLE *handle, int error, void *privatedata);
+
+	public:
+		//!\name Constructures and Destructures
+		//@{
+		CEngine();
+		virtual ~CEngine();
+		//@}
+		//!\name CEngine Setup
+		//@{
+		int		Init(CIrisLWZ &lwz);
+		int		Exit();
+		void	SetMaxDomainsPerQuery(int count);
+		//@}
+		//!\name CEngine Queries
+		//@{
+		int		SubmitDomain(const char *domain, void *privatedata=NULL);
+		int		SubmitPayload(const char *payload, int bytes, void *privatedata=NULL);
+		int		Run(int timeout=-1);
+		void	Cancel();
+		int		Pending();
+		int		GetFd();
+		int		NextTimeout();
+		//@}
+		//!\name CEngine Callbacks
+		//@{
+		virtual void OnDomain(DCHK_RECORD *record, int error, void *privatedata);
+		virtual void OnPayload(IRISLWZ_PACKET *response, int error, void *privatedata);
+		//@}
+};
+
 
 } // EOF namespace dchk
 
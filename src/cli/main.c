@@ -96,6 +96,9 @@ NULL
 
 int Execute(int argc, char **argv, IRISLWZ_HANDLE *dchk);
 
+static DCHK_ROUTES *routes=NULL;
+static DCHK_DNSCACHE *dnscache=NULL;
+
 void help()
 {
 	int i;
@@ -112,7 +115,8 @@ void help()
 		"Release date: %s\n\n"
 		"Syntax: dchk [-hpastv] Domain Domain Domain ...\n"
 		"\n"
-		"     -h HOST      Hostname or IP of DCHK-Server (default=DNS lookup)\n"
+		"     -h HOST      Hostname or IP of DCHK-Server (default=DNS lookup). Several\n"
+		"                  hosts separated by comma are used as a server pool\n"
 		"     -p PORT      Port of DCHK-Server (Default=DNS lookup or port 715)\n"
 		"     -a AUTHORITY Authority (Default=TLD)\n"
 		"     -t TLD       TLD to query, only used when no hostname is given (default=de)\n"
@@ -126,12 +130,39 @@ void help()
 		"     --md #       Set maximum number of domains per DCHK query (default=20)\n"
 		"     --dac        Dont't accept compressed answers (default=accept)\n"
 		"     --sc         Send compressed requests (default=uncompressed)\n"
+		"     --compress M Compression of requests: off, always or auto (compress\n"
+		"                  only if the request gets smaller)\n"
+		"     --level #    Compression level between 0 and 9 (default=9)\n"
 		"     --timeout #  Timeout for DCHK requests in seconds (default=5, 0=none)\n"
+		"     --retries #  Number of retransmissions of unanswered requests\n"
+		"                  (default=3, 0=none)\n"
+		"     --hedge #    Send a copy of a request, if the answer takes longer than\n"
+		"                  the #th percentile of recent round trip times (1-99)\n"
+		"     --window #   Maximum number of requests sent to the server without\n"
+		"                  waiting for the answer (default=1)\n"
+		"     --batch #    Send and receive up to # packets with a single system\n"
+		"                  call, only used with --window (default=1)\n"
+		"     --stripe     Send the requests in parallel to all servers of the pool\n"
+		"     --threads #  Query the domains with # threads, each with its own\n"
+		"                  connection (default=1)\n"
+		"     --idna       Send internationalized domain names in their ASCII form\n"
+		"                  (xn--...) instead of UTF-8\n"
+		"     --precheck   Check the syntax of the domain names locally and don't\n"
+		"                  send invalid names to the server\n"
+		"     --cache F    Keep the DCHK servers found in DNS in file F and use\n"
+		"                  them as long as the DNS records are valid\n"
+		"     --routes F   Read the authorities and optionally their servers from\n"
+		"                  file F, one line per domain suffix: SUFFIX [AUTHORITY\n"
+		"                  [HOST[:PORT] ...]]. Domains are grouped by these routes\n"
 		"     Domain       Domain names which should be checked. If you use the\n"
 		"                  word \"version\" instead of a domain name, a version\n"
 		"                  query will be send to the server. You must use the -t or\n"
 		"                  the -h and -p flags in conjunction with this\n"
-		"     --fs         Check all TLDs for DCHK server\n"
+		"                  Domains of different TLDs are checked concurrently, each\n"
+		"                  with its own authority and server, unless -a or -t is\n"
+		"                  given\n"
+		"     --fs         Check all TLDs or all authorities of --routes for DCHK\n"
+		"                  server\n"
 		"     --rfc1950    Use RFC 1950 for compression instead of RFC 1951\n"
 
 		"", DCHK_RELEASEDATE);
@@ -225,15 +256,14 @@ int main(int argc, char **argv)
 	setlocale(LC_ALL,  "" );
 #endif
 #ifdef _WIN32
-	irislwz_InitWSA();
 #define strcasecmp _stricmp
 #endif
+	irislwz_InitLibrary();
 
 	if (!irislwz_Init(&handle)) {
 		printf ("Error: could not initialize DCHK client\n");
 		return 74028;
 	}
-	xmlInitParser();
 	/*
 	const char *bfff[100];
 	int lfff=100;
@@ -248,25 +278,51 @@ int main(int argc, char **argv)
 		ret=irislwz_GetErrorCode(&handle);
 		irislwz_PrintError(&handle);
 	}
+	// The discovery cache is saved even if the query failed, so failed lookups are cached, too
+	const char *cachefile=getargv(argc,argv,"--cache");
+	if (dnscache && cachefile && !dchk_SaveDNSCache(&handle,dnscache,cachefile)) {
+		if (!ret) ret=irislwz_GetErrorCode(&handle);
+		irislwz_PrintError(&handle);
+	}
 	xmlCleanupParser();
 	irislwz_Exit(&handle);
+	dchk_FreeRoutes(routes);
+	dchk_FreeDNSCache(dnscache);
 	return ret;
 }
 
+static int CheckServer(IRISLWZ_HANDLE *handle, const char *tld)
+{
+	printf ("checking \".%s\"... ",tld);
+	if (dchk_SetHostByDNS(handle,tld)) {
+		printf ("Server found: %s:%i",irislwz_GetHostname(handle),irislwz_GetPort(handle));
+		if (irislwz_GetServerCount(handle)>1) printf (" (%i servers)",irislwz_GetServerCount(handle));
+		printf ("\n");
+		return 1;
+	}
+	printf ("failed\n");
+	return 0;
+}
+
 void FindServer(IRISLWZ_HANDLE *handle)
 {
 	printf("Try to find DCHK-server...\n");
-	int i=0;
+	int i=0, j;
 	int found=0;
-	while (tlds[i]!=NULL) {
-		printf ("checking \".%s\"... ",tlds[i]);
-		if (dchk_SetHostByDNS(handle,tlds[i])) {
-			printf ("Server found: %s:%i\n",irislwz_GetHostname(handle),irislwz_GetPort(handle));
-			found ++;
-		} else {
-			printf ("failed\n");
+	if (routes) {
+		// Every authority of the routing table is checked once
+		for (i=0;i<dchk_GetRouteCount(routes);i++) {
+			const char *authority=dchk_GetRouteAuthority(routes,i);
+			for (j=0;j<i;j++) {
+				if (strcasecmp(authority,dchk_GetRouteAuthority(routes,j))==0) break;
+			}
+			if (j==i) found+=CheckServer(handle,authority);
+		}
+	} else {
+		while (tlds[i]!=NULL) {
+			found+=CheckServer(handle,tlds[i]);
+			i++;
 		}
-		i++;
 	}
 	printf ("\n%i DCHK server found\n",found);
 
@@ -284,6 +340,16 @@ int Execute(int argc, char **argv, IRISLWZ_HANDLE *handle)
 	const char *timeout=getargv(argc, argv, "--timeout");
 	if (timeout) irislwz_SetTimeout(handle,myatoi(timeout),0);
 	else irislwz_SetTimeout(handle,5,0);
+	const char *retries=getargv(argc, argv, "--retries");
+	if (retries && !irislwz_SetRetries(handle,myatoi(retries))) {
+		irislwz_PrintError(handle);
+		return 0;
+	}
+	int hedge=myatoi(getargv(argc, argv, "--hedge"));
+	if (hedge>0 && !irislwz_SetHedging(handle,hedge)) {
+		irislwz_PrintError(handle);
+		return 0;
+	}
 
 	if (getargv(argc, argv, "--ex")) {
 		if (getargv(argc, argv, "-V")) handle->verboseflag=54;
@@ -292,6 +358,8 @@ int Execute(int argc, char **argv, IRISLWZ_HANDLE *handle)
 		if (getargv(argc, argv, "-V")) handle->verboseflag=45;
 		else if (getargv(argc, argv, "-v")) handle->verboseflag=9;
 	}
+	// The packets are not needed after the results are parsed
+	irislwz_SetRetention(handle,IRISLWZ_RETAIN_NONE);
 
 
 	int packetsize=myatoi(getargv(argc, argv, "--ps"));
@@ -300,13 +368,65 @@ int Execute(int argc, char **argv, IRISLWZ_HANDLE *handle)
 
 	int maxdomains=myatoi(getargv(argc, argv, "--md"));
 
-	if (getargv(argc, argv, "--rfc1950")) irislwz_UseRFC1950(handle,1);
+	int window=myatoi(getargv(argc, argv, "--window"));
+	if (window>0 && !irislwz_SetWindow(handle,window)) {
+		irislwz_PrintError(handle);
+		return 0;
+	}
+	int threads=myatoi(getargv(argc, argv, "--threads"));
+	int batch=myatoi(getargv(argc, argv, "--batch"));
+	if (batch>0 && !irislwz_SetBatchSize(handle,batch)) {
+		irislwz_PrintError(handle);
+		return 0;
+	}
 
-	if (getargv(argc, argv, "--sc")) irislwz_SendDeflated(handle,1);
-	else irislwz_SendDeflated(handle,0);
+	if (getargv(argc, argv, "--rfc1950")) irislwz_UseRFC1950(handle,1);
+	if (getargv(argc, argv, "--idna")) dchk_SetIDNConversion(handle,1);
+
+	int compression=IRISLWZ_COMPRESSION_OFF;
+	if (getargv(argc, argv, "--sc")) compression=IRISLWZ_COMPRESSION_ALWAYS;
+	const char *mode=getargv(argc, argv, "--compress");
+	if (mode) {
+		if (strcasecmp(mode,"off")==0) compression=IRISLWZ_COMPRESSION_OFF;
+		else if (strcasecmp(mode,"always")==0) compression=IRISLWZ_COMPRESSION_ALWAYS;
+		else if (strcasecmp(mode,"auto")==0) compression=IRISLWZ_COMPRESSION_AUTO;
+		else {
+			irislwz_SetError(handle,74065,"--compress %s",mode);
+			irislwz_PrintError(handle);
+			return 0;
+		}
+	}
+	const char *level=getargv(argc, argv, "--level");
+	if (!irislwz_SetCompression(handle,compression,level ? myatoi(level) : 9,0)) {
+		irislwz_PrintError(handle);
+		return 0;
+	}
 	if (getargv(argc, argv, "--dac")) irislwz_AcceptDeflated(handle,0);
 	else irislwz_AcceptDeflated(handle,1);
 
+	const char *cachefile=getargv(argc, argv, "--cache");
+	if (cachefile) {
+		dnscache=dchk_NewDNSCache();
+		if (!dnscache) {
+			irislwz_SetError(handle,74024,NULL);
+			return 0;
+		}
+		// A damaged cache file is not fatal, it is replaced when the cache is saved
+		if (!dchk_LoadDNSCache(handle,dnscache,cachefile)) irislwz_PrintError(handle);
+		dchk_SetDNSCache(handle,dnscache);
+	}
+
+	const char *routesfile=getargv(argc, argv, "--routes");
+	if (routesfile) {
+		routes=dchk_NewRoutes();
+		if (!routes) {
+			irislwz_SetError(handle,74024,NULL);
+			return 0;
+		}
+		if (!dchk_LoadRoutes(handle,routes,routesfile)) return 0;
+		if (!dchk_SetRoutes(handle,routes)) return 0;
+	}
+
 
 	const char *authority=getargv(argc, argv, "-a");
 
@@ -318,6 +438,7 @@ int Execute(int argc, char **argv, IRISLWZ_HANDLE *handle)
 	// find first parameter, which is not an option
 	int first=0;
 	int i;
+	int routed=0;
 	DCHK_DOMAINLIST *query=NULL;
 
 	if (!inputfile) {
@@ -333,8 +454,20 @@ int Execute(int argc, char **argv, IRISLWZ_HANDLE *handle)
 				} else if (mystrncasecmp(argv[i], "--ps",4)==0
 						|| mystrncasecmp(argv[i], "--md",4)==0) {
 					if (strlen(argv[i])==4)	i++;
-				} else if (mystrncasecmp(argv[i], "--timeout",9)==0) {
+				} else if (mystrncasecmp(argv[i], "--timeout",9)==0
+						|| mystrncasecmp(argv[i], "--retries",9)==0
+						|| mystrncasecmp(argv[i], "--threads",9)==0) {
 					if (strlen(argv[i])==9)	i++;
+				} else if (mystrncasecmp(argv[i], "--window",8)==0
+						|| mystrncasecmp(argv[i], "--routes",8)==0) {
+					if (strlen(argv[i])==8)	i++;
+				} else if (mystrncasecmp(argv[i], "--batch",7)==0
+						|| mystrncasecmp(argv[i], "--cache",7)==0
+						|| mystrncasecmp(argv[i], "--hedge",7)==0
+						|| mystrncasecmp(argv[i], "--level",7)==0) {
+					if (strlen(argv[i])==7)	i++;
+				} else if (mystrncasecmp(argv[i], "--compress",10)==0) {
+					if (strlen(argv[i])==10)	i++;
 				}
 			}
 			else {
@@ -370,6 +503,18 @@ int Execute(int argc, char **argv, IRISLWZ_HANDLE *handle)
 		}
 
 
+		// Domains of different TLDs or of a routing table are grouped by authority and sent
+		// to their own servers, unless the TLD or the authority is given
+		if (!tld && !authority && strcasecmp(query->first->domain,"version")!=0) {
+			const char *t=strrchr(query->first->domain,'.');
+			if (routes) routed=1;
+			DCHK_RECORD *r;
+			for (r=query->first->next;r!=NULL && !routed;r=r->next) {
+				const char *rt=strrchr(r->domain,'.');
+				if ((t==NULL)!=(rt==NULL) || (t && strcasecmp(t,rt)!=0)) routed=1;
+			}
+		}
+
 		// If no TLD is given, use TLD of first domain in list
 		if ((!tld) && query->num>0) {
 			tld=strrchr(query->first->domain,'.');		// Find last occurrance of '.'
@@ -381,7 +526,28 @@ int Execute(int argc, char **argv, IRISLWZ_HANDLE *handle)
 
 	// If no hostname is given, we try to find one in the DNS zone of the TLD
 	if (!host) {
-		if (!dchk_SetHostByDNS(handle,tld)) {
+		// Routed queries find the servers for each authority
+		if (!routed && !dchk_SetHostByDNS(handle,tld)) {
+			dchk_FreeDomainList(query);
+			return 0;
+		}
+	} else if (strchr(host,',')) {
+		// Several hosts are added to the server pool
+		char *hosts=strdup(host);
+		char *h=hosts, *comma;
+		irislwz_ClearServers(handle);
+		while (h) {
+			comma=strchr(h,',');
+			if (comma) *comma=0;
+			if (h[0]!=0 && !irislwz_AddServer(handle,h,myatoi(port),0,0)) {
+				free(hosts);
+				dchk_FreeDomainList(query);
+				return 0;
+			}
+			h=comma ? comma+1 : NULL;
+		}
+		free(hosts);
+		if (!irislwz_SelectServer(handle)) {
 			dchk_FreeDomainList(query);
 			return 0;
 		}
@@ -392,7 +558,7 @@ int Execute(int argc, char **argv, IRISLWZ_HANDLE *handle)
 	// If no authority is given, use the tld of the first domain in list
 	if (authority) irislwz_SetAuthority(handle,authority);
 	else if (inputfile) irislwz_SetAuthority(handle,tld);
-	else {
+	else if (!routed) {
 		if (!irislwz_SetAuthorityByDomainList(handle,query)) {
 			dchk_FreeDomainList(query);
 			return 0;
@@ -401,7 +567,7 @@ int Execute(int argc, char **argv, IRISLWZ_HANDLE *handle)
 
 
 	//printf ("Using DCHK server: %s:%i\n",dchk_GetHostname(dchk), dchk_GetPort(dchk));
-	if (!irislwz_Connect(handle)) {
+	if (!routed && !irislwz_Connect(handle)) {
 		dchk_FreeDomainList(query);
 		return 0;
 	}
@@ -446,9 +612,25 @@ int Execute(int argc, char **argv, IRISLWZ_HANDLE *handle)
 			dchk_FreeDomainList(query);
 			return 0;
 		}
-		printf("%s",handle->response.beautified);
+		const char *beautified=irislwz_GetBeautified(handle,&handle->response);
+		if (beautified) printf("%s",beautified);
 	} else {
-		if (!dchk_QueryDomainList(handle,query,maxdomains)) {
+		if (getargv(argc, argv, "--precheck")) {
+			int invalid=dchk_ValidateDomainList(handle,query);
+			if (handle->verboseflag&63) printf("[Precheck]\n%i of %i domains are invalid and not sent\n",invalid,query->num);
+		}
+		if (routed) {
+			// The domains of the groups, which could be checked, are printed anyway
+			ret=dchk_QueryDomainListByAuthority(handle,query,maxdomains,threads>1 ? threads : 0);
+			if (handle->verboseflag&63) printf("[Result]\n");
+			dchk_PrintResults(query);
+			dchk_FreeDomainList(query);
+			return ret;
+		}
+		if (threads>1) ret=dchk_QueryDomainListParallel(handle,query,maxdomains,threads);
+		else if (getargv(argc, argv, "--stripe")) ret=dchk_QueryDomainListStriped(handle,query,maxdomains);
+		else ret=dchk_QueryDomainList(handle,query,maxdomains);
+		if (!ret) {
 			dchk_FreeDomainList(query);
 			return 0;
 		}
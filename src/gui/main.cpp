@@ -37,8 +37,8 @@ int main(int argc, char *argv[])
     QTextCodec::setCodecForTr(QTextCodec::codecForName("UTF-8"));
     QTextCodec::setCodecForCStrings(QTextCodec::codecForName("UTF-8"));
 
-    // Initialize Windows sockets
-    irislwz_InitWSA();
+    // Initialize Windows sockets and libxml2
+    irislwz_InitLibrary();
 
     qdchk w;
     w.show();
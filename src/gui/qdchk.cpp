@@ -78,6 +78,20 @@ void HexDump(QString &target, char *address, size_t bytes)
 
 }
 
+bool HasDifferentTLDs(dchk::CDomainList &list)
+{
+	DCHK_RECORD *first=list.GetFirst();
+	DCHK_RECORD *row;
+	if (!first) return false;
+	const char *tld=strrchr(first->domain,'.');
+	while ((row=list.GetNext())) {
+		const char *t=strrchr(row->domain,'.');
+		if ((tld==NULL)!=(t==NULL)) return true;
+		if (tld && qstricmp(tld,t)!=0) return true;
+	}
+	return false;
+}
+
 qdchk::qdchk(QWidget *parent)
     : QDialog(parent)
 {
@@ -126,7 +140,12 @@ void qdchk::on_start_clicked()
 		list.AddDomain(dl.at(i).toUtf8().constData());
 
 
-	if (ui.useDNS->isChecked()) {
+	// Domains of different TLDs are grouped by authority and each group is sent to its own server
+	bool routed=(ui.authority_automatic->isChecked() && HasDifferentTLDs(list));
+
+	if (routed && ui.useDNS->isChecked()) {
+		// The server of each authority is found by DNS
+	} else if (ui.useDNS->isChecked()) {
 		// We use the first domain in list to get the TLD
 		DCHK_RECORD *d=list.GetFirst();
 		const char *tld=strrchr(d->domain,'.');		// Find last occurrance of '.'
@@ -169,7 +188,9 @@ void qdchk::on_start_clicked()
 	dchk.SendDeflated(sc);
 
 	// Set Authority
-	if (ui.authority_automatic->isChecked()) {
+	if (routed) {
+		// Every group gets its own authority
+	} else if (ui.authority_automatic->isChecked()) {
 		if (!dchk.SetAuthorityByDomainList(list)) {
 			QString e;
 			Error2String(e,&dchk);
@@ -183,29 +204,40 @@ void qdchk::on_start_clicked()
 		dchk.SetAuthority(Tmp.toUtf8());
 	}
 
-	// Connect to Server
-	if (!dchk.Connect()) {
-		QString e;
-		Error2String(e,&dchk);
-		QMessageBox::critical(this, tr("DomainCheck"),
-		                   e,
-		                   QMessageBox::Ok);
-		return;
-	}
+	if (routed) {
+		if (!dchk.QueryDomainListByAuthority(list)) {
+			QString e;
+			Error2String(e,&dchk);
+			QMessageBox::critical(this, tr("DomainCheck"),
+			                   e,
+			                   QMessageBox::Ok);
+		}
+	} else {
+		// Connect to Server
+		if (!dchk.Connect()) {
+			QString e;
+			Error2String(e,&dchk);
+			QMessageBox::critical(this, tr("DomainCheck"),
+			                   e,
+			                   QMessageBox::Ok);
+			return;
+		}
 
-	if (!dchk.QueryDomainList(list)) {
-		QString e;
-		Error2String(e,&dchk);
-		QMessageBox::critical(this, tr("DomainCheck"),
-		                   e,
-		                   QMessageBox::Ok);
+		if (!dchk.QueryDomainList(list)) {
+			QString e;
+			Error2String(e,&dchk);
+			QMessageBox::critical(this, tr("DomainCheck"),
+			                   e,
+			                   QMessageBox::Ok);
+		}
 	}
 	dchk.Disconnect();
 	IRISLWZ_PACKET *request=dchk.GetRequestPacket();
 	IRISLWZ_PACKET *response=dchk.GetResponsePacket();
 
 	// Request
-	ui.request->setText(request->beautified);
+	const char *beautified=dchk.GetBeautified(request);
+	ui.request->setText((beautified?beautified:""));
 	HexDump(Tmp,request->packet,request->size);
 	ui.req_packet->setText(Tmp);
 	Tmp.sprintf("%i",request->size);
@@ -232,7 +264,8 @@ void qdchk::on_start_clicked()
 	ui.req_payloadtype->setText(dchk.GetPayloadType(request));
 
 	// Response
-	ui.answer->setText((response->beautified?response->beautified:""));
+	const char *answer=dchk.GetBeautified(response);
+	ui.answer->setText((answer?answer:""));
 	if (response->packet) {
 		HexDump(Tmp,response->packet,response->size);
 		ui.resp_packet->setText(Tmp);
@@ -45,6 +45,7 @@
 
 void Error2String(QString &target, dchk::CError *error);
 void HexDump(QString &target, char *address, size_t bytes);
+bool HasDifferentTLDs(dchk::CDomainList &list);
 
 class qdchk : public QDialog
 {
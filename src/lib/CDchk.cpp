@@ -454,6 +454,21 @@ CDchk::CDchk()
 	AcceptDeflated(true);
 }
 
+CDchk::CDchk(DCHK_CONFIG *config)
+	: CIrisLWZ(config)
+/*!\brief Constructor with a shared configuration
+ *
+ * The object takes all settings and the server pool from \p config, see
+ * CIrisLWZ::CIrisLWZ(DCHK_CONFIG *config). Only the maximum number of domains per query
+ * is not part of the configuration and set to the default.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	maxdomainsperquery=20;
+}
+
 CDchk::~CDchk()
 /*!\brief Destructor of the class
  *
@@ -498,6 +513,90 @@ int CDchk::SetHostByDNS(const char *tld)
 	return ret;
 }
 
+int CDchk::SetIDNConversion(int flag)
+/*!\brief Send internationalized domain names in their ASCII form
+ *
+ * See \ref dchk_SetIDNConversion for details.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	return dchk_SetIDNConversion(&handle,flag);
+}
+
+int CDchk::ToASCII(const char *domain, char *buffer, int buffersize)
+/*!\brief Convert an internationalized domain name into its ASCII form
+ *
+ * See \ref dchk_ToASCII for details.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=dchk_ToASCII(&handle,domain,buffer,buffersize);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+int CDchk::SetLocalValidation(int flag)
+/*!\brief Check the syntax of domain names before they are sent
+ *
+ * See \ref dchk_SetLocalValidation for details.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	return dchk_SetLocalValidation(&handle,flag);
+}
+
+int CDchk::SetRoutes(DCHK_ROUTES *routes)
+/*!\brief Use a routing table to find the authority of domains
+ *
+ * See \ref dchk_SetRoutes for details. The table is not copied, it must not be freed as long
+ * as it is used by this object.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=dchk_SetRoutes(&handle,routes);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+int CDchk::SetDNSCache(DCHK_DNSCACHE *cache)
+/*!\brief Use a discovery cache for SetHostByDNS
+ *
+ * See \ref dchk_SetDNSCache for details. The cache is not copied, it must not be freed as long
+ * as it is used by this object.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=dchk_SetDNSCache(&handle,cache);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+int CDchk::ValidateDomainList(CDomainList &list)
+/*!\brief Check the syntax of the domains in a list locally
+ *
+ * See \ref dchk_ValidateDomainList for details.
+ *
+ * \param[in,out] list Reference to a CDomainList object
+ * \returns The number of domains in the list, which are invalid and will not be sent to the
+ * server.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	return dchk_ValidateDomainList(&handle,&list.list);
+}
+
 int CDchk::QueryDomainList(CDomainList &list)
 /*!\brief Checks status of domains in domain list
  *
@@ -519,6 +618,70 @@ int CDchk::QueryDomainList(CDomainList &list)
 
 }
 
+int CDchk::QueryDomainListStriped(CDomainList &list)
+/*!\brief Checks status of domains in domain list using all servers of the pool
+ *
+ * This function works like CDchk::QueryDomainList, but the bundled requests are sent in parallel
+ * to all servers with the lowest priority in the server pool. See
+ * \ref dchk_QueryDomainListStriped for details.
+ *
+ * \param[in,out] list Reference to a CDomainList object
+ * \returns On success, the function returns 1 and the \p domain list is updated. If an
+ * error occurred, it returns 0.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=dchk_QueryDomainListStriped(&handle, &list.list, maxdomainsperquery);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+int CDchk::QueryDomainListParallel(CDomainList &list, int threads)
+/*!\brief Checks status of domains in domain list with multiple threads
+ *
+ * This function works like CDchk::QueryDomainList, but the domains are queried by \p threads
+ * worker threads, each with its own connection, which is created from the settings and the
+ * server pool of this object. See \ref dchk_QueryDomainListParallel for details.
+ *
+ * \param[in,out] list Reference to a CDomainList object
+ * \param[in] threads Number of worker threads between 1 and 256
+ * \returns On success, the function returns 1 and the \p domain list is updated. If an
+ * error occurred, it returns 0.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=dchk_QueryDomainListParallel(&handle, &list.list, maxdomainsperquery, threads);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+int CDchk::QueryDomainListByAuthority(CDomainList &list, int threads)
+/*!\brief Checks status of domains of different registries
+ *
+ * This function splits the \p list into groups of domains with the same authority and queries
+ * them concurrently, each with the correct authority and, if no server was set on this object,
+ * with the server found by DNS for the authority. See \ref dchk_QueryDomainListByAuthority
+ * for details.
+ *
+ * \param[in,out] list Reference to a CDomainList object
+ * \param[in] threads Maximum number of threads between 1 and 256 or 0 for one thread per
+ * authority
+ * \returns If all groups could be queried, the function returns 1. Otherwise it returns 0,
+ * but the domains of the other groups are checked anyway.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=dchk_QueryDomainListByAuthority(&handle, &list.list, maxdomainsperquery, threads);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
 int CDchk::QueryDomain(const char *domain, char **status, char **dbupdate)
 /*!\brief Checks status of a single domain
  *
@@ -0,0 +1,304 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+#ifdef HAVE_STRINGS_H
+	#include <strings.h>
+#endif
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#endif
+#include "dchk.h"
+
+
+namespace dchk {
+
+/*!\class CEngine
+ * \brief Event driven query engine
+ *
+ * This class is the C++ interface to the \ref DCHK_API_ENGINE "DCHK engine". It takes
+ * domains and payloads, sends them to the server of a connected CIrisLWZ or CDchk object
+ * without blocking and delivers the results to the virtual functions CEngine::OnDomain
+ * and CEngine::OnPayload. Derive your own class from CEngine and override these functions
+ * to process the results.
+ *
+ * \code
+class MyEngine : public dchk::CEngine
+{
+	public:
+		virtual void OnDomain(DCHK_RECORD *record, int error, void *privatedata) {
+			if (error) printf("%s: %s\n",record->domain,irislwz_GetError(error));
+			else printf("%s: %s\n",record->domain,record->status);
+		}
+};
+
+dchk::CDchk dchk;
+dchk.SetHostByDNS("de");
+dchk.SetWindow(100);
+dchk.Connect();
+MyEngine engine;
+engine.Init(dchk);
+engine.SubmitDomain("denic.de");
+engine.SubmitDomain("example.de");
+engine.Run();
+ * \endcode
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_CPP_API
+ */
+
+/*!\var CEngine::engine
+ * \brief Basic data structure for underlying C-API
+ *
+ * \see \ref DCHK_ENGINE
+ */
+
+CEngine::CEngine()
+/*!\brief Constructor of the class
+ *
+ * The engine must be initialized with CEngine::Init before it can be used.
+ */
+{
+	memset(&engine,0,sizeof(DCHK_ENGINE));
+}
+
+CEngine::~CEngine()
+/*!\brief Destructor of the class
+ *
+ * Cancels all unfinished domains and payloads and frees all memory used by the engine.
+ * Please note, that the callback functions of a derived class can not be called any longer
+ * at this point. Call CEngine::Exit in the destructor of your derived class, if you
+ * need them.
+ */
+{
+	if (engine.queue) {
+		// Virtual functions of derived classes are already gone
+		engine.privatedata=NULL;
+		dchk_engine_Exit(&engine);
+	}
+}
+
+void CEngine::DomainCallback(DCHK_ENGINE *engine, DCHK_RECORD *record, int error, void *privatedata)
+/*!\brief Callback function for the C-API
+ *
+ * \internal
+ */
+{
+	CEngine *self=(CEngine*)engine->privatedata;
+	if (self) self->OnDomain(record,error,privatedata);
+}
+
+void CEngine::PayloadCallback(DCHK_ENGINE *engine, IRISLWZ_HANDLE *handle, int error, void *privatedata)
+/*!\brief Callback function for the C-API
+ *
+ * \internal
+ */
+{
+	CEngine *self=(CEngine*)engine->privatedata;
+	if (self) self->OnPayload(&handle->response,error,privatedata);
+}
+
+int CEngine::Init(CIrisLWZ &lwz)
+/*!\brief Initialize the engine
+ *
+ * This function initializes the engine for usage with the connection of \p lwz. The CIrisLWZ
+ * object must already be connected and must not be used for other queries while the engine
+ * is running. The number of outstanding requests is limited by CIrisLWZ::SetWindow.
+ *
+ * \param[in] lwz Reference to a connected CIrisLWZ or CDchk object
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \see \ref dchk_engine_Init
+ */
+{
+	if (engine.queue) Exit();
+	int ret=dchk_engine_Init(&engine,lwz.GetHandle());
+	if (!ret) {
+		CopyError(lwz.GetHandle());
+		return 0;
+	}
+	engine.privatedata=this;
+	return 1;
+}
+
+int CEngine::Exit()
+/*!\brief Deinitialize the engine
+ *
+ * Cancels all unfinished domains and payloads and frees all memory used by the engine.
+ *
+ * \returns Always returns 1.
+ *
+ * \see \ref dchk_engine_Exit
+ */
+{
+	if (!engine.queue) return 1;
+	return dchk_engine_Exit(&engine);
+}
+
+void CEngine::SetMaxDomainsPerQuery(int count)
+/*!\brief Sets the maximum number of domains per query
+ *
+ * \param[in] count Number of domains. A value of "0" means unlimited.
+ */
+{
+	dchk_engine_SetMaxDomainsPerQuery(&engine,count);
+}
+
+int CEngine::SubmitDomain(const char *domain, void *privatedata)
+/*!\brief Submit a domain to the engine
+ *
+ * The result is delivered to CEngine::OnDomain.
+ *
+ * \param[in] domain pointer to a domain name
+ * \param[in] privatedata Pointer to some optional data, which is passed to CEngine::OnDomain
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \see \ref dchk_engine_SubmitDomain
+ */
+{
+	if (!engine.queue) {
+		SetError(74025,"CEngine is not initialized");
+		return 0;
+	}
+	int ret=dchk_engine_SubmitDomain(&engine,domain,DomainCallback,privatedata);
+	if (!ret) CopyError(engine.handle);
+	return ret;
+}
+
+int CEngine::SubmitPayload(const char *payload, int bytes, void *privatedata)
+/*!\brief Submit a raw request to the engine
+ *
+ * The result is delivered to CEngine::OnPayload.
+ *
+ * \param[in] payload Request, which should be send to IRIS server
+ * \param[in] bytes Size of the payload
+ * \param[in] privatedata Pointer to some optional data, which is passed to CEngine::OnPayload
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \see \ref dchk_engine_SubmitPayload
+ */
+{
+	if (!engine.queue) {
+		SetError(74025,"CEngine is not initialized");
+		return 0;
+	}
+	int ret=dchk_engine_SubmitPayload(&engine,payload,bytes,PayloadCallback,privatedata);
+	if (!ret) CopyError(engine.handle);
+	return ret;
+}
+
+int CEngine::Run(int timeout)
+/*!\brief Process submitted domains and payloads
+ *
+ * \param[in] timeout Maximum time in milliseconds. Use -1 to run until all submitted domains
+ * and payloads are finished, or 0 to process only what is possible without blocking.
+ * \returns Returns 1 on success or 0 on error.
+ *
+ * \see \ref dchk_engine_Run
+ */
+{
+	if (!engine.queue) {
+		SetError(74025,"CEngine is not initialized");
+		return 0;
+	}
+	int ret=dchk_engine_Run(&engine,timeout);
+	if (!ret) CopyError(engine.handle);
+	return ret;
+}
+
+void CEngine::Cancel()
+/*!\brief Cancel all unfinished domains and payloads
+ *
+ * \see \ref dchk_engine_Cancel
+ */
+{
+	dchk_engine_Cancel(&engine);
+}
+
+int CEngine::Pending()
+/*!\brief Returns the number of unfinished domains and payloads
+ */
+{
+	return dchk_engine_Pending(&engine);
+}
+
+int CEngine::GetFd()
+/*!\brief Returns a descriptor for external event loops
+ *
+ * \see \ref dchk_engine_GetFd
+ */
+{
+	return dchk_engine_GetFd(&engine);
+}
+
+int CEngine::NextTimeout()
+/*!\brief Returns the time in milliseconds until the engine needs to run again
+ *
+ * \see \ref dchk_engine_NextTimeout
+ */
+{
+	return dchk_engine_NextTimeout(&engine);
+}
+
+void CEngine::OnDomain(DCHK_RECORD *record, int error, void *privatedata)
+/*!\brief Result of a domain
+ *
+ * This function is called, when the result for a domain submitted by CEngine::SubmitDomain
+ * is available. The default implementation does nothing.
+ *
+ * \param[in] record Pointer to the domain record, which is only valid during this call
+ * \param[in] error 0 on success, otherwise the error code
+ * \param[in] privatedata The pointer passed to CEngine::SubmitDomain
+ */
+{
+}
+
+void CEngine::OnPayload(IRISLWZ_PACKET *response, int error, void *privatedata)
+/*!\brief Result of a payload
+ *
+ * This function is called, when the answer for a payload submitted by CEngine::SubmitPayload
+ * is available. The default implementation does nothing.
+ *
+ * \param[in] response Pointer to the response packet, which is only valid during this call
+ * \param[in] error 0 on success, otherwise the error code
+ * \param[in] privatedata The pointer passed to CEngine::SubmitPayload
+ */
+{
+}
+
+} // EOF namespace dchk
@@ -109,6 +109,24 @@ CIrisLWZ::CIrisLWZ()
 	irislwz_Init(&handle);
 }
 
+CIrisLWZ::CIrisLWZ(DCHK_CONFIG *config)
+/*!\brief Constructor with a shared configuration
+ *
+ * The object takes all settings and the server pool from \p config, which was created with
+ * CIrisLWZ::NewConfig or \ref irislwz_NewConfig. The strings of the configuration are shared
+ * and not copied. See \ref irislwz_InitFromConfig for details.
+ *
+ * \param[in] config pointer to a configuration. The object holds its own reference, so the
+ * caller can release the configuration after the object was created.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	handle.initialized=0;
+	if (!irislwz_InitFromConfig(&handle,config)) CopyError(&handle);
+}
+
 CIrisLWZ::~CIrisLWZ()
 /*!\brief Destructor of the class
  *
@@ -243,6 +261,81 @@ int CIrisLWZ::SetHost(const char *host, int port)
 	return ret;
 }
 
+int CIrisLWZ::AddServer(const char *host, int port, int priority, int weight)
+/*!\brief Add a server to the server pool
+ *
+ * Requests are spread across the servers of the pool according to their priority and weight
+ * as described in RFC 2782. See \ref irislwz_AddServer for details.
+ *
+ * \param[in] host name or IP address of the server
+ * \param[in] port port of the server (default=715)
+ * \param[in] priority priority between 0 and 65535, lower values are preferred
+ * \param[in] weight weight between 0 and 65535
+ * \returns Returns 1 on success or 0 when an error occurred.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=irislwz_AddServer(&handle,host,port,priority,weight);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+DCHK_CONFIG *CIrisLWZ::NewConfig()
+/*!\brief Create a shared configuration from the settings of this object
+ *
+ * The configuration can be used to create any number of objects with the same settings and
+ * server pool in other threads. See \ref irislwz_NewConfig for details.
+ *
+ * \returns Pointer to the configuration, which must be released with
+ * \ref irislwz_ReleaseConfig, or NULL if an error occurred.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	DCHK_CONFIG *config=irislwz_NewConfig(&handle);
+	if (!config) CopyError(&handle);
+	return config;
+}
+
+void CIrisLWZ::ClearServers()
+/*!\brief Remove all servers from the server pool
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	irislwz_ClearServers(&handle);
+}
+
+int CIrisLWZ::GetServerCount()
+/*!\brief Returns the number of servers in the server pool
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	return irislwz_GetServerCount(&handle);
+}
+
+int CIrisLWZ::SelectServer()
+/*!\brief Select the server for the next request from the server pool
+ *
+ * See \ref irislwz_SelectServer for details.
+ *
+ * \returns Returns 1 on success or 0 when an error occurred.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=irislwz_SelectServer(&handle);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
 const char *CIrisLWZ::GetHostname()
 /*!\brief Returns pointer to the hostname of a previous set server
  *
@@ -317,6 +410,79 @@ int CIrisLWZ::SendDeflated(int flag)
 	return ret;
 }
 
+int CIrisLWZ::SetCompression(int mode, int level, int strategy)
+/*!\brief Set compression policy for requests
+ *
+ * Requests can be sent uncompressed (IRISLWZ_COMPRESSION_OFF), always compressed
+ * (IRISLWZ_COMPRESSION_ALWAYS) or compressed only when it pays (IRISLWZ_COMPRESSION_AUTO).
+ * See \ref irislwz_SetCompression for details.
+ *
+ * \param[in] mode Compression policy
+ * \param[in] level zlib compression level between 0 and 9 or -1 (default=9)
+ * \param[in] strategy zlib compression strategy between 0 and 4 (default=0)
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=irislwz_SetCompression(&handle,mode,level,strategy);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+int CIrisLWZ::SetCompressionThreshold(int bytes)
+/*!\brief Set minimum saving for compressed requests
+ *
+ * See \ref irislwz_SetCompressionThreshold for details.
+ *
+ * \param[in] bytes Minimum number of bytes, which must be saved by compression
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=irislwz_SetCompressionThreshold(&handle,bytes);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+int CIrisLWZ::SetMaxInflateRatio(int ratio)
+/*!\brief Set maximum expansion ratio of compressed answers
+ *
+ * See \ref irislwz_SetMaxInflateRatio for details.
+ *
+ * \param[in] ratio Maximum ratio between decompressed and compressed size or 0 for no limit
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=irislwz_SetMaxInflateRatio(&handle,ratio);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+int CIrisLWZ::SetRetention(int flags)
+/*!\brief Set which packets are kept after the results are parsed
+ *
+ * See \ref irislwz_SetRetention for details.
+ *
+ * \param[in] flags IRISLWZ_RETAIN_NONE, IRISLWZ_RETAIN_REQUEST, IRISLWZ_RETAIN_RESPONSE or
+ * IRISLWZ_RETAIN_ALL
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=irislwz_SetRetention(&handle,flags);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
 int CIrisLWZ::UseRFC1950(int flag)
 /*!\brief Use RFC 1950 for compression
  *
@@ -339,6 +505,93 @@ int CIrisLWZ::UseRFC1950(int flag)
 	return ret;
 }
 
+int CIrisLWZ::SetWindow(int requests)
+/*!\brief Set maximum number of outstanding requests
+ *
+ * With this function you can define how many requests may be sent to the server
+ * without waiting for their answers. See \ref irislwz_SetWindow for details.
+ *
+ * \param[in] requests Number of requests between 1 and 65534
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=irislwz_SetWindow(&handle,requests);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+int CIrisLWZ::SetBatchSize(int packets)
+/*!\brief Enable batched I/O
+ *
+ * With batched I/O several request packets are sent and several answers are read with a
+ * single system call. See \ref irislwz_SetBatchSize for details.
+ *
+ * \param[in] packets Maximum number of packets per system call between 1 and 1024.
+ * 1 disables batched I/O.
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=irislwz_SetBatchSize(&handle,packets);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+int CIrisLWZ::SetRetries(int retries)
+/*!\brief Set number of retransmissions
+ *
+ * Sets how often a request is retransmitted, if its answer does not arrive in time.
+ * See \ref irislwz_SetRetries for details.
+ *
+ * \param[in] retries Number of retransmissions between 0 and 20
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=irislwz_SetRetries(&handle,retries);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
+int CIrisLWZ::GetRTO()
+/*!\brief Returns the current retransmission timeout
+ *
+ * \returns Retransmission timeout in milliseconds
+ *
+ * \see \ref irislwz_GetRTO
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	return irislwz_GetRTO(&handle);
+}
+
+int CIrisLWZ::SetHedging(int percentile)
+/*!\brief Enable hedged requests
+ *
+ * If the answer takes longer than the given percentile of the recent round trip times, a copy
+ * of the request with a new transaction id is sent. See \ref irislwz_SetHedging for details.
+ *
+ * \param[in] percentile Percentile between 1 and 99 or 0 to disable hedging
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	int ret=irislwz_SetHedging(&handle,percentile);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
 
 int CIrisLWZ::FlagSizeInfo(int flag)
 /*!\brief Set SI-Flag
@@ -633,6 +886,26 @@ if (beautified) free(beautified);
 
 }
 
+const char *CIrisLWZ::GetBeautified(IRISLWZ_PACKET *p)
+/*!\brief Returns a beautified version of the payload of a packet
+ *
+ * The beautified version is created on the first call and stays in the packet until it is
+ * freed.
+ *
+ * \param[in] p Optional pointer to a \ref IRISLWZ_PACKET structure. If no pointer is given,
+ * the function will use the last response packet revived with this class.
+ * \returns Pointer to the beautified XML or NULL, if the packet has no valid XML payload.
+ *
+ * \since
+ * Version 0.5.8
+ */
+{
+	if (!p) p=&handle.response;
+	const char *ret=irislwz_GetBeautified(&handle,p);
+	if (!ret) CopyError(&handle);
+	return ret;
+}
+
 void CIrisLWZ::FreePacket(IRISLWZ_PACKET *p)
 /*!\brief Frees the memory used by an IRISLWZ_PACKET
  *
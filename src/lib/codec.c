@@ -0,0 +1,357 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+#ifdef HAVE_STRINGS_H
+	#include <strings.h>
+#endif
+
+#include <zlib.h>
+#ifdef HAVE_LIBDEFLATE
+	#include <libdeflate.h>
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+
+/*
+ * The codec keeps the compression and decompression contexts of a handle, so they are
+ * allocated only once and just reset for every packet. The zlib contexts are always
+ * available. If the library is built with libdeflate, it is used instead of zlib, except
+ * for compression with a strategy, which only zlib supports.
+ *
+ * Starting every request from a deflateCopy of a stream, which has already seen the
+ * constant "<iris1:request ...><iris1:searchSet><iris1:lookupEntity ..." prefix, does not
+ * pay: deflateCopy allocates and copies the complete state (about 256 KB with the default
+ * window and memLevel) and took 85 us per request, whereas deflateReset plus compressing a
+ * single domain request took 8 us. Compressing the prefix itself costs less than 1 us.
+ */
+typedef struct {
+	z_stream deflater;
+	int deflateReady;
+	int deflateLevel;
+	int deflateStrategy;
+	int deflateWindowBits;
+	z_stream inflater;
+	int inflateReady;
+#ifdef HAVE_LIBDEFLATE
+	struct libdeflate_compressor *compressor;
+	int compressorLevel;
+	struct libdeflate_decompressor *decompressor;
+#endif
+} IRISLWZ_CODEC;
+
+
+static IRISLWZ_CODEC *irislwz_GetCodec(IRISLWZ_HANDLE *handle)
+/*!\brief Returns the codec of the handle
+ *
+ * \internal
+ * The codec is allocated on first use.
+ */
+{
+	if (!handle->codec) {
+		handle->codec=calloc(1,sizeof(IRISLWZ_CODEC));
+		if (!handle->codec) irislwz_SetError(handle,74024,NULL);
+	}
+	return (IRISLWZ_CODEC*)handle->codec;
+}
+
+void irislwz_FreeCodec(IRISLWZ_HANDLE *handle)
+/*!\brief Free the codec of the handle
+ *
+ * \internal
+ */
+{
+	IRISLWZ_CODEC *c=(IRISLWZ_CODEC*)handle->codec;
+	if (!c) return;
+	if (c->deflateReady) deflateEnd(&c->deflater);
+	if (c->inflateReady) inflateEnd(&c->inflater);
+#ifdef HAVE_LIBDEFLATE
+	if (c->compressor) libdeflate_free_compressor(c->compressor);
+	if (c->decompressor) libdeflate_free_decompressor(c->decompressor);
+#endif
+	free(c);
+	handle->codec=NULL;
+}
+
+static int irislwz_GrowInflateBuffer(IRISLWZ_HANDLE *handle, size_t size)
+/*!\brief Make the inflate buffer of the handle at least \p size bytes big
+ *
+ * \internal
+ * One additional byte is allocated for terminating the payload.
+ */
+{
+	if ((size_t)handle->inflatebuffersize>=size) return 1;
+	char *buffer=(char*)realloc(handle->inflatebuffer,size+1);
+	if (!buffer) {
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	handle->inflatebuffer=buffer;
+	handle->inflatebuffersize=(int)size;
+	return 1;
+}
+
+static int irislwz_DeflateZlib(IRISLWZ_HANDLE *handle, IRISLWZ_CODEC *c, char *dst, int *dstlen, const char *src, int size)
+/*!\brief Compress a buffer with zlib
+ *
+ * \internal
+ * The zlib stream is only initialized again, if the compression settings of the handle
+ * have changed, otherwise it is reset.
+ */
+{
+	int ret;
+	int windowBits=handle->rfc1950_workaround ? 15 : -15;
+	if (c->deflateReady && (c->deflateLevel!=handle->deflateLevel || c->deflateStrategy!=handle->deflateStrategy
+			|| c->deflateWindowBits!=windowBits)) {
+		deflateEnd(&c->deflater);
+		c->deflateReady=0;
+	}
+	if (!c->deflateReady) {
+		memset(&c->deflater,0,sizeof(z_stream));
+		ret=deflateInit2(&c->deflater,handle->deflateLevel,Z_DEFLATED,windowBits,8,handle->deflateStrategy);
+		if (ret!=Z_OK) {
+			irislwz_SetError(handle,(ret==Z_MEM_ERROR ? 74024 : 74039),NULL);
+			return 0;
+		}
+		c->deflateReady=1;
+		c->deflateLevel=handle->deflateLevel;
+		c->deflateStrategy=handle->deflateStrategy;
+		c->deflateWindowBits=windowBits;
+	} else {
+		deflateReset(&c->deflater);
+	}
+	c->deflater.next_in=(Bytef*)src;
+	c->deflater.avail_in=size;
+	c->deflater.next_out=(Bytef*)dst;
+	c->deflater.avail_out=*dstlen;
+	ret=deflate(&c->deflater,Z_FINISH);
+	if (ret!=Z_STREAM_END) {
+		irislwz_SetError(handle,74039,NULL);
+		return 0;
+	}
+	*dstlen=(int)c->deflater.total_out;
+	return 1;
+}
+
+#ifndef HAVE_LIBDEFLATE
+static int irislwz_InflateZlib(IRISLWZ_HANDLE *handle, IRISLWZ_CODEC *c, IRISLWZ_PACKET *response, size_t limit, size_t *size)
+/*!\brief Decompress a payload with zlib
+ *
+ * \internal
+ * The payload is inflated into the inflate buffer of the handle. If the buffer is full, it is
+ * doubled and inflating continues where it stopped.
+ */
+{
+	int ret;
+	int windowBits=handle->rfc1950_workaround ? 15 : -15;
+	if (!c->inflateReady) {
+		memset(&c->inflater,0,sizeof(z_stream));
+		ret=inflateInit2(&c->inflater,windowBits);
+		if (ret!=Z_OK) {
+			irislwz_SetError(handle,(ret==Z_MEM_ERROR ? 74024 : 74037),NULL);
+			return 0;
+		}
+		c->inflateReady=1;
+	} else if (inflateReset2(&c->inflater,windowBits)!=Z_OK) {
+		irislwz_SetError(handle,74037,NULL);
+		return 0;
+	}
+	z_stream *z=&c->inflater;
+	z->next_in=(Bytef*)response->payload;
+	z->avail_in=response->size_payload;
+	while (1) {
+		// The buffer of the handle may be bigger than the limit of this answer
+		size_t avail=(size_t)handle->inflatebuffersize;
+		if (limit>0 && avail>limit) avail=limit;
+		z->next_out=(Bytef*)handle->inflatebuffer+z->total_out;
+		z->avail_out=(uInt)(avail-z->total_out);
+		ret=inflate(z,Z_NO_FLUSH);
+		if (ret==Z_STREAM_END) break;
+		if ((ret!=Z_OK && ret!=Z_BUF_ERROR) || z->avail_out>0) {
+			// Corrupt or truncated data
+			irislwz_SetError(handle,74037,NULL);
+			return 0;
+		}
+		// Output buffer is full, we double it and continue where we stopped
+		if (limit>0 && avail>=limit) {
+			irislwz_SetError(handle,74068,"%i Bytes compressed, ratio %i",response->size_payload,handle->maxInflateRatio);
+			return 0;
+		}
+		size_t newsize=(size_t)handle->inflatebuffersize*2;
+		if (limit>0 && newsize>limit) newsize=limit;
+		if (!irislwz_GrowInflateBuffer(handle,newsize)) return 0;
+	}
+	*size=z->total_out;
+	return 1;
+}
+#endif
+
+#ifdef HAVE_LIBDEFLATE
+static int irislwz_DeflateLibdeflate(IRISLWZ_HANDLE *handle, IRISLWZ_CODEC *c, char *dst, int *dstlen, const char *src, int size)
+/*!\brief Compress a buffer with libdeflate
+ *
+ * \internal
+ * The compressor is only allocated again, if the compression level has changed.
+ */
+{
+	int level=handle->deflateLevel;
+	if (level==Z_DEFAULT_COMPRESSION) level=6;
+	if (c->compressor && c->compressorLevel!=level) {
+		libdeflate_free_compressor(c->compressor);
+		c->compressor=NULL;
+	}
+	if (!c->compressor) {
+		c->compressor=libdeflate_alloc_compressor(level);
+		if (!c->compressor) {
+			irislwz_SetError(handle,74024,NULL);
+			return 0;
+		}
+		c->compressorLevel=level;
+	}
+	size_t bytes;
+	if (handle->rfc1950_workaround) bytes=libdeflate_zlib_compress(c->compressor,src,size,dst,*dstlen);
+	else bytes=libdeflate_deflate_compress(c->compressor,src,size,dst,*dstlen);
+	if (!bytes) {
+		irislwz_SetError(handle,74039,NULL);
+		return 0;
+	}
+	*dstlen=(int)bytes;
+	return 1;
+}
+
+static int irislwz_InflateLibdeflate(IRISLWZ_HANDLE *handle, IRISLWZ_CODEC *c, IRISLWZ_PACKET *response, size_t limit, size_t *size)
+/*!\brief Decompress a payload with libdeflate
+ *
+ * \internal
+ * libdeflate can not continue a stopped decompression, so the payload is decompressed again
+ * with a doubled buffer, if the buffer was too small. This is still faster than inflating
+ * with zlib, and the buffer of the handle usually is big enough after the first answers.
+ */
+{
+	enum libdeflate_result ret;
+	if (!c->decompressor) {
+		c->decompressor=libdeflate_alloc_decompressor();
+		if (!c->decompressor) {
+			irislwz_SetError(handle,74024,NULL);
+			return 0;
+		}
+	}
+	while (1) {
+		// The buffer of the handle may be bigger than the limit of this answer
+		size_t avail=(size_t)handle->inflatebuffersize;
+		if (limit>0 && avail>limit) avail=limit;
+		if (handle->rfc1950_workaround) ret=libdeflate_zlib_decompress(c->decompressor,response->payload,
+				response->size_payload,handle->inflatebuffer,avail,size);
+		else ret=libdeflate_deflate_decompress(c->decompressor,response->payload,
+				response->size_payload,handle->inflatebuffer,avail,size);
+		if (ret==LIBDEFLATE_SUCCESS) return 1;
+		if (ret!=LIBDEFLATE_INSUFFICIENT_SPACE) {
+			irislwz_SetError(handle,74037,NULL);
+			return 0;
+		}
+		if (limit>0 && avail>=limit) {
+			irislwz_SetError(handle,74068,"%i Bytes compressed, ratio %i",response->size_payload,handle->maxInflateRatio);
+			return 0;
+		}
+		size_t newsize=(size_t)handle->inflatebuffersize*2;
+		if (limit>0 && newsize>limit) newsize=limit;
+		if (!irislwz_GrowInflateBuffer(handle,newsize)) return 0;
+	}
+}
+#endif
+
+int irislwz_Deflate(IRISLWZ_HANDLE *handle, char *dst, int *dstlen, const char *src, int size)
+/*!\brief Compress a buffer with the compression settings of the handle
+ *
+ * \internal
+ * Uses RFC 1950 or RFC 1951 format and the level and strategy set with
+ * \ref irislwz_SetCompression. \p dstlen contains the size of \p dst and
+ * returns the size of the compressed data.
+ *
+ * \returns On success, this function returns 1, on error 0.
+ */
+{
+	IRISLWZ_CODEC *c=irislwz_GetCodec(handle);
+	if (!c) return 0;
+#ifdef HAVE_LIBDEFLATE
+	if (handle->deflateStrategy==Z_DEFAULT_STRATEGY) return irislwz_DeflateLibdeflate(handle,c,dst,dstlen,src,size);
+#endif
+	return irislwz_DeflateZlib(handle,c,dst,dstlen,src,size);
+}
+
+int irislwz_DeflatedSize(IRISLWZ_HANDLE *handle, const char *buffer, int size)
+/*!\brief Calculate the compressed size of a buffer with the compression settings of the handle
+ *
+ * \internal
+ * \returns Size of the compressed data or 0 on error
+ */
+{
+	int dstlen=(int)compressBound(size)+16;
+	char *dst=(char*)malloc(dstlen);
+	if (!dst) return 0;
+	int ret=irislwz_Deflate(handle,dst,&dstlen,buffer,size);
+	free(dst);
+	if (!ret) return 0;
+	return dstlen;
+}
+
+int irislwz_Inflate(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *response)
+/*!\brief Decompress the payload of a response
+ *
+ * \internal
+ * The payload is inflated into the inflate buffer of the handle, which is reused for all
+ * answers and grows geometrically, if it is too small. An answer is never inflated beyond the
+ * payload size multiplied by the ratio set with \ref irislwz_SetMaxInflateRatio, even if the
+ * buffer is already bigger from previous answers, which protects against decompression bombs.
+ */
+{
+	size_t limit=0, size;
+	IRISLWZ_CODEC *c=irislwz_GetCodec(handle);
+	if (!c) return 0;
+	if (handle->maxInflateRatio>0) limit=(size_t)response->size_payload*handle->maxInflateRatio+1024;
+	// DCHK answers compress really good, so we start with 10 times the compressed size plus a bit extra
+	size=(size_t)response->size_payload*10+1024;
+	if (limit>0 && size>limit) size=limit;
+	if (!irislwz_GrowInflateBuffer(handle,size)) return 0;
+#ifdef HAVE_LIBDEFLATE
+	if (!irislwz_InflateLibdeflate(handle,c,response,limit,&size)) return 0;
+#else
+	if (!irislwz_InflateZlib(handle,c,response,limit,&size)) return 0;
+#endif
+	response->uncompressed_payload=handle->inflatebuffer;
+	response->size_uncompressed=(int)size;
+	response->shared|=2;
+	return 1;
+}
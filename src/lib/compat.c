@@ -62,9 +62,20 @@
 #ifdef _WIN32
 #include <winsock2.h>
 #include <windows.h>
+#elif defined(HAVE_PTHREAD_H)
+	#include <pthread.h>
 #endif
 
 
+#ifdef HAVE_XML2
+#ifndef LIBXML_STATIC
+	#define LIBXML_STATIC
+	#define LIBXSLT_STATIC
+	#define XMLSEC_STATIC
+#endif
+	#include <libxml/parser.h>
+#endif
+
 #include "dchk.h"
 #include "compat.h"
 
@@ -98,6 +109,72 @@ int irislwz_InitWSA()
 #endif
 }
 
+static int irislwz_InitLibraryOnce()
+/*!\brief Does the global initialization of \ref irislwz_InitLibrary
+ *
+ * \internal
+ */
+{
+	if (!irislwz_InitWSA()) return 0;
+#ifdef HAVE_XML2
+	xmlInitParser();
+#endif
+	return 1;
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK irislwz_InitLibraryCallback(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+	return irislwz_InitLibraryOnce() ? TRUE : FALSE;
+}
+#elif defined(HAVE_PTHREAD_H)
+static int irislwz_initialized=0;
+
+static void irislwz_InitLibraryCallback()
+{
+	irislwz_initialized=irislwz_InitLibraryOnce();
+}
+#endif
+
+int irislwz_InitLibrary()
+/*!\brief Initialize the library
+ *
+ * This function does the global initialization, which is needed by the library: it
+ * initializes the Windows Sockets (see \ref irislwz_InitWSA) and libxml2. Only the first call
+ * does something, further calls return immediately. After that, the library has no global
+ * state, which is changed by the queries, so IRISLWZ_HANDLE objects can be used on multiple
+ * threads at the same time, as long as each handle is only used by one thread.
+ *
+ * \ref irislwz_Init calls this function, too. It is safe to call it on multiple threads at
+ * the same time, all of them return after the initialization is finished.
+ *
+ * \returns On success the function returns 1, otherwise 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+#ifdef _WIN32
+	// A failed initialization is tried again on the next call
+	static INIT_ONCE once=INIT_ONCE_STATIC_INIT;
+	if (!InitOnceExecuteOnce(&once,irislwz_InitLibraryCallback,NULL,NULL)) return 0;
+	return 1;
+#elif defined(HAVE_PTHREAD_H)
+	static pthread_once_t once=PTHREAD_ONCE_INIT;
+	if (pthread_once(&once,irislwz_InitLibraryCallback)!=0) return 0;
+	return irislwz_initialized;
+#else
+	// Without threads there is no race
+	static int initialized=0;
+	if (initialized) return 1;
+	if (!irislwz_InitLibraryOnce()) return 0;
+	initialized=1;
+	return 1;
+#endif
+}
+
 #ifndef HAVE_BZERO
 void bzero(void *s, size_t n)
 {
@@ -0,0 +1,214 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <windows.h>
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+
+struct __irislwz_config {
+	IRISLWZ_HANDLE settings;		// never connected, only holds the settings and the server pool
+	volatile long refcount;
+};
+
+DCHK_CONFIG *irislwz_NewConfig(IRISLWZ_HANDLE *handle)
+/*!\brief Create a shared configuration from the settings of a handle
+ *
+ * This function takes a snapshot of all settings of \p handle, which are copied by
+ * \ref irislwz_CloneHandle, and of its server pool. The servers of the pool are resolved
+ * once, so handles created from the configuration don't need a DNS lookup to connect.
+ * The configuration can not be changed afterwards. Later changes on \p handle don't affect it.
+ *
+ * A routing table (see \ref dchk_SetRoutes) or discovery cache (see \ref dchk_SetDNSCache)
+ * of \p handle is not copied, but the configuration holds a reference to it. It stays valid
+ * until the configuration is freed, even if \ref dchk_FreeRoutes or \ref dchk_FreeDNSCache
+ * was called for it before.
+ *
+ * A configuration is meant to be shared: any number of handles can be created from it with
+ * \ref irislwz_InitFromConfig, in any thread. They don't copy the strings of the
+ * configuration, but keep a reference to it. The configuration is freed, when
+ * \ref irislwz_ReleaseConfig was called for it and all handles created from it were
+ * deinitialized with \ref irislwz_Exit.
+ *
+ * \param[in] handle pointer to a configured IRISLWZ_HANDLE object
+ * \returns Pointer to the new configuration with a reference count of 1, or NULL if an error
+ * occurred. In this case the error is set on \p handle.
+ *
+ * \example
+ * \code
+IRISLWZ_HANDLE handle, worker;
+irislwz_Init(&handle);
+dchk_SetHostByDNS(&handle,"de");
+irislwz_SetAuthority(&handle,"de");
+irislwz_SetWindow(&handle,10);
+DCHK_CONFIG *config=irislwz_NewConfig(&handle);
+...
+// in each worker thread
+irislwz_InitFromConfig(&worker,config);
+irislwz_Connect(&worker);
+...
+irislwz_Exit(&worker);
+...
+irislwz_ReleaseConfig(config);
+ * \endcode
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return NULL;
+	DCHK_CONFIG *config=(DCHK_CONFIG*)calloc(1,sizeof(DCHK_CONFIG));
+	if (!config) {
+		irislwz_SetError(handle,74024,NULL);
+		return NULL;
+	}
+	if (!irislwz_CloneHandle(&config->settings,handle)) {
+		free(config);
+		irislwz_SetError(handle,74024,NULL);
+		return NULL;
+	}
+	if (!irislwz_CopyPool(&config->settings,handle,1)) {
+		irislwz_SetError(handle,config->settings.error,
+			config->settings.errortext ? "%s" : NULL,config->settings.errortext);
+		irislwz_Exit(&config->settings);
+		free(config);
+		return NULL;
+	}
+	dchk_RetainRoutes((DCHK_ROUTES*)config->settings.routes);
+	dchk_RetainDNSCache((DCHK_DNSCACHE*)config->settings.dnscache);
+	config->refcount=1;
+	return config;
+}
+
+DCHK_CONFIG *irislwz_RetainConfig(DCHK_CONFIG *config)
+/*!\brief Add a reference to a configuration
+ *
+ * \param[in] config pointer to a configuration created by \ref irislwz_NewConfig
+ * \returns \p config. Each call must be followed by a call to \ref irislwz_ReleaseConfig.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (config) irislwz_AtomicIncrement(&config->refcount);
+	return config;
+}
+
+void irislwz_ReleaseConfig(DCHK_CONFIG *config)
+/*!\brief Release a reference to a configuration
+ *
+ * The configuration is freed, when the last reference was released. Handles created with
+ * \ref irislwz_InitFromConfig hold their own reference, so the configuration can be released
+ * as soon as all handles are created.
+ *
+ * \param[in] config pointer to a configuration created by \ref irislwz_NewConfig
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!config) return;
+	if (irislwz_AtomicDecrement(&config->refcount)>0) return;
+	DCHK_ROUTES *routes=(DCHK_ROUTES*)config->settings.routes;
+	DCHK_DNSCACHE *cache=(DCHK_DNSCACHE*)config->settings.dnscache;
+	irislwz_Exit(&config->settings);
+	free(config);
+	dchk_FreeRoutes(routes);
+	dchk_FreeDNSCache(cache);
+}
+
+int irislwz_InitFromConfig(IRISLWZ_HANDLE *handle, DCHK_CONFIG *config)
+/*!\brief Initialize a handle with a shared configuration
+ *
+ * This function initializes \p handle like \ref irislwz_Init and takes all settings and the
+ * server pool from \p config. Server name, authority and character set are not copied, the
+ * handle uses the strings of the configuration until they are changed on the handle. The
+ * handle must be connected with \ref irislwz_Connect before it can be used, and deinitialized
+ * with \ref irislwz_Exit, which releases its reference to the configuration.
+ *
+ * Settings changed on the handle afterwards only affect the handle itself.
+ *
+ * \param[out] handle pointer to an uninitialized IRISLWZ_HANDLE object
+ * \param[in] config pointer to a configuration created by \ref irislwz_NewConfig
+ * \returns On success, this function returns 1. On error it returns 0, \p handle is
+ * initialized with the default settings and the error is set on it.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!irislwz_Init(handle)) return 0;
+	if (!config) {
+		irislwz_SetError(handle,74025,"int irislwz_InitFromConfig(IRISLWZ_HANDLE *handle, ==> DCHK_CONFIG *config <==)");
+		return 0;
+	}
+	IRISLWZ_HANDLE *source=&config->settings;
+	if (!irislwz_CopyPool(handle,source,0)) return 0;
+	irislwz_CopySettings(handle,source);
+	handle->config=irislwz_RetainConfig(config);
+	free(handle->localcharset);
+	handle->localcharset=source->localcharset;
+	handle->authority=source->authority;
+	handle->server=source->server;
+	return 1;
+}
+
+void irislwz_FreeString(IRISLWZ_HANDLE *handle, char *string)
+/*!\brief Free a string of the handle
+ *
+ * \internal
+ * Strings, which the handle shares with its configuration, are not freed.
+ */
+{
+	if (!string) return;
+	if (handle->config) {
+		IRISLWZ_HANDLE *source=&((DCHK_CONFIG*)handle->config)->settings;
+		if (string==source->localcharset || string==source->authority
+			|| string==source->server) return;
+	}
+	free(string);
+}
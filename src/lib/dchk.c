@@ -83,9 +83,28 @@
 
 #include <zlib.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+	#include <emmintrin.h>
+	#define DCHK_HAVE_SSE2
+#endif
+
 #include "dchk.h"
 #include "compat.h"
 
+// Character classes of domain names, see dchk_ClassifyDomain
+#define DCHK_CHAR_ESCAPE	1		// Must be escaped in XML
+#define DCHK_CHAR_NONASCII	2		// Part of an UTF-8 sequence
+#define DCHK_CHAR_CONTROL	4		// Not allowed in XML
+
+// Fragments of a request, see dchk_BuildRequest
+static const char dchk_RequestHeader[]="<iris1:request xmlns:iris1=\"urn:ietf:params:xml:ns:iris1\">";
+static const char dchk_RequestFooter[]="</iris1:request>";
+static const char dchk_SearchSetDomain[]="<iris1:searchSet>"
+	"<iris1:lookupEntity registryType=\"dchk1\" entityClass=\"domain-name\" entityName=\"";
+static const char dchk_SearchSetIDN[]="<iris1:searchSet>"
+	"<iris1:lookupEntity registryType=\"dchk1\" entityClass=\"idn\" entityName=\"";
+static const char dchk_SearchSetEnd[]="\"/></iris1:searchSet>";
+
 #ifdef HAVE_XML2
 #ifndef LIBXML_STATIC
 	#define LIBXML_STATIC
@@ -197,6 +216,7 @@ int dchk_AddDomain(DCHK_DOMAINLIST *list, const char *domain)
 	r->domain=strdup(domain);
 	r->lastdatabaseupdate=NULL;
 	r->status=NULL;
+	r->checkedLocally=0;
 	if (!list->first) {
 		list->first=r;
 		list->last=r;
@@ -242,6 +262,7 @@ int dchk_AddnDomain(DCHK_DOMAINLIST *list, const char *domain, int n)
 	r->domain=strndup(domain,n);
 	r->lastdatabaseupdate=NULL;
 	r->status=NULL;
+	r->checkedLocally=0;
 	if (!list->first) {
 		list->first=r;
 		list->last=r;
@@ -293,7 +314,7 @@ int dchk_ExplodeDomain(DCHK_DOMAINLIST *list, const char *string, const char *de
 }
 
 
-static int dchk_DoQuery(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *domainset, char *payload)
+static int dchk_DoQuery(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *domainset, char *payload, int bytes, int validate)
 /*!\brief Perform an actual query to the DCHK server
  *
  * \internal
@@ -303,6 +324,8 @@ static int dchk_DoQuery(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *domainset, char
  * \param[in] handle pointer to an IRISLWZ_HANDLE object
  * \param[in,out] domainset Pointer to an DCHK_DOMAINLIST object in which the results are stored
  * \param[in] payload Pointer to the already constructed XML request
+ * \param[in] bytes Length of the request
+ * \param[in] validate 1, if the request has to be validated before it is sent
  *
  * \returns
  * On success the function returns 1 and updates the domains in the \p domainset. In case of an error
@@ -313,20 +336,100 @@ static int dchk_DoQuery(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *domainset, char
 {
 	if (!handle) return 0;
 	if (!domainset) {
-		irislwz_SetError(handle,74025,"int dchk_DoQuery(IRISLWZ_HANDLE *handle,==> DCHK_DOMAINLIST *domainset <==, char *payload)");
+		irislwz_SetError(handle,74025,"int dchk_DoQuery(IRISLWZ_HANDLE *handle,==> DCHK_DOMAINLIST *domainset <==, char *payload, int bytes, int validate)");
 		return 0;
 	}
 	if (!payload) {
-		irislwz_SetError(handle,74025,"int dchk_DoQuery(IRISLWZ_HANDLE *handle,DCHK_DOMAINLIST *domainset,==> char *payload <==)");
+		irislwz_SetError(handle,74025,"int dchk_DoQuery(IRISLWZ_HANDLE *handle,DCHK_DOMAINLIST *domainset,==> char *payload <==, int bytes, int validate)");
 		return 0;
 	}
-	if (!irislwz_Query(handle,payload)) return 0;
+	if (!irislwz_QueryPayload(handle,payload,bytes,validate)) return 0;
 	// Check if we have size or other information
 	if (!irislwz_CheckResponse(handle)) return 0;
 	return dchk_XML_ParseResult(handle,domainset);
 }
 
 
+static const char *dchk_EscapeChar(unsigned char c, int *len)
+/*!\brief Returns the escape sequence of a character or NULL, if it needs no escaping
+ *
+ * \internal
+ */
+{
+	switch (c) {
+		case '&': *len=5; return "&amp;";
+		case '\"': *len=6; return "&quot;";
+		case '\'': *len=6; return "&#039;";
+		case '<': *len=4; return "&lt;";
+		case '>': *len=4; return "&gt;";
+	}
+	return NULL;
+}
+
+static int dchk_CharClass(unsigned char c)
+{
+	if (c>=128) return DCHK_CHAR_NONASCII;
+	if (c<32) return DCHK_CHAR_CONTROL;
+	if (c=='&' || c=='\"' || c=='\'' || c=='<' || c=='>') return DCHK_CHAR_ESCAPE;
+	return 0;
+}
+
+static int dchk_ClassifyDomain(const char *domain, int len)
+/*!\brief Find out which character classes a domain name contains
+ *
+ * \internal
+ * Most domain names contain neither characters, which must be escaped, nor non ASCII
+ * characters. With SSE2 16 characters are checked at once.
+ *
+ * \returns Combination of DCHK_CHAR_ESCAPE, DCHK_CHAR_NONASCII and DCHK_CHAR_CONTROL
+ */
+{
+	int classes=0, i=0;
+#ifdef DCHK_HAVE_SSE2
+	const __m128i space=_mm_set1_epi8(32);
+	const __m128i amp=_mm_set1_epi8('&'), quot=_mm_set1_epi8('\"'), apos=_mm_set1_epi8('\'');
+	const __m128i lt=_mm_set1_epi8('<'), gt=_mm_set1_epi8('>');
+	for (;i+16<=len;i+=16) {
+		__m128i v=_mm_loadu_si128((const __m128i*)(domain+i));
+		int nonascii=_mm_movemask_epi8(v);
+		// signed compare, so bytes above 127 are less than 32, too
+		int control=_mm_movemask_epi8(_mm_cmplt_epi8(v,space))&~nonascii;
+		__m128i e=_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v,amp),_mm_cmpeq_epi8(v,quot)),
+			_mm_or_si128(_mm_cmpeq_epi8(v,apos),_mm_or_si128(_mm_cmpeq_epi8(v,lt),_mm_cmpeq_epi8(v,gt))));
+		if (nonascii) classes|=DCHK_CHAR_NONASCII;
+		if (control) classes|=DCHK_CHAR_CONTROL;
+		if (_mm_movemask_epi8(e)) classes|=DCHK_CHAR_ESCAPE;
+	}
+#endif
+	for (;i<len;i++) classes|=dchk_CharClass((unsigned char)domain[i]);
+	return classes;
+}
+
+static int dchk_Escape(const char *string, int len, char *buffer, int buffersize)
+/*!\brief Escape special characters of a string with known length
+ *
+ * \internal
+ * \returns Length of the escaped string without the terminating 0 byte, or -1 if the
+ * buffer is too small.
+ */
+{
+	int t=0, l;
+	const char *translate;
+	for (int i=0;i<len;i++) {
+		translate=dchk_EscapeChar((unsigned char)string[i],&l);
+		if (translate) {
+			if (t+l>=buffersize) return -1;
+			memcpy(buffer+t,translate,l);
+			t+=l;
+		} else {
+			if (t+1>=buffersize) return -1;
+			buffer[t++]=string[i];
+		}
+	}
+	buffer[t]=0;
+	return t;
+}
+
 int dchk_EscapeSpecialChars(const char *string, char *buffer, int buffersize)
 /*!\brief Escape some special characters, which are not allowed in XML
  *
@@ -354,46 +457,134 @@ int dchk_EscapeSpecialChars(const char *string, char *buffer, int buffersize)
 	if (!string) return 0;
 	if (!buffer) return 0;
 	if (buffersize==0) return 0;
-	unsigned char *p=(unsigned char*)string;
-	int t=0;
-	int l;
-	unsigned char c;
-	char *translate;
-	while ((c=p[0])) {
-		translate=NULL;
-		switch (c) {
-			case '&':
-				translate="&amp;";
-				break;
-			case '\"':
-				translate="&quot;";
-				break;
-			case '\'':
-				translate="&#039t;";
-				break;
-			case '<':
-				translate="&lt;";
-				break;
-			case '>':
-				translate="&gt;";
-				break;
-		}
-		if (translate) {
-			l=strlen(translate);
-			if (t+l<buffersize) {
-				strncpy(buffer+t,translate,l);
-				t+=l;
-			} else {
-				return 0;
-			}
-		} else {
-			if (t+1<buffersize) buffer[t]=c;
-			else return 0;
-			t++;
+	if (dchk_Escape(string,(int)strlen(string),buffer,buffersize)<0) return 0;
+	return 1;
+}
+
+
+static int dchk_IsLDHName(const char *name, int len)
+/*!\brief Check if a domain name consists of letters, digits and hyphens
+ *
+ * \internal
+ * \p name must already be mapped to lower case. Labels must not be empty and must not begin
+ * or end with a hyphen.
+ */
+{
+	int i, label=0;
+	char c;
+	for (i=0;i<len;i++) {
+		c=name[i];
+		if (c=='.') {
+			if (label==0 || name[i-1]=='-') return 0;
+			label=0;
+			continue;
 		}
-		p++;
+		if (c=='-') {
+			if (label==0) return 0;
+		} else if ((c<'a' || c>'z') && (c<'0' || c>'9')) return 0;
+		label++;
 	}
-	buffer[t]=0;
+	if (label==0 || name[len-1]=='-') return 0;
+	return 1;
+}
+
+int dchk_ValidateRecord(IRISLWZ_HANDLE *handle, DCHK_RECORD *r)
+/*!\brief Check the syntax of a single domain
+ *
+ * \internal
+ * If the domain name in \p r can not be valid, the status of the record is set to
+ * "invalid" and the record is marked as checked locally, so it is not sent to the server.
+ *
+ * \returns 1, if the record was marked as invalid, otherwise 0.
+ */
+{
+	char ace[256], authority[256];
+	int len, acelen, authlen;
+	if (r->checkedLocally) return 1;
+	len=(int)strlen(r->domain);
+	acelen=dchk_IDNA_ToASCII(r->domain,len,ace,sizeof(ace));
+	if (acelen<0) {
+		// A name in valid UTF-8 might only need a normalization we don't know, so the
+		// server has to decide. Anything else is definitely invalid.
+		if ((dchk_ClassifyDomain(r->domain,len)&DCHK_CHAR_NONASCII) && dchk_IsUTF8(r->domain,len)) return 0;
+	} else if (dchk_IsLDHName(ace,acelen)) {
+		if (!handle->authority || !handle->authority[0]) return 0;
+		authlen=dchk_IDNA_ToASCII(handle->authority,(int)strlen(handle->authority),authority,sizeof(authority));
+		// The domain must be below the authority
+		if (authlen<0 || (acelen>authlen && ace[acelen-authlen-1]=='.'
+			&& memcmp(ace+acelen-authlen,authority,authlen)==0)) return 0;
+	}
+	if (r->status) free(r->status);
+	r->status=strdup("invalid");
+	if (r->lastdatabaseupdate) free(r->lastdatabaseupdate);
+	r->lastdatabaseupdate=NULL;
+	r->checkedLocally=1;
+	return 1;
+}
+
+int dchk_ValidateDomainList(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list)
+/*!\brief Check the syntax of the domains in a list locally
+ *
+ * This function checks all domains of the \p list, before they are sent to the server.
+ * Domain names, which the server would reject anyway, get the status "invalid" and are
+ * skipped by \ref dchk_QueryDomainList, \ref dchk_QueryDomainListStriped and the engine.
+ * This saves space in the bundled requests and round trips to the server.
+ *
+ * A domain name is invalid, if
+ * - it has an empty label or a label longer than 63 bytes,
+ * - it is longer than 253 bytes,
+ * - a label contains other characters than letters, digits and hyphens or begins or ends
+ *   with a hyphen. Internationalized domain names are checked in their ASCII form
+ *   (see \ref dchk_ToASCII),
+ * - it is not below the authority of the handle (see \ref irislwz_SetAuthority).
+ *
+ * Internationalized domain names, which can not be converted by \ref dchk_ToASCII, are left
+ * to the server.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in,out] list pointer to DCHK_DOMAINLIST, which was created with dchk_NewDomainList
+ * \returns The number of domains in the list, which are invalid and will not be sent to the
+ * server.
+ *
+ * \see
+ * Use \ref dchk_SetLocalValidation to check lists automatically when they are queried.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	int filtered=0;
+	if (!handle) return 0;
+	if (!list) {
+		irislwz_SetError(handle,74025,"int dchk_ValidateDomainList(IRISLWZ_HANDLE *handle, ==> DCHK_DOMAINLIST *list <==)");
+		return 0;
+	}
+	for (DCHK_RECORD *r=list->first;r;r=r->next) filtered+=dchk_ValidateRecord(handle,r);
+	return filtered;
+}
+
+int dchk_SetLocalValidation(IRISLWZ_HANDLE *handle, int flag)
+/*!\brief Check the syntax of domain names before they are sent
+ *
+ * If this option is enabled, \ref dchk_QueryDomainList, \ref dchk_QueryDomainListStriped,
+ * \ref dchk_QueryDomain and \ref dchk_engine_SubmitDomain check the domain names with the
+ * rules described in \ref dchk_ValidateDomainList. Invalid names get the status "invalid"
+ * without being sent to the server. By default this option is disabled.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] flag 1 to enable the check, 0 to disable it
+ * \returns Always returns 1.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!handle) return 0;
+	handle->localValidation=(char)(flag&1);
 	return 1;
 }
 
@@ -426,6 +617,7 @@ int dchk_QueryDomain(IRISLWZ_HANDLE *handle, const char *domain, char **status,
 	r.domain=(char*)domain;
 	r.status=NULL;
 	r.lastdatabaseupdate=NULL;
+	r.checkedLocally=0;
 	r.next=NULL;
 	list.first=list.last=&r;
 	list.num=1;
@@ -444,6 +636,154 @@ int dchk_QueryDomain(IRISLWZ_HANDLE *handle, const char *domain, char **status,
 
 
 
+int dchk_BuildRequest(IRISLWZ_HANDLE *handle, DCHK_RECORD **next, int maxdomainsperquery, char *payload, DCHK_DOMAINLIST *domainset, int *validate)
+/*!\brief Build a request for a bundle of domains
+ *
+ * \internal
+ * This function does the work for \ref dchk_BuildBundle. The searchSets are assembled from
+ * precomputed fragments directly in the \p payload, only domain names with special
+ * characters are escaped.
+ *
+ * As the request is built by the library itself, it is known to be valid XML, as long as
+ * the domain names are valid UTF-8 without control characters. In this case \p validate
+ * is set to 0 and the request does not need to be validated again before it is sent.
+ *
+ * Records, which were marked as invalid by \ref dchk_ValidateDomainList, become part of the
+ * \p domainset, but are not sent. So domainset->num counts all records of the bundle, not
+ * only the searchSets. At least one domain must be left to send.
+ *
+ * \returns On success the function returns the length of the payload, in case of an error 0.
+ */
+{
+	int newlen,len,setlen,domainlen,namelen,acelen;
+	int count=0, skipped=0;
+	int classes;
+	const char *name;
+	char ace[256];
+	const char *searchSet;
+	int searchSetLen;
+	DCHK_RECORD *r=*next;
+	memcpy(payload,dchk_RequestHeader,sizeof(dchk_RequestHeader));
+	len=sizeof(dchk_RequestHeader)-1;
+	*validate=0;
+	domainset->first=r;
+	domainset->last=r;
+	while (r) {
+		// Domains, which were found invalid locally, stay in the domainset, but are not sent
+		if (r->checkedLocally) {
+			skipped++;
+			domainset->last=r;
+			r=r->next;
+			continue;
+		}
+		if (count>=maxdomainsperquery && maxdomainsperquery>0 && count>0) break;
+		name=r->domain;
+		domainlen=(int)strlen(name);
+		classes=dchk_ClassifyDomain(name,domainlen);
+		// IDNs are sent as A-labels, if the conversion is enabled and possible
+		if ((classes&DCHK_CHAR_NONASCII) && handle->idnToASCII) {
+			acelen=dchk_IDNA_ToASCII(name,domainlen,ace,sizeof(ace));
+			if (acelen>0) {
+				name=ace;
+				domainlen=acelen;
+				classes=dchk_ClassifyDomain(name,domainlen);
+			}
+		}
+		// if we have non ASCII chars in domain, we use entityClass "idn"
+		if (classes&DCHK_CHAR_NONASCII) {
+			searchSet=dchk_SearchSetIDN;
+			searchSetLen=sizeof(dchk_SearchSetIDN)-1;
+			if (!dchk_IsUTF8(name,domainlen)) *validate=1;
+		} else {
+			searchSet=dchk_SearchSetDomain;
+			searchSetLen=sizeof(dchk_SearchSetDomain)-1;
+		}
+		if (classes&DCHK_CHAR_CONTROL) *validate=1;
+		// The escaped domain name may not be longer than 1000 bytes. Domains without special
+		// characters are copied as they are. The "AddDomain" functions take already care that
+		// a domain name must not be longer than 512 bytes.
+		if (classes&DCHK_CHAR_ESCAPE) {
+			namelen=dchk_Escape(name,domainlen,payload+6000,1000);
+			if (namelen<0) {
+				irislwz_SetError(handle,74106,NULL);
+				return 0;
+			}
+		} else {
+			namelen=domainlen;
+		}
+		setlen=searchSetLen+namelen+sizeof(dchk_SearchSetEnd)-1;
+		newlen=len+setlen+sizeof(dchk_RequestFooter)-1;
+		if (count>0 && newlen+1>=5000) {
+			// We have only allocated 5000 bytes for uncompressed request packet and
+			// we have reached this limit
+			break;
+		}
+		// Append the searchSet
+		memcpy(payload+len,searchSet,searchSetLen);
+		if (classes&DCHK_CHAR_ESCAPE) memcpy(payload+len+searchSetLen,payload+6000,namelen);
+		else memcpy(payload+len+searchSetLen,name,namelen);
+		memcpy(payload+len+searchSetLen+namelen,dchk_SearchSetEnd,sizeof(dchk_SearchSetEnd)-1);
+		// Support compression? Deflate can make the payload only a few bytes bigger,
+		// so the compressed size has to be checked only if the request is close to
+		// the limit. Otherwise bundling would be quadratic in the number of domains.
+		// With IRISLWZ_COMPRESSION_AUTO the request is sent uncompressed, if compression
+		// does not pay, so there is nothing to check.
+		if (count>0 && handle->sendDeflated==IRISLWZ_COMPRESSION_ALWAYS && compressBound(newlen)>=5000) {
+			memcpy(payload+len+setlen,dchk_RequestFooter,sizeof(dchk_RequestFooter));
+			newlen=irislwz_DeflatedSize(handle,payload,newlen);
+			if (!newlen) {
+				irislwz_SetError(handle,74039,NULL);
+				return 0;
+			}
+			if (newlen>=5000) break;
+		}
+		// Request does fit, we add it permanently to payload
+		len+=setlen;
+		count++;
+		domainset->last=r;
+		r=r->next;
+	}
+	if (count==0) {
+		irislwz_SetError(handle,74038,NULL);
+		return 0;
+	}
+	// finalize request
+	memcpy(payload+len,dchk_RequestFooter,sizeof(dchk_RequestFooter));
+	len+=sizeof(dchk_RequestFooter)-1;
+	domainset->num=count+skipped;
+	*next=r;
+	return len;
+}
+
+int dchk_BuildBundle(IRISLWZ_HANDLE *handle, DCHK_RECORD **next, int maxdomainsperquery, char *payload, DCHK_DOMAINLIST *domainset)
+/*!\brief Bundle domains into a single request
+ *
+ * This function is used by \ref dchk_QueryDomainList and the engine. Starting with the record
+ * \p next points to, it bundles as many domains into the request \p payload as fit into a
+ * single request packet, but not more than \p maxdomainsperquery. At least one domain is
+ * bundled.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in,out] next Pointer to the first domain record to be bundled. After return, it points
+ * to the first record which was not bundled or NULL if the end of the list was reached.
+ * \param[in] maxdomainsperquery maximum number of domains which can be bundled to one request
+ * \param[out] payload Buffer of at least 7000 bytes, in which the XML request is constructed
+ * \param[out] domainset Pointer to an DCHK_DOMAINLIST object, which receives the bundled domains
+ *
+ * \returns
+ * On success the function returns 1, in case of an error 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	int validate;
+	if (!dchk_BuildRequest(handle,next,maxdomainsperquery,payload,domainset,&validate)) return 0;
+	return 1;
+}
+
 int dchk_QueryDomainList(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list, int maxdomainsperquery)
 /*!\brief Checks status of domains in domain list
  *
@@ -453,6 +793,18 @@ int dchk_QueryDomainList(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list, int maxd
  * many domains as fit into the request payload. For each bundled request it will call DoQuery
  * to do the actual DCHK call. The result for each domain is stored back in the list.
  *
+ * If a window greater than 1 was set with \ref irislwz_SetWindow, the bundled requests
+ * are pipelined: up to window requests are sent to the server before waiting for
+ * the answers, which may arrive in any order.
+ *
+ * If the handle has a server pool (see \ref irislwz_AddServer), each bundled request is sent to a
+ * server selected by priority and weight, and a request, which is not answered, is repeated
+ * on another server. Pipelined requests are all sent to the same server, use
+ * \ref dchk_QueryDomainListStriped to spread them across the pool.
+ *
+ * Domains, which were marked as invalid by \ref dchk_ValidateDomainList, are not sent. If
+ * \ref dchk_SetLocalValidation was enabled, the list is checked before.
+ *
  * \param[in] handle pointer to an IRISLWZ_HANDLE object
  * \param[in,out] list pointer to DCHK_DOMAINLIST, which was created with dchk_NewDomainList
  * and filled with dchk_AddDomain
@@ -474,111 +826,91 @@ int dchk_QueryDomainList(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list, int maxd
 		return 0;
 	}
 	if (maxdomainsperquery<0) maxdomainsperquery=0;
+	if (handle->localValidation) dchk_ValidateDomainList(handle,list);
+	// Nothing to send, if all domains were found invalid locally
+	DCHK_RECORD *r=list->first;
+	while (r && r->checkedLocally) r=r->next;
+	if (!r) return 1;
 	// We need a buffer for the request payload
 	// We allocate 5000 bytes for complete uncompressed payload an 1000 bytes
-	// for a single searchSet
+	// for a single searchSet and 1000 bytes for escaping
 	char *payload=(char*)malloc(7000);
-	// A buffer for the searchSet
-	char *searchSet=payload+5000;
-	// And a buffer for escaping special characters in domain name
-	char *escaped=payload+6000;
-	int newlen,len=0;
 	if (!payload) {
 		irislwz_SetError(handle,74024,NULL);
 		return 0;
 	}
-	payload[0]=0;
-	DCHK_RECORD *r=list->first;
-	DCHK_DOMAINLIST domainset;
-	domainset.first=r;
-	int count=0;
-	int i;
-	char *entityClass;
-	while (r) {
-		if (len==0) {			// Do we already have data?
-			sprintf(payload,"<iris1:request xmlns:iris1=\"urn:ietf:params:xml:ns:iris1\">");
-			len=strlen(payload);
-		}
-		// For plain ASCII domains, entityClass is "domain-name"
-		entityClass="domain-name";
-		// if we have non ASCII chars in domain, we use entityClass "idn"
-		for (i=0;r->domain[i]!=0;i++) {
-			if ((r->domain[i])&128) {
-				entityClass="idn";
-				break;
+	if (handle->window<=1) {
+		DCHK_DOMAINLIST domainset;
+		int servers=irislwz_GetServerCount(handle);
+		int tries, bytes, validate;
+		while (r) {
+			bytes=dchk_BuildRequest(handle,&r,maxdomainsperquery,payload,&domainset,&validate);
+			if (!bytes) {
+				free(payload);
+				return 0;
 			}
-		}
-		// We have to handle some special characters, which are not allowed in XML: & < >
-		if (!dchk_EscapeSpecialChars(r->domain,escaped,1000)) {
-			free(payload);
-			irislwz_SetError(handle,74106,NULL);
-			return 0;
-		}
-
-		// Build the searchSet. The "AddDomain" functions take already care that a domain name
-		// must not be longer than 512 bytes, therefore we don't need to check the size here
-		sprintf(searchSet,"<iris1:searchSet>"
-			"<iris1:lookupEntity registryType=\"dchk1\" entityClass=\"%s\" "
-			"entityName=\"%s\"/>"
-			"</iris1:searchSet>", entityClass,escaped);
-		// does query fit in request packet size?
-		if (strlen(payload)+strlen(searchSet)+17>=5000) {
-			// We have only allocated 5000 bytes for uncompressed request packet and
-			// we have reached this limit
-			newlen=99999;
-		} else {
-			strcat(payload,searchSet);
-			strcat(payload,"</iris1:request>");
-			newlen=strlen(payload);
-			// Support compression?
-			if (handle->sendDeflated) {
-				newlen=irislwz_GetCompressedSize(payload,newlen,handle->rfc1950_workaround);
-				if (!newlen) {
-					irislwz_SetError(handle,74039,NULL);
+			if (servers<2) {
+				if (!dchk_DoQuery(handle,&domainset,payload,bytes,validate)) {
 					free(payload);
 					return 0;
 				}
+				continue;
 			}
-		}
-		if (newlen<5000 && (count<maxdomainsperquery || maxdomainsperquery==0)) {
-			// Request does fit, we add it permanently to payload
-			payload[len]=0;
-			strcat(payload,searchSet);
-			len=strlen(payload);
-			count++;
-		} else {
-			// Request does not fit or we reached maximum number of domains per query
-			// Remove next searchSet
-			payload[len]=0;
-			// finalize request
-			strcat(payload,"</iris1:request>");
-			domainset.num=count;
-			if (!dchk_DoQuery(handle,&domainset,payload)) {
+			// With a server pool every bundle goes to a server selected by priority and
+			// weight. If the server does not answer, the bundle is sent to another one.
+			for (tries=0;tries<servers;tries++) {
+				if (irislwz_SelectServer(handle) && dchk_DoQuery(handle,&domainset,payload,bytes,validate)) break;
+				if (handle->error<1000 || handle->error>1999) {
+					tries=servers;
+					break;
+				}
+				irislwz_ServerFailed(handle);
+			}
+			if (tries>=servers) {
 				free(payload);
 				return 0;
 			}
-			domainset.first=r;
-			sprintf(payload,"<iris1:request xmlns:iris1=\"urn:ietf:params:xml:ns:iris1\">");
-			strcat(payload,searchSet);
-			len=strlen(payload);
-			count=1;
 		}
-		domainset.last=r;
-		r=r->next;
+		free(payload);
+		return 1;
+	}
+	// Pipelined queries. Each outstanding request gets its own domainset, which is passed
+	// as privatedata to the pipeline
+	int window=handle->window;
+	DCHK_DOMAINLIST *sets=(DCHK_DOMAINLIST*)malloc(window*(sizeof(DCHK_DOMAINLIST)+sizeof(DCHK_DOMAINLIST*)));
+	if (!sets) {
+		free(payload);
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
 	}
-	if (count) {
-		strcat(payload,"</iris1:request>");
-		domainset.num=count;
-		if (!dchk_DoQuery(handle,&domainset,payload)) {
-			free(payload);
-			return 0;
+	DCHK_DOMAINLIST **freesets=(DCHK_DOMAINLIST**)(sets+window);
+	DCHK_DOMAINLIST *domainset;
+	int i, numfree=window, ret=1, bytes, validate;
+	for (i=0;i<window;i++) freesets[i]=&sets[i];
+	while (r || irislwz_PipelineOutstanding(handle)) {
+		if (r && numfree>0) {
+			domainset=freesets[--numfree];
+			bytes=dchk_BuildRequest(handle,&r,maxdomainsperquery,payload,domainset,&validate);
+			if (!bytes || !irislwz_PipelineSendPayload(handle,payload,bytes,domainset,validate)) {
+				ret=0;
+				break;
+			}
+			continue;
 		}
+		if (!irislwz_PipelineReceive(handle,(void**)&domainset)
+			|| !irislwz_CheckResponse(handle)
+			|| !dchk_XML_ParseResult(handle,domainset)) {
+			ret=0;
+			break;
+		}
+		freesets[numfree++]=domainset;
 	}
+	irislwz_PipelineReset(handle);
+	free(sets);
 	free(payload);
-	return 1;
+	return ret;
 }
 
-
 int dchk_PrintResults(DCHK_DOMAINLIST *list)
 /*!\brief Print the contents of a DCHK_DOMAINLIST to STDOUT
  *
@@ -0,0 +1,690 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+#ifdef HAVE_STRINGS_H
+	#include <strings.h>
+#endif
+#ifdef HAVE_ERRNO_H
+	#include <errno.h>
+#endif
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <Ws2tcpip.h>
+	#include <windows.h>
+	#include <io.h>
+	#include <fcntl.h>
+	#include <sys/stat.h>
+	#define DCHK_HAVE_THREADS
+#else
+	#ifdef HAVE_PTHREAD_H
+		#include <pthread.h>
+		#define DCHK_HAVE_THREADS
+	#endif
+#endif
+
+#ifdef HAVE_UNISTD_H
+    #include <unistd.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+    #include <sys/stat.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+    #include <sys/socket.h>
+#endif
+#ifdef HAVE_NETINET_IN_H
+    #include <netinet/in.h>
+#endif
+#ifdef HAVE_NETDB_H
+    #include <netdb.h>
+#endif
+#include <time.h>
+
+#include "dchk.h"
+#include "compat.h"
+
+#define DCHK_DNSCACHE_NEGATIVETTL	900			// Seconds a failed lookup is cached by default
+
+#ifdef _WIN32
+	typedef CRITICAL_SECTION DCHK_MUTEX;
+	#define dchk_MutexInit(m)		InitializeCriticalSection(m)
+	#define dchk_MutexDestroy(m)	DeleteCriticalSection(m)
+	#define dchk_MutexLock(m)		EnterCriticalSection(m)
+	#define dchk_MutexUnlock(m)		LeaveCriticalSection(m)
+#elif defined(DCHK_HAVE_THREADS)
+	typedef pthread_mutex_t DCHK_MUTEX;
+	#define dchk_MutexInit(m)		pthread_mutex_init(m,NULL)
+	#define dchk_MutexDestroy(m)	pthread_mutex_destroy(m)
+	#define dchk_MutexLock(m)		pthread_mutex_lock(m)
+	#define dchk_MutexUnlock(m)		pthread_mutex_unlock(m)
+#else
+	typedef int DCHK_MUTEX;
+	#define dchk_MutexInit(m)
+	#define dchk_MutexDestroy(m)
+	#define dchk_MutexLock(m)
+	#define dchk_MutexUnlock(m)
+#endif
+
+/*!\brief A server found by a SRV record
+ *
+ * \internal
+ */
+typedef struct {
+	char *host;
+	int port;
+	int priority;
+	int weight;
+	struct sockaddr_storage *addr;	// resolved addresses including the port
+	int *addrlen;
+	int numaddr;					// -1 if the server could not be resolved
+} DCHK_DNSCACHE_SERVER;
+
+/*!\brief Result of the discovery of a TLD
+ *
+ * \internal
+ */
+typedef struct {
+	char *tld;
+	char *replacement;				// NAPTR replacement or NULL for failed lookups
+	time_t expires;
+	int error;						// error code of a failed lookup or 0
+	DCHK_DNSCACHE_SERVER *servers;
+	int numservers;
+} DCHK_DNSCACHE_ENTRY;
+
+struct __dchk_dnscache {
+	DCHK_MUTEX mutex;
+	DCHK_DNSCACHE_ENTRY *entries;
+	int num;
+	int size;
+	int negativettl;
+	volatile long refcount;			// Owner and configurations using the cache
+};
+
+DCHK_DNSCACHE *dchk_NewDNSCache()
+/*!\brief Create an empty discovery cache
+ *
+ * \ref dchk_SetHostByDNS needs a NAPTR and a SRV query and resolves the servers found before
+ * the first request can be sent. A discovery cache keeps the result of these lookups for each
+ * TLD as long as the TTL of the DNS records allows, including the addresses of the servers.
+ * TLDs without DCHK server are cached, too, for 15 minutes by default (see
+ * \ref dchk_SetDNSCacheNegativeTTL). Temporary DNS errors are not cached.
+ *
+ * The cache is used by a handle after \ref dchk_SetDNSCache. It can be saved to a file with
+ * \ref dchk_SaveDNSCache and loaded again with \ref dchk_LoadDNSCache, so programs, which
+ * only run for a short time, don't need any DNS lookup as long as the records are valid.
+ *
+ * \returns Pointer to the new cache or NULL, if not enough memory is available.
+ *
+ * \example
+ * \code
+IRISLWZ_HANDLE handle;
+irislwz_Init(&handle);
+DCHK_DNSCACHE *cache=dchk_NewDNSCache();
+dchk_LoadDNSCache(&handle,cache,"/var/tmp/dchk.cache");
+dchk_SetDNSCache(&handle,cache);
+if (dchk_SetHostByDNS(&handle,"de")) {
+	...
+}
+dchk_SaveDNSCache(&handle,cache,"/var/tmp/dchk.cache");
+irislwz_Exit(&handle);
+dchk_FreeDNSCache(cache);
+ * \endcode
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	DCHK_DNSCACHE *cache=(DCHK_DNSCACHE*)calloc(1,sizeof(DCHK_DNSCACHE));
+	if (!cache) return NULL;
+	cache->negativettl=DCHK_DNSCACHE_NEGATIVETTL;
+	cache->refcount=1;
+	dchk_MutexInit(&cache->mutex);
+	return cache;
+}
+
+DCHK_DNSCACHE *dchk_RetainDNSCache(DCHK_DNSCACHE *cache)
+/*!\brief Add a reference to a discovery cache
+ *
+ * \internal
+ * Used by configurations, which keep the cache of their handle. Each call must be followed by
+ * a call to \ref dchk_FreeDNSCache.
+ */
+{
+	if (cache) irislwz_AtomicIncrement(&cache->refcount);
+	return cache;
+}
+
+static void dchk_dnscache_FreeEntry(DCHK_DNSCACHE_ENTRY *e)
+{
+	int i;
+	for (i=0;i<e->numservers;i++) {
+		if (e->servers[i].host) free(e->servers[i].host);
+		if (e->servers[i].addr) free(e->servers[i].addr);
+		if (e->servers[i].addrlen) free(e->servers[i].addrlen);
+	}
+	if (e->servers) free(e->servers);
+	if (e->tld) free(e->tld);
+	if (e->replacement) free(e->replacement);
+	bzero(e,sizeof(DCHK_DNSCACHE_ENTRY));
+}
+
+void dchk_FreeDNSCache(DCHK_DNSCACHE *cache)
+/*!\brief Free a discovery cache
+ *
+ * The cache must not be used by a handle anymore. If configurations created with
+ * \ref irislwz_NewConfig still use the cache, it is freed after the last of them.
+ *
+ * \param[in] cache pointer to a cache created with \ref dchk_NewDNSCache
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!cache) return;
+	if (irislwz_AtomicDecrement(&cache->refcount)>0) return;
+	int i;
+	for (i=0;i<cache->num;i++) dchk_dnscache_FreeEntry(&cache->entries[i]);
+	if (cache->entries) free(cache->entries);
+	dchk_MutexDestroy(&cache->mutex);
+	free(cache);
+}
+
+int dchk_SetDNSCacheNegativeTTL(DCHK_DNSCACHE *cache, int seconds)
+/*!\brief Set the time, for which failed lookups are cached
+ *
+ * \param[in] cache pointer to a cache created with \ref dchk_NewDNSCache
+ * \param[in] seconds Number of seconds, 0 disables caching of failed lookups
+ * \returns On success, the function returns 1, otherwise 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!cache || seconds<0) return 0;
+	cache->negativettl=seconds;
+	return 1;
+}
+
+int dchk_SetDNSCache(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache)
+/*!\brief Use a discovery cache for \ref dchk_SetHostByDNS
+ *
+ * The cache is not copied. It must not be freed as long as it is used by the handle or by
+ * handles cloned from it. Configurations created from the handle keep their own reference to
+ * the cache (see \ref irislwz_NewConfig). Any number of handles and threads can use the same
+ * cache at the same time.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] cache pointer to a cache created with \ref dchk_NewDNSCache or NULL to remove the
+ * cache from the handle
+ * \returns On success, the function returns 1, otherwise 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!handle) return 0;
+	handle->dnscache=cache;
+	return 1;
+}
+
+static DCHK_DNSCACHE_ENTRY *dchk_dnscache_Find(DCHK_DNSCACHE *cache, const char *tld)
+{
+	int i;
+	for (i=0;i<cache->num;i++) {
+		if (strcasecmp(cache->entries[i].tld,tld)==0) return &cache->entries[i];
+	}
+	return NULL;
+}
+
+static int dchk_dnscache_Store(DCHK_DNSCACHE *cache, DCHK_DNSCACHE_ENTRY *e)
+/*!\brief Add an entry to the cache or replace the entry of the same TLD
+ *
+ * \internal
+ * The cache must be locked. The entry is moved into the cache, on error it is freed.
+ */
+{
+	DCHK_DNSCACHE_ENTRY *old=dchk_dnscache_Find(cache,e->tld);
+	if (old) {
+		dchk_dnscache_FreeEntry(old);
+		*old=*e;
+		return 1;
+	}
+	if (cache->num>=cache->size) {
+		int size=cache->size ? cache->size*2 : 16;
+		DCHK_DNSCACHE_ENTRY *entries=(DCHK_DNSCACHE_ENTRY*)realloc(cache->entries,size*sizeof(DCHK_DNSCACHE_ENTRY));
+		if (!entries) {
+			dchk_dnscache_FreeEntry(e);
+			return 0;
+		}
+		cache->entries=entries;
+		cache->size=size;
+	}
+	cache->entries[cache->num++]=*e;
+	return 1;
+}
+
+static int dchk_dnscache_AddServer(DCHK_DNSCACHE_ENTRY *e, const char *host, int port, int priority, int weight)
+{
+	DCHK_DNSCACHE_SERVER *servers=(DCHK_DNSCACHE_SERVER*)realloc(e->servers,(e->numservers+1)*sizeof(DCHK_DNSCACHE_SERVER));
+	if (!servers) return 0;
+	e->servers=servers;
+	DCHK_DNSCACHE_SERVER *srv=&servers[e->numservers];
+	bzero(srv,sizeof(DCHK_DNSCACHE_SERVER));
+	srv->host=strdup(host);
+	if (!srv->host) return 0;
+	srv->port=port;
+	srv->priority=priority;
+	srv->weight=weight;
+	srv->numaddr=-1;
+	e->numservers++;
+	return 1;
+}
+
+static int dchk_dnscache_AddAddress(DCHK_DNSCACHE_SERVER *srv, const struct sockaddr_storage *addr, int addrlen)
+{
+	int num=srv->numaddr<0 ? 0 : srv->numaddr;
+	struct sockaddr_storage *a=(struct sockaddr_storage*)realloc(srv->addr,(num+1)*sizeof(struct sockaddr_storage));
+	if (!a) return 0;
+	srv->addr=a;
+	int *l=(int*)realloc(srv->addrlen,(num+1)*sizeof(int));
+	if (!l) return 0;
+	srv->addrlen=l;
+	memcpy(&srv->addr[num],addr,sizeof(struct sockaddr_storage));
+	srv->addrlen[num]=addrlen;
+	srv->numaddr=num+1;
+	return 1;
+}
+
+int dchk_GetCachedServers(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, const char *tld)
+/*!\brief Fill the server pool of a handle from the discovery cache
+ *
+ * \internal
+ * \returns 1, if the servers of the TLD were found in the cache, 0, if a failed lookup was
+ * found in the cache or an error occurred, and -1, if the TLD is not cached or expired.
+ */
+{
+	int i, error;
+	dchk_MutexLock(&cache->mutex);
+	DCHK_DNSCACHE_ENTRY *e=dchk_dnscache_Find(cache,tld);
+	if (!e || e->expires<=time(NULL)) {
+		dchk_MutexUnlock(&cache->mutex);
+		return -1;
+	}
+	if (e->error) {
+		error=e->error;
+		dchk_MutexUnlock(&cache->mutex);
+		irislwz_SetError(handle,error,"%s (cached)",tld);
+		return 0;
+	}
+	irislwz_ClearServers(handle);
+	for (i=0;i<e->numservers;i++) {
+		DCHK_DNSCACHE_SERVER *srv=&e->servers[i];
+		if (!irislwz_AddServer(handle,srv->host,srv->port,srv->priority,srv->weight)
+			|| (srv->numaddr>=0 && !irislwz_SetServerAddresses(handle,i,srv->addr,srv->addrlen,srv->numaddr))) {
+			dchk_MutexUnlock(&cache->mutex);
+			return 0;
+		}
+	}
+	dchk_MutexUnlock(&cache->mutex);
+	return 1;
+}
+
+void dchk_CacheServers(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, const char *tld, const char *replacement, int ttl)
+/*!\brief Store the server pool of a handle in the discovery cache
+ *
+ * \internal
+ * All servers of the pool are resolved, so their addresses can be cached, too. They are valid
+ * as long as the NAPTR and SRV records, as the resolver does not tell their TTL.
+ */
+{
+	int i, k, num, port, priority, weight;
+	const char *host;
+	const struct sockaddr_storage *addr;
+	const int *addrlen;
+	DCHK_DNSCACHE_ENTRY e;
+	bzero(&e,sizeof(DCHK_DNSCACHE_ENTRY));
+	e.tld=strdup(tld);
+	e.replacement=strdup(replacement);
+	e.expires=time(NULL)+(ttl>0 ? ttl : 0);
+	if (!e.tld || !e.replacement) {
+		dchk_dnscache_FreeEntry(&e);
+		return;
+	}
+	for (i=0;i<irislwz_GetServerCount(handle);i++) {
+		irislwz_GetServer(handle,i,&host,&port,&priority,&weight);
+		if (!dchk_dnscache_AddServer(&e,host,port,priority,weight)) {
+			dchk_dnscache_FreeEntry(&e);
+			return;
+		}
+		// A server, which can not be resolved now, is resolved again on first use
+		num=irislwz_GetServerAddresses(handle,i,&addr,&addrlen);
+		if (num<0) continue;
+		e.servers[i].numaddr=0;
+		for (k=0;k<num;k++) {
+			if (!dchk_dnscache_AddAddress(&e.servers[i],&addr[k],addrlen[k])) {
+				dchk_dnscache_FreeEntry(&e);
+				return;
+			}
+		}
+	}
+	dchk_MutexLock(&cache->mutex);
+	dchk_dnscache_Store(cache,&e);
+	dchk_MutexUnlock(&cache->mutex);
+}
+
+void dchk_CacheFailure(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, const char *tld)
+/*!\brief Store a failed lookup in the discovery cache
+ *
+ * \internal
+ * Only errors meaning, that the TLD has no DCHK server, are cached. Timeouts and other
+ * temporary errors are not.
+ */
+{
+	int error=handle->error;
+	if (error!=74002 && error!=74004 && error!=74005 && error!=74006 && error!=74008) return;
+	if (cache->negativettl<=0) return;
+	DCHK_DNSCACHE_ENTRY e;
+	bzero(&e,sizeof(DCHK_DNSCACHE_ENTRY));
+	e.tld=strdup(tld);
+	if (!e.tld) return;
+	e.error=error;
+	e.expires=time(NULL)+cache->negativettl;
+	dchk_MutexLock(&cache->mutex);
+	dchk_dnscache_Store(cache,&e);
+	dchk_MutexUnlock(&cache->mutex);
+}
+
+static char *dchk_dnscache_NextToken(char **p)
+{
+	char *token;
+	while (**p==' ' || **p=='\t') (*p)++;
+	if (**p==0) return NULL;
+	token=*p;
+	while (**p && **p!=' ' && **p!='\t') (*p)++;
+	if (**p) *(*p)++=0;
+	return token;
+}
+
+static int dchk_dnscache_ParseAddress(DCHK_DNSCACHE_SERVER *srv, const char *address)
+/*!\brief Add a numeric address, as written by \ref dchk_SaveDNSCache, to a server
+ *
+ * \internal
+ */
+{
+	struct addrinfo hints, *res;
+	int ret;
+	bzero(&hints,sizeof(struct addrinfo));
+	hints.ai_family=AF_UNSPEC;
+	hints.ai_socktype=SOCK_DGRAM;
+	hints.ai_flags=AI_NUMERICHOST;
+	if (getaddrinfo(address,NULL,&hints,&res)!=0) return 0;
+	struct sockaddr_storage addr;
+	bzero(&addr,sizeof(struct sockaddr_storage));
+	ret=0;
+	if (res->ai_addrlen<=sizeof(struct sockaddr_storage)) {
+		memcpy(&addr,res->ai_addr,res->ai_addrlen);
+		if (res->ai_family==AF_INET) ((struct sockaddr_in*)&addr)->sin_port=htons(srv->port);
+		else if (res->ai_family==AF_INET6) ((struct sockaddr_in6*)&addr)->sin6_port=htons(srv->port);
+		ret=dchk_dnscache_AddAddress(srv,&addr,(int)res->ai_addrlen);
+	}
+	freeaddrinfo(res);
+	return ret;
+}
+
+int dchk_LoadDNSCache(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, const char *filename)
+/*!\brief Load a discovery cache from a file
+ *
+ * The entries of the file, which were written by \ref dchk_SaveDNSCache, are added to the
+ * \p cache. Expired entries are skipped. If the file does not exist, the cache is not changed
+ * and the function succeeds.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object, which receives the error
+ * \param[in] cache pointer to a cache created with \ref dchk_NewDNSCache
+ * \param[in] filename name of the file
+ * \returns On success, the function returns 1, otherwise 0. Entries of the file in front of
+ * an invalid line stay in the cache.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!handle) return 0;
+	if (!cache) {
+		irislwz_SetError(handle,74025,"int dchk_LoadDNSCache(IRISLWZ_HANDLE *handle, ==> DCHK_DNSCACHE *cache <==, const char *filename)");
+		return 0;
+	}
+	if (!filename) {
+		irislwz_SetError(handle,74025,"int dchk_LoadDNSCache(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, ==> const char *filename <==)");
+		return 0;
+	}
+	FILE *fp=fopen(filename,"rb");
+	if (!fp) {
+		if (errno==ENOENT) return 1;
+		irislwz_SetError(handle,74059,"%s",filename);
+		return 0;
+	}
+	char line[4096];
+	char *p, *type, *token[5];
+	int i, len, num=0, ok=1;
+	time_t now=time(NULL);
+	DCHK_DNSCACHE_ENTRY e;
+	bzero(&e,sizeof(DCHK_DNSCACHE_ENTRY));
+	dchk_MutexLock(&cache->mutex);
+	while (ok && fgets(line,sizeof(line),fp)) {
+		num++;
+		len=(int)strlen(line);
+		if (len==sizeof(line)-1 && line[len-1]!='\n' && !feof(fp)) {
+			ok=0;
+			break;
+		}
+		while (len>0 && (unsigned char)line[len-1]<=' ') line[--len]=0;
+		p=line;
+		type=dchk_dnscache_NextToken(&p);
+		if (!type || type[0]=='#') continue;
+		for (i=0;i<4;i++) token[i]=dchk_dnscache_NextToken(&p);
+		if (strcmp(type,"tld")==0) {
+			// tld <tld> <expires> <error> <replacement>
+			if (e.tld) {
+				if (e.expires>now) dchk_dnscache_Store(cache,&e);
+				else dchk_dnscache_FreeEntry(&e);
+			}
+			bzero(&e,sizeof(DCHK_DNSCACHE_ENTRY));
+			if (!token[3]) {
+				ok=0;
+				break;
+			}
+			e.tld=strdup(token[0]);
+			e.expires=(time_t)strtol(token[1],NULL,10);
+			e.error=atoi(token[2]);
+			if (strcmp(token[3],"-")!=0) e.replacement=strdup(token[3]);
+			if (!e.tld || (!e.error && !e.replacement)) ok=0;
+		} else if (strcmp(type,"server")==0) {
+			// server <host> <port> <priority> <weight> [-|<address>...]
+			if (!e.tld || e.error || !token[3]
+				|| !dchk_dnscache_AddServer(&e,token[0],atoi(token[1]),atoi(token[2]),atoi(token[3]))) {
+				ok=0;
+				break;
+			}
+			DCHK_DNSCACHE_SERVER *srv=&e.servers[e.numservers-1];
+			token[4]=dchk_dnscache_NextToken(&p);
+			if (token[4] && strcmp(token[4],"-")==0) continue;
+			srv->numaddr=0;
+			while (token[4]) {
+				if (!dchk_dnscache_ParseAddress(srv,token[4])) {
+					ok=0;
+					break;
+				}
+				token[4]=dchk_dnscache_NextToken(&p);
+			}
+		} else {
+			ok=0;
+		}
+	}
+	if (ok && e.tld && e.expires>now) dchk_dnscache_Store(cache,&e);
+	else dchk_dnscache_FreeEntry(&e);
+	dchk_MutexUnlock(&cache->mutex);
+	fclose(fp);
+	if (!ok) {
+		irislwz_SetError(handle,74109,"%s:%i",filename,num);
+		return 0;
+	}
+	return 1;
+}
+
+int dchk_SaveDNSCache(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, const char *filename)
+/*!\brief Save a discovery cache to a file
+ *
+ * All entries, which are not expired, are written to the file, which can be loaded with
+ * \ref dchk_LoadDNSCache. The file is written to a new temporary file with a unique name in
+ * the same directory, which is renamed afterwards. So programs reading it at the same time
+ * never see an incomplete file, and several programs can save the same cache file. The file
+ * keeps the permissions of the existing file, a new file gets the permissions allowed by
+ * the umask.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object, which receives the error
+ * \param[in] cache pointer to a cache created with \ref dchk_NewDNSCache
+ * \param[in] filename name of the file
+ * \returns On success, the function returns 1, otherwise 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!handle) return 0;
+	if (!cache) {
+		irislwz_SetError(handle,74025,"int dchk_SaveDNSCache(IRISLWZ_HANDLE *handle, ==> DCHK_DNSCACHE *cache <==, const char *filename)");
+		return 0;
+	}
+	if (!filename) {
+		irislwz_SetError(handle,74025,"int dchk_SaveDNSCache(IRISLWZ_HANDLE *handle, DCHK_DNSCACHE *cache, ==> const char *filename <==)");
+		return 0;
+	}
+	char *tmpname=(char*)malloc(strlen(filename)+8);
+	if (!tmpname) {
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	// The temporary file must not exist yet, so an existing file or symbolic link with the
+	// same name is never overwritten
+	sprintf(tmpname,"%s.XXXXXX",filename);
+	FILE *fp=NULL;
+	int fd=-1;
+#ifdef _WIN32
+	if (_mktemp_s(tmpname,strlen(tmpname)+1)==0) {
+		fd=_open(tmpname,_O_CREAT|_O_EXCL|_O_WRONLY|_O_BINARY,_S_IREAD|_S_IWRITE);
+	}
+	if (fd>=0) fp=_fdopen(fd,"wb");
+	if (fd>=0 && !fp) _close(fd);
+#else
+	fd=mkstemp(tmpname);
+	if (fd>=0) {
+		// mkstemp creates the file with mode 0600
+		struct stat st;
+		mode_t mode;
+		if (stat(filename,&st)==0) {
+			mode=st.st_mode&07777;
+		} else {
+			mode=umask(0);
+			umask(mode);
+			mode=0666&~mode;
+		}
+		fchmod(fd,mode);
+		fp=fdopen(fd,"wb");
+	}
+	if (fd>=0 && !fp) close(fd);
+#endif
+	if (!fp) {
+		if (fd>=0) remove(tmpname);
+		irislwz_SetError(handle,74110,"%s",tmpname);
+		free(tmpname);
+		return 0;
+	}
+	int i, s, k;
+	char address[NI_MAXHOST];
+	time_t now=time(NULL);
+	fprintf(fp,"# DCHK discovery cache\n"
+		"# tld <tld> <expires> <error> <NAPTR replacement>\n"
+		"# server <host> <port> <priority> <weight> <addresses or - if not resolved>\n");
+	dchk_MutexLock(&cache->mutex);
+	for (i=0;i<cache->num;i++) {
+		DCHK_DNSCACHE_ENTRY *e=&cache->entries[i];
+		if (e->expires<=now) continue;
+		fprintf(fp,"tld %s %ld %i %s\n",e->tld,(long)e->expires,e->error,
+			e->replacement ? e->replacement : "-");
+		for (s=0;s<e->numservers;s++) {
+			DCHK_DNSCACHE_SERVER *srv=&e->servers[s];
+			fprintf(fp,"server %s %i %i %i",srv->host,srv->port,srv->priority,srv->weight);
+			if (srv->numaddr<0) fprintf(fp," -");
+			for (k=0;k<srv->numaddr;k++) {
+				if (getnameinfo((struct sockaddr*)&srv->addr[k],srv->addrlen[k],address,sizeof(address),
+					NULL,0,NI_NUMERICHOST)==0) fprintf(fp," %s",address);
+			}
+			fprintf(fp,"\n");
+		}
+	}
+	dchk_MutexUnlock(&cache->mutex);
+	if (fclose(fp)!=0) {
+		remove(tmpname);
+		irislwz_SetError(handle,74110,"%s",tmpname);
+		free(tmpname);
+		return 0;
+	}
+#ifdef _WIN32
+	// rename does not replace existing files on Windows
+	remove(filename);
+#endif
+	if (rename(tmpname,filename)!=0) {
+		remove(tmpname);
+		irislwz_SetError(handle,74110,"%s",filename);
+		free(tmpname);
+		return 0;
+	}
+	free(tmpname);
+	return 1;
+}
@@ -0,0 +1,691 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#define _GNU_SOURCE
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STDIO_H
+	#include <stdio.h>
+#endif
+
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+#ifdef HAVE_STRINGS_H
+	#include <strings.h>
+#endif
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+    #include <unistd.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+    #include <sys/socket.h>
+#endif
+#ifdef HAVE_SYS_POLL_H
+    #include <sys/poll.h>
+#endif
+#ifdef __linux__
+	#include <sys/epoll.h>
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+
+
+/*!\brief A domain submitted to the engine
+ *
+ * \internal
+ * The record must be the first member, so the domain can be linked into a DCHK_DOMAINLIST.
+ */
+typedef struct {
+	DCHK_RECORD record;
+	void (*callback)(DCHK_ENGINE *engine, DCHK_RECORD *record, int error, void *privatedata);
+	void *privatedata;
+} DCHK_ENGINE_DOMAIN;
+
+/*!\brief A request handled by the engine
+ *
+ * \internal
+ * A job is either a bundle of domains (domainset.num>0) or a raw payload.
+ */
+typedef struct __dchk_engine_job {
+	struct __dchk_engine_job *next;
+	DCHK_DOMAINLIST domainset;
+	char *payload;
+	int bytes;
+	int validate;						// 0, if the payload was built by dchk_BuildRequest
+	void (*callback)(DCHK_ENGINE *engine, IRISLWZ_HANDLE *handle, int error, void *privatedata);
+	void *privatedata;
+} DCHK_ENGINE_JOB;
+
+typedef struct {
+	DCHK_DOMAINLIST domains;			// Domains waiting to be bundled
+	DCHK_ENGINE_JOB *first, *last;		// Payloads waiting to be sent
+	DCHK_ENGINE_JOB *freejobs;			// Unused job objects
+	char *buffer;						// Buffer for dchk_BuildRequest
+} DCHK_ENGINE_QUEUE;
+
+static void dchk_engine_FreeDomain(DCHK_ENGINE_DOMAIN *d)
+{
+	if (d->record.domain) free(d->record.domain);
+	if (d->record.status) free(d->record.status);
+	if (d->record.lastdatabaseupdate) free(d->record.lastdatabaseupdate);
+	free(d);
+}
+
+static DCHK_ENGINE_JOB *dchk_engine_NewJob(DCHK_ENGINE *engine)
+{
+	DCHK_ENGINE_QUEUE *q=(DCHK_ENGINE_QUEUE*)engine->queue;
+	DCHK_ENGINE_JOB *job=q->freejobs;
+	if (job) q->freejobs=job->next;
+	else job=(DCHK_ENGINE_JOB*)malloc(sizeof(DCHK_ENGINE_JOB));
+	if (!job) {
+		irislwz_SetError(engine->handle,74024,NULL);
+		return NULL;
+	}
+	memset(job,0,sizeof(DCHK_ENGINE_JOB));
+	return job;
+}
+
+static void dchk_engine_Complete(DCHK_ENGINE *engine, DCHK_ENGINE_JOB *job, int error)
+/*!\brief Deliver the result of a job to the callback functions
+ *
+ * \internal
+ * \param[in] engine pointer to the DCHK_ENGINE object
+ * \param[in] job The finished job
+ * \param[in] error 0, if an answer was received, otherwise the error code. For domain
+ * bundles the answer is checked and parsed before the callbacks are called.
+ */
+{
+	DCHK_ENGINE_QUEUE *q=(DCHK_ENGINE_QUEUE*)engine->queue;
+	int i;
+	if (job->domainset.num>0) {
+		// Jobs without a request only hold domains, which were found invalid locally
+		if (error==0 && job->bytes>0) {
+			if (!irislwz_CheckResponse(engine->handle)
+				|| !dchk_XML_ParseResult(engine->handle,&job->domainset)) error=engine->handle->error;
+		}
+		DCHK_RECORD *r=job->domainset.first, *next;
+		for (i=0;i<job->domainset.num;i++,r=next) {
+			next=r->next;
+			DCHK_ENGINE_DOMAIN *d=(DCHK_ENGINE_DOMAIN*)r;
+			engine->pending--;
+			if (d->callback) d->callback(engine,r,r->checkedLocally ? 0 : error,d->privatedata);
+			dchk_engine_FreeDomain(d);
+		}
+	} else {
+		engine->pending--;
+		if (job->callback) job->callback(engine,engine->handle,error,job->privatedata);
+		if (job->payload) free(job->payload);
+	}
+	job->next=q->freejobs;
+	q->freejobs=job;
+}
+
+static DCHK_ENGINE_JOB *dchk_engine_NextJob(DCHK_ENGINE *engine)
+/*!\brief Take the next job from the queue
+ *
+ * \internal
+ * Payloads are sent first, then the waiting domains are bundled.
+ */
+{
+	DCHK_ENGINE_QUEUE *q=(DCHK_ENGINE_QUEUE*)engine->queue;
+	DCHK_ENGINE_JOB *job=q->first;
+	DCHK_RECORD *next;
+	if (job) {
+		q->first=job->next;
+		if (!q->first) q->last=NULL;
+		return job;
+	}
+	while (q->domains.first) {
+		job=dchk_engine_NewJob(engine);
+		if (!job) return NULL;
+		next=q->domains.first;
+		if (next->checkedLocally) {
+			// Invalid domains at the head of the queue are completed without a request
+			job->domainset.first=next;
+			job->domainset.last=next;
+			job->domainset.num=1;
+			q->domains.first=next->next;
+			q->domains.num--;
+			if (!q->domains.first) q->domains.last=NULL;
+			dchk_engine_Complete(engine,job,0);
+			continue;
+		}
+		job->bytes=dchk_BuildRequest(engine->handle,&next,engine->maxdomainsperquery,q->buffer,
+			&job->domainset,&job->validate);
+		if (job->bytes) {
+			q->domains.first=next;
+			q->domains.num-=job->domainset.num;
+			if (!next) q->domains.last=NULL;
+			job->payload=q->buffer;
+			return job;
+		}
+		// The first domain could not be bundled, so we fail it alone
+		job->domainset.first=q->domains.first;
+		job->domainset.last=q->domains.first;
+		job->domainset.num=1;
+		q->domains.first=q->domains.first->next;
+		q->domains.num--;
+		if (!q->domains.first) q->domains.last=NULL;
+		dchk_engine_Complete(engine,job,engine->handle->error);
+	}
+	return NULL;
+}
+
+static void dchk_engine_Fill(DCHK_ENGINE *engine)
+/*!\brief Send queued jobs until the window is full
+ *
+ * \internal
+ */
+{
+	DCHK_ENGINE_JOB *job;
+	while (irislwz_PipelineOutstanding(engine->handle)<engine->handle->window) {
+		job=dchk_engine_NextJob(engine);
+		if (!job) return;
+		int ret=irislwz_PipelineSendPayload(engine->handle,job->payload,job->bytes,job,job->validate);
+		// Bundled payloads live in the shared buffer, the pipeline has its own copy
+		if (job->domainset.num>0) job->payload=NULL;
+		if (!ret) dchk_engine_Complete(engine,job,engine->handle->error);
+	}
+}
+
+static int dchk_engine_Wait(DCHK_ENGINE *engine, int timeout)
+/*!\brief Wait until the socket is readable or \p timeout milliseconds passed
+ *
+ * \internal
+ * \returns Returns 1 on success or 0 on error.
+ */
+{
+#ifdef __linux__
+	struct epoll_event ev;
+	if (epoll_wait(engine->pollfd,&ev,1,timeout)<0) {
+		int e=irislwz_TranslateSocketError();
+		if (e==1062) return 1;		// EINTR
+		irislwz_SetError(engine->handle,e,"epoll_wait");
+		return 0;
+	}
+	return 1;
+#elif defined HAVE_SYS_POLL_H
+	struct pollfd pfd;
+	pfd.fd=engine->pollfd;
+	pfd.events=POLLIN;
+	pfd.revents=0;
+	if (poll(&pfd,1,timeout)<0) {
+		int e=irislwz_TranslateSocketError();
+		if (e==1062) return 1;		// EINTR
+		irislwz_SetError(engine->handle,e,"poll");
+		return 0;
+	}
+	return 1;
+#else
+	irislwz_SetError(engine->handle,74022,NULL);
+	return 0;
+#endif
+}
+
+int dchk_engine_Init(DCHK_ENGINE *engine, IRISLWZ_HANDLE *handle)
+/*!\brief Initialization of a DCHK_ENGINE object
+ *
+ * The engine is an event driven alternative to \ref dchk_QueryDomainList. Domains and
+ * payloads are submitted to the engine with \ref dchk_engine_SubmitDomain and
+ * \ref dchk_engine_SubmitPayload and are processed without blocking by
+ * \ref dchk_engine_Run, which delivers the results to callback functions. On Linux the
+ * engine waits for answers with epoll, so a single thread can drive as many outstanding
+ * requests as the window of the \p handle allows (see \ref irislwz_SetWindow).
+ *
+ * The engine uses the connection and the settings of \p handle, which must already be connected
+ * with \ref irislwz_Connect. The handle must not be used for other queries while the engine
+ * exists.
+ *
+ * \param[in] engine pointer to an existing DCHK_ENGINE object
+ * \param[in] handle pointer to a connected IRISLWZ_HANDLE object
+ * \returns On success, this function returns 1, on error 0. The error is stored in the
+ * \p handle.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_ENGINE
+ */
+{
+	if (!engine) return 0;
+	if (!handle) return 0;
+	memset(engine,0,sizeof(DCHK_ENGINE));
+	int sd=irislwz_GetSocket(handle);
+	if (sd<0) return 0;
+	DCHK_ENGINE_QUEUE *q=(DCHK_ENGINE_QUEUE*)calloc(1,sizeof(DCHK_ENGINE_QUEUE));
+	if (!q) {
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	q->buffer=(char*)malloc(7000);
+	if (!q->buffer) {
+		free(q);
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+#ifdef __linux__
+	struct epoll_event ev;
+	engine->pollfd=epoll_create(1);
+	if (engine->pollfd<0) {
+		int e=irislwz_TranslateSocketError();
+		free(q->buffer);
+		free(q);
+		irislwz_SetError(handle,e,"epoll_create");
+		return 0;
+	}
+	memset(&ev,0,sizeof(ev));
+	ev.events=EPOLLIN;
+	ev.data.fd=sd;
+	if (epoll_ctl(engine->pollfd,EPOLL_CTL_ADD,sd,&ev)<0) {
+		int e=irislwz_TranslateSocketError();
+		close(engine->pollfd);
+		free(q->buffer);
+		free(q);
+		irislwz_SetError(handle,e,"epoll_ctl");
+		return 0;
+	}
+#elif defined HAVE_SYS_POLL_H
+	engine->pollfd=sd;
+#else
+	free(q->buffer);
+	free(q);
+	irislwz_SetError(handle,74022,NULL);
+	return 0;
+#endif
+	// Many outstanding requests can result in bursts of answers, so we try
+	// to get a receive buffer big enough to hold a complete window
+	if (handle->window>1) {
+		int bufsize=handle->window*(handle->maximumResponseLength+64);
+		if (bufsize>8*1024*1024) bufsize=8*1024*1024;
+		setsockopt(sd,SOL_SOCKET,SO_RCVBUF,(const char*)&bufsize,sizeof(bufsize));
+	}
+	engine->handle=handle;
+	engine->queue=q;
+	engine->maxdomainsperquery=20;
+	return 1;
+}
+
+int dchk_engine_Exit(DCHK_ENGINE *engine)
+/*!\brief Deinitialize a DCHK_ENGINE object
+ *
+ * All domains and payloads, which are not finished yet, are cancelled. Their callback functions
+ * are called with error code 74066. Afterwards all memory associated with the engine is freed.
+ * The IRISLWZ_HANDLE is not touched, except that outstanding requests are removed from
+ * its pipeline.
+ *
+ * \param[in] engine pointer to a DCHK_ENGINE object
+ * \returns Returns 0, when the \p engine parameter points to NULL, otherwise 1.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_ENGINE
+ */
+{
+	DCHK_ENGINE_JOB *job;
+	if (!engine) return 0;
+	DCHK_ENGINE_QUEUE *q=(DCHK_ENGINE_QUEUE*)engine->queue;
+	if (!q) return 1;
+	dchk_engine_Cancel(engine);
+	while ((job=q->freejobs)) {
+		q->freejobs=job->next;
+		free(job);
+	}
+#ifdef __linux__
+	close(engine->pollfd);
+#endif
+	free(q->buffer);
+	free(q);
+	memset(engine,0,sizeof(DCHK_ENGINE));
+	return 1;
+}
+
+void dchk_engine_Cancel(DCHK_ENGINE *engine)
+/*!\brief Cancel all domains and payloads
+ *
+ * All domains and payloads, which are waiting in the queue or are outstanding, are cancelled.
+ * Their callback functions are called with error code 74066.
+ *
+ * \param[in] engine pointer to a DCHK_ENGINE object
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_ENGINE
+ */
+{
+	DCHK_ENGINE_JOB *job;
+	if (!engine) return;
+	DCHK_ENGINE_QUEUE *q=(DCHK_ENGINE_QUEUE*)engine->queue;
+	if (!q) return;
+	IRISLWZ_HANDLE *handle=engine->handle;
+	irislwz_SetError(handle,74066,NULL);
+	// Outstanding requests
+	while (irislwz_PipelineCancel(handle,(void**)&job)) {
+		dchk_engine_Complete(engine,job,74066);
+	}
+	// Queued payloads and domains
+	while ((job=q->first)) {
+		q->first=job->next;
+		dchk_engine_Complete(engine,job,74066);
+	}
+	q->last=NULL;
+	while (q->domains.first) {
+		DCHK_ENGINE_DOMAIN *d=(DCHK_ENGINE_DOMAIN*)q->domains.first;
+		q->domains.first=d->record.next;
+		engine->pending--;
+		if (d->callback) d->callback(engine,&d->record,74066,d->privatedata);
+		dchk_engine_FreeDomain(d);
+	}
+	q->domains.last=NULL;
+	q->domains.num=0;
+}
+
+void dchk_engine_SetMaxDomainsPerQuery(DCHK_ENGINE *engine, int count)
+/*!\brief Set maximum number of domains per request
+ *
+ * Domains submitted with \ref dchk_engine_SubmitDomain are bundled into requests. This function
+ * sets the maximum number of domains per request. The default is 20, a value of 0 means
+ * unlimited.
+ *
+ * \param[in] engine pointer to a DCHK_ENGINE object
+ * \param[in] count maximum number of domains per request
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_ENGINE
+ */
+{
+	if (!engine) return;
+	if (count<0) count=0;
+	engine->maxdomainsperquery=count;
+}
+
+int dchk_engine_SubmitDomain(DCHK_ENGINE *engine, const char *domain,
+		void (*callback)(DCHK_ENGINE *engine, DCHK_RECORD *record, int error, void *privatedata),
+		void *privatedata)
+/*!\brief Submit a domain to the engine
+ *
+ * The domain is put into the queue of the engine. The engine bundles queued domains into
+ * requests, so the request is not sent before \ref dchk_engine_Run is called. When the
+ * answer arrives, the request times out or the domain is cancelled, the \p callback
+ * function is called:
+ *
+ * \code
+ * void callback(DCHK_ENGINE *engine, DCHK_RECORD *record, int error, void *privatedata)
+ * {
+ * 	if (error) printf("%s: %s\n",record->domain,irislwz_GetError(error));
+ * 	else printf("%s: %s\n",record->domain,record->status);
+ * }
+ * \endcode
+ *
+ * If \ref dchk_SetLocalValidation is enabled for the handle of the engine, an invalid
+ * domain name is not sent. The callback gets the status "invalid" without an error.
+ *
+ * The record is only valid during the call of the callback function. If \p error is not 0,
+ * further information about the error is available in the IRISLWZ_HANDLE of the engine.
+ * It is allowed to submit new domains or payloads from within the callback function.
+ *
+ * \param[in] engine pointer to a DCHK_ENGINE object
+ * \param[in] domain pointer to a domain name, which must not be longer than 512 bytes
+ * \param[in] callback Pointer to the callback function or NULL
+ * \param[in] privatedata Pointer to some optional data, which is passed to the callback function
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_ENGINE
+ */
+{
+	if (!engine) return 0;
+	DCHK_ENGINE_QUEUE *q=(DCHK_ENGINE_QUEUE*)engine->queue;
+	if (!q) return 0;
+	if (!domain) {
+		irislwz_SetError(engine->handle,74025,"int dchk_engine_SubmitDomain(DCHK_ENGINE *engine, ==> const char *domain <==, ...)");
+		return 0;
+	}
+	// We don't allow domain names longer than 512 bytes
+	if (strlen(domain)>512) {
+		irislwz_SetError(engine->handle,74054,NULL);
+		return 0;
+	}
+	DCHK_ENGINE_DOMAIN *d=(DCHK_ENGINE_DOMAIN*)calloc(1,sizeof(DCHK_ENGINE_DOMAIN));
+	if (!d) {
+		irislwz_SetError(engine->handle,74024,NULL);
+		return 0;
+	}
+	d->record.domain=strdup(domain);
+	if (!d->record.domain) {
+		free(d);
+		irislwz_SetError(engine->handle,74024,NULL);
+		return 0;
+	}
+	d->callback=callback;
+	d->privatedata=privatedata;
+	if (engine->handle->localValidation) dchk_ValidateRecord(engine->handle,&d->record);
+	if (!q->domains.first) {
+		q->domains.first=&d->record;
+		q->domains.last=&d->record;
+	} else {
+		q->domains.last->next=&d->record;
+		q->domains.last=&d->record;
+	}
+	q->domains.num++;
+	engine->pending++;
+	return 1;
+}
+
+int dchk_engine_SubmitPayload(DCHK_ENGINE *engine, const char *payload, int bytes,
+		void (*callback)(DCHK_ENGINE *engine, IRISLWZ_HANDLE *handle, int error, void *privatedata),
+		void *privatedata)
+/*!\brief Submit a raw request to the engine
+ *
+ * The \p payload is copied into the queue of the engine and is sent by \ref dchk_engine_Run.
+ * When the answer arrives, the request times out or is cancelled, the \p callback function
+ * is called:
+ *
+ * \code
+ * void callback(DCHK_ENGINE *engine, IRISLWZ_HANDLE *handle, int error, void *privatedata)
+ * {
+ * 	if (!error) printf("%s\n",handle->response.uncompressed_payload);
+ * }
+ * \endcode
+ *
+ * During the call, the request and response structures of the handle contain the request and
+ * the answer.
+ *
+ * \param[in] engine pointer to a DCHK_ENGINE object
+ * \param[in] payload Request, which should be send to IRIS server
+ * \param[in] bytes Size of the payload
+ * \param[in] callback Pointer to the callback function or NULL
+ * \param[in] privatedata Pointer to some optional data, which is passed to the callback function
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_ENGINE
+ */
+{
+	if (!engine) return 0;
+	DCHK_ENGINE_QUEUE *q=(DCHK_ENGINE_QUEUE*)engine->queue;
+	if (!q) return 0;
+	if (!payload) {
+		irislwz_SetError(engine->handle,74025,"int dchk_engine_SubmitPayload(DCHK_ENGINE *engine, ==> const char *payload <==, ...)");
+		return 0;
+	}
+	if (bytes<1) {
+		irislwz_SetError(engine->handle,74025,"int dchk_engine_SubmitPayload(DCHK_ENGINE *engine, const char *payload, ==> int bytes <==, ...)");
+		return 0;
+	}
+	DCHK_ENGINE_JOB *job=dchk_engine_NewJob(engine);
+	if (!job) return 0;
+	job->payload=(char*)malloc(bytes+1);
+	if (!job->payload) {
+		job->next=q->freejobs;
+		q->freejobs=job;
+		irislwz_SetError(engine->handle,74024,NULL);
+		return 0;
+	}
+	memcpy(job->payload,payload,bytes);
+	job->payload[bytes]=0;
+	job->bytes=bytes;
+	job->validate=1;
+	job->callback=callback;
+	job->privatedata=privatedata;
+	if (!q->first) q->first=job;
+	else q->last->next=job;
+	q->last=job;
+	engine->pending++;
+	return 1;
+}
+
+int dchk_engine_Run(DCHK_ENGINE *engine, int timeout)
+/*!\brief Process queued domains and payloads
+ *
+ * This function sends queued requests as long as the window of the IRISLWZ_HANDLE allows,
+ * reads the answers and handles timeouts. The results are delivered to the callback
+ * functions.
+ *
+ * \param[in] engine pointer to a DCHK_ENGINE object
+ * \param[in] timeout Maximum time in milliseconds this function runs. Use -1 to run until
+ * all submitted domains and payloads are finished. With 0 the function does not block
+ * at all, it processes only what is possible right now. This is useful if the engine
+ * is integrated in another event loop (see \ref dchk_engine_GetFd).
+ * \returns Returns 1 on success or 0, if an error occured, which is not related to a single
+ * request, e.g. the server is unreachable.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_ENGINE
+ */
+{
+	DCHK_ENGINE_JOB *job;
+	int ret, wait;
+	if (!engine) return 0;
+	if (!engine->queue) return 0;
+	IRISLWZ_HANDLE *handle=engine->handle;
+	long long end=0;
+	if (timeout>0) end=irislwz_GetTime()/1000+timeout;
+	while (1) {
+		dchk_engine_Fill(engine);
+		// Read all answers, which are already waiting
+		while ((ret=irislwz_PipelinePoll(handle,(void**)&job))!=-1) {
+			if (ret==1) dchk_engine_Complete(engine,job,0);
+			else if (job) dchk_engine_Complete(engine,job,handle->error);
+			else return 0;
+			dchk_engine_Fill(engine);
+		}
+		while (irislwz_PipelineExpire(handle,(void**)&job)) {
+			dchk_engine_Complete(engine,job,handle->error);
+			dchk_engine_Fill(engine);
+		}
+		if (engine->pending==0) return 1;
+		if (timeout==0) return 1;
+		wait=irislwz_PipelineNextTimeout(handle);
+		if (timeout>0) {
+			long long left=end-irislwz_GetTime()/1000;
+			if (left<=0) return 1;
+			if (wait<0 || wait>left) wait=(int)left;
+		}
+		if (!dchk_engine_Wait(engine,wait)) return 0;
+	}
+	return 1;
+}
+
+int dchk_engine_Pending(DCHK_ENGINE *engine)
+/*!\brief Returns the number of unfinished domains and payloads
+ *
+ * \param[in] engine pointer to a DCHK_ENGINE object
+ * \returns Number of submitted domains and payloads, whose callback function was not called yet.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_ENGINE
+ */
+{
+	if (!engine) return 0;
+	return engine->pending;
+}
+
+int dchk_engine_GetFd(DCHK_ENGINE *engine)
+/*!\brief Returns a descriptor for external event loops
+ *
+ * This function returns a file descriptor, which becomes readable, when the engine has
+ * something to do. It can be added to the select, poll or epoll set of an application's own
+ * event loop, which then calls \ref dchk_engine_Run with a timeout of 0. The application
+ * should wake up at least after \ref dchk_engine_NextTimeout milliseconds.
+ *
+ * \param[in] engine pointer to a DCHK_ENGINE object
+ * \returns The file descriptor or -1 on error.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_ENGINE
+ */
+{
+	if (!engine) return -1;
+	if (!engine->queue) return -1;
+	return engine->pollfd;
+}
+
+int dchk_engine_NextTimeout(DCHK_ENGINE *engine)
+/*!\brief Returns the time until the engine needs to run again
+ *
+ * \param[in] engine pointer to a DCHK_ENGINE object
+ * \returns Number of milliseconds until the next outstanding request times out, 0 if
+ * there is work to do right now, or -1 if the engine only needs to run when its
+ * descriptor becomes readable.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_ENGINE
+ */
+{
+	if (!engine) return -1;
+	DCHK_ENGINE_QUEUE *q=(DCHK_ENGINE_QUEUE*)engine->queue;
+	if (!q) return -1;
+	if ((q->first || q->domains.first)
+		&& irislwz_PipelineOutstanding(engine->handle)<engine->handle->window) return 0;
+	return irislwz_PipelineNextTimeout(engine->handle);
+}
@@ -125,6 +125,13 @@ static const char * errorslwz[] = {
 	"could not open inputfile",											// 74059
 	"could not dtermine size of inputfile",								// 74060
 	"error while reading inputfile",									// 74061
+	"Pipeline is busy, window can not be changed while requests are outstanding",	// 74062
+	"Pipeline window is full",											// 74063
+	"No outstanding requests in pipeline",								// 74064
+	"Parameter out of range",											// 74065
+	"Request was cancelled",											// 74066
+	"No server in server pool",											// 74067
+	"Decompressed answer exceeds maximum size",							// 74068
 
 	NULL
 };
@@ -137,6 +144,11 @@ static const char * errorsdchk[] = {
 	"DCHK: no or incomplete answer",								// 74104
 	"DCHK: connect to server failed",								// 74105
 	"DCHK: could not escape special chars in domainname",			// 74106
+	"DCHK: domain name can not be converted to ASCII",			// 74107
+	"DCHK: invalid entry in routing table",							// 74108
+	"DCHK: invalid entry in discovery cache file",					// 74109
+	"DCHK: could not write discovery cache file",					// 74110
+	"DCHK: socket descriptor too large for select",					// 74111
 	NULL
 };
 
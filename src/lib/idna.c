@@ -0,0 +1,346 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+
+/*
+ * Conversion of internationalized domain names into A-labels
+ *
+ * Labels with non ASCII characters are converted with the Punycode algorithm of RFC 3492
+ * and get the prefix "xn--". Before that, upper case letters of the Latin, Greek and
+ * Cyrillic alphabets are mapped to lower case. The library does not have the Unicode
+ * tables needed for a complete IDNA2008 normalization. Domain names, which might need
+ * more than that, like names with combining characters, are not converted. In this case
+ * the server gets the name in UTF-8 as before.
+ */
+
+#define DCHK_IDNA_MAXLABEL		63
+#define DCHK_IDNA_MAXDOMAIN		253
+#define DCHK_IDNA_MAXCODEPOINTS	64
+
+// Parameters of Punycode, RFC 3492 section 5
+#define PUNY_BASE		36
+#define PUNY_TMIN		1
+#define PUNY_TMAX		26
+#define PUNY_SKEW		38
+#define PUNY_DAMP		700
+#define PUNY_BIAS		72
+#define PUNY_N			128
+
+int dchk_DecodeUTF8(const unsigned char **p, const unsigned char *end)
+/*!\brief Decode the next UTF-8 character
+ *
+ * \internal
+ * This is the only UTF-8 validator of the library, it is used for domain names, requests and
+ * answers. Besides malformed sequences it rejects everything libxml2 does not accept as
+ * character: overlong sequences, surrogates, code points above U+10FFFF and the
+ * noncharacters U+FFFE and U+FFFF.
+ *
+ * \returns The code point or -1, if the UTF-8 sequence is invalid.
+ */
+{
+	const unsigned char *s=*p;
+	int c=*s, n, i;
+	if (c<128) {
+		*p=s+1;
+		return c;
+	}
+	if (c>=0xc2 && c<=0xdf) {
+		n=1;
+		c&=0x1f;
+	} else if (c>=0xe0 && c<=0xef) {
+		n=2;
+		c&=0x0f;
+	} else if (c>=0xf0 && c<=0xf4) {
+		n=3;
+		c&=0x07;
+	} else return -1;
+	if (end-s<=n) return -1;
+	for (i=1;i<=n;i++) {
+		if ((s[i]&0xc0)!=0x80) return -1;
+		c=(c<<6)|(s[i]&0x3f);
+	}
+	// overlong sequences, surrogates and code points above U+10FFFF
+	if ((n==2 && c<0x800) || (n==3 && (c<0x10000 || c>0x10ffff))) return -1;
+	if ((c>=0xd800 && c<=0xdfff) || c==0xfffe || c==0xffff) return -1;
+	*p=s+n+1;
+	return c;
+}
+
+int dchk_IsUTF8(const char *string, int len)
+/*!\brief Check if a string is valid UTF-8
+ *
+ * \internal
+ * See \ref dchk_DecodeUTF8 for the rules.
+ */
+{
+	const unsigned char *p=(const unsigned char*)string, *end=p+len;
+	while (p<end) {
+		if (*p<128) p++;
+		else if (dchk_DecodeUTF8(&p,end)<0) return 0;
+	}
+	return 1;
+}
+
+static int dchk_IDNA_Map(int c)
+/*!\brief Map a code point to lower case
+ *
+ * \internal
+ * \returns The mapped code point, 0 for label separators or -1, if the character can not
+ * be handled.
+ */
+{
+	if (c<128) {
+		if (c>='A' && c<='Z') return c+32;
+		if (c=='.') return 0;
+		if (c<=32 || c==127) return -1;
+		return c;
+	}
+	// Ideographic and fullwidth full stops separate labels, too
+	if (c==0x3002 || c==0xff0e || c==0xff61) return 0;
+	// C1 control characters, no-break space and soft hyphen
+	if (c<0xa0 || c==0xa0 || c==0xad) return -1;
+	// Latin-1 Supplement
+	if (c>=0xc0 && c<=0xde && c!=0xd7) return c+32;
+	// Latin Extended-A
+	if (c>=0x100 && c<=0x17f) {
+		if (c==0x130 || c==0x149 || c==0x17f) return -1;
+		if (c==0x178) return 0xff;
+		if ((c>=0x139 && c<=0x148) || (c>=0x179 && c<=0x17e)) return (c&1) ? c+1 : c;
+		if (c==0x131 || c==0x138) return c;
+		return (c&1) ? c : c+1;
+	}
+	// Combining diacritical marks: the name may not be in normalization form C
+	if (c>=0x300 && c<=0x36f) return -1;
+	// Greek
+	if (c>=0x391 && c<=0x3ab && c!=0x3a2) return c+32;
+	// Cyrillic
+	if (c>=0x400 && c<=0x40f) return c+80;
+	if (c>=0x410 && c<=0x42f) return c+32;
+	// Other combining marks, zero width characters and the replacement character
+	if ((c>=0x1ab0 && c<=0x1aff) || (c>=0x1dc0 && c<=0x1dff) || (c>=0x200b && c<=0x200f)
+		|| (c>=0x20d0 && c<=0x20ff) || (c>=0xfe00 && c<=0xfe0f) || (c>=0xfe20 && c<=0xfe2f)
+		|| c==0xfeff || c==0xfffd) return -1;
+	return c;
+}
+
+static int dchk_IDNA_Adapt(int delta, int numpoints, int firsttime)
+/*!\brief Bias adaption function of RFC 3492 section 6.1
+ *
+ * \internal
+ */
+{
+	int k=0;
+	delta=firsttime ? delta/PUNY_DAMP : delta/2;
+	delta+=delta/numpoints;
+	while (delta>((PUNY_BASE-PUNY_TMIN)*PUNY_TMAX)/2) {
+		delta/=PUNY_BASE-PUNY_TMIN;
+		k+=PUNY_BASE;
+	}
+	return k+(PUNY_BASE-PUNY_TMIN+1)*delta/(delta+PUNY_SKEW);
+}
+
+static char dchk_IDNA_Digit(int d)
+{
+	return (char)(d<26 ? 'a'+d : '0'+d-26);
+}
+
+static int dchk_IDNA_Punycode(const int *label, int len, char *out, int outsize)
+/*!\brief Encode a label with Punycode (RFC 3492 section 6.3)
+ *
+ * \internal
+ * \returns The number of characters written to \p out or -1, if \p outsize is too small.
+ */
+{
+	int n=PUNY_N, delta=0, bias=PUNY_BIAS, h, b=0, i, m, q, k, t, o=0;
+	for (i=0;i<len;i++) {
+		if (label[i]<128) {
+			if (o>=outsize) return -1;
+			out[o++]=(char)label[i];
+			b++;
+		}
+	}
+	h=b;
+	if (b>0) {
+		if (o>=outsize) return -1;
+		out[o++]='-';
+	}
+	while (h<len) {
+		m=0x7fffffff;
+		for (i=0;i<len;i++) if (label[i]>=n && label[i]<m) m=label[i];
+		// Labels are at most 63 characters, so delta can not overflow
+		delta+=(m-n)*(h+1);
+		n=m;
+		for (i=0;i<len;i++) {
+			if (label[i]<n) delta++;
+			if (label[i]==n) {
+				for (q=delta,k=PUNY_BASE;;k+=PUNY_BASE) {
+					t=k<=bias ? PUNY_TMIN : (k>=bias+PUNY_TMAX ? PUNY_TMAX : k-bias);
+					if (q<t) break;
+					if (o>=outsize) return -1;
+					out[o++]=dchk_IDNA_Digit(t+(q-t)%(PUNY_BASE-t));
+					q=(q-t)/(PUNY_BASE-t);
+				}
+				if (o>=outsize) return -1;
+				out[o++]=dchk_IDNA_Digit(q);
+				bias=dchk_IDNA_Adapt(delta,h+1,h==b);
+				delta=0;
+				h++;
+			}
+		}
+		delta++;
+		n++;
+	}
+	return o;
+}
+
+int dchk_IDNA_ToASCII(const char *domain, int len, char *buffer, int buffersize)
+/*!\brief Convert a domain name into A-labels
+ *
+ * \internal
+ * Does the work for \ref dchk_ToASCII, without setting an error.
+ *
+ * \returns The length of the converted domain name or -1, if the domain name can not be
+ * converted.
+ */
+{
+	const unsigned char *p=(const unsigned char*)domain, *end=p+len;
+	int label[DCHK_IDNA_MAXCODEPOINTS];
+	int c, n, i, o=0, nonascii, ret;
+	if (len>0 && domain[len-1]=='.') end--;		// absolute domain name
+	while (1) {
+		// Collect the next label
+		n=0;
+		nonascii=0;
+		while (p<end) {
+			c=dchk_DecodeUTF8(&p,end);
+			if (c<0) return -1;
+			c=dchk_IDNA_Map(c);
+			if (c<0) return -1;
+			if (c==0) break;
+			if (n>=DCHK_IDNA_MAXCODEPOINTS) return -1;
+			if (c>=128) nonascii=1;
+			label[n++]=c;
+		}
+		if (n==0) return -1;						// empty label
+		if (nonascii) {
+			if (o+4>=buffersize) return -1;
+			memcpy(buffer+o,"xn--",4);
+			ret=dchk_IDNA_Punycode(label,n,buffer+o+4,buffersize-o-5);
+			if (ret<0 || ret+4>DCHK_IDNA_MAXLABEL) return -1;
+			o+=ret+4;
+		} else {
+			if (n>DCHK_IDNA_MAXLABEL || o+n>=buffersize) return -1;
+			for (i=0;i<n;i++) buffer[o++]=(char)label[i];
+		}
+		if (p>=end) break;
+		if (o+1>=buffersize) return -1;
+		buffer[o++]='.';
+	}
+	if (o>DCHK_IDNA_MAXDOMAIN) return -1;
+	buffer[o]=0;
+	return o;
+}
+
+int dchk_ToASCII(IRISLWZ_HANDLE *handle, const char *domain, char *buffer, int buffersize)
+/*!\brief Convert an internationalized domain name into its ASCII form
+ *
+ * This function converts all labels of \p domain containing non ASCII characters into
+ * A-labels ("xn--" followed by the Punycode encoding, see
+ * <a href="http://tools.ietf.org/html/rfc3492">RFC 3492</a>). Upper case letters are mapped
+ * to lower case before. ASCII labels are only mapped to lower case. The result can be used
+ * to find the same domain name in different encodings.
+ *
+ * The library only knows the case mapping of the Latin, Greek and Cyrillic alphabets and
+ * does not do a complete Unicode normalization. Domain names, which contain combining
+ * characters or invisible characters, are rejected.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] domain Pointer to the domain name in UTF-8
+ * \param[out] buffer Buffer for the converted domain name, 254 bytes are always enough
+ * \param[in] buffersize Size of the buffer
+ * \returns On success, the function returns 1, otherwise 0 and error 74107 is set.
+ *
+ * \example
+ * \code
+char ace[254];
+if (dchk_ToASCII(handle,"müller.de",ace,sizeof(ace))) {
+	printf ("%s\n",ace);		// xn--mller-kva.de
+}
+ * \endcode
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!handle) return 0;
+	if (!domain || !buffer) {
+		irislwz_SetError(handle,74025,NULL);
+		return 0;
+	}
+	if (dchk_IDNA_ToASCII(domain,(int)strlen(domain),buffer,buffersize)<0) {
+		irislwz_SetError(handle,74107,"%s",domain);
+		return 0;
+	}
+	return 1;
+}
+
+int dchk_SetIDNConversion(IRISLWZ_HANDLE *handle, int flag)
+/*!\brief Send internationalized domain names in their ASCII form
+ *
+ * By default domain names with non ASCII characters are sent in UTF-8 with the entityClass
+ * "idn" and the server has to normalize them. If this option is enabled, they are converted
+ * with \ref dchk_ToASCII and sent as "domain-name", which makes the requests smaller. Names
+ * which can not be converted are still sent in UTF-8. The results are stored under the
+ * original names.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] flag 1 to enable the conversion, 0 to disable it
+ * \returns Always returns 1.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!handle) return 0;
+	handle->idnToASCII=(char)(flag&1);
+	return 1;
+}
@@ -85,6 +85,12 @@
 #ifdef HAVE_ERRNO_H
 	#include <errno.h>
 #endif
+#include <time.h>
+#ifndef _WIN32
+	#include <sys/time.h>
+	#include <sys/select.h>
+	#include <sys/uio.h>
+#endif
 
 #include <zlib.h>
 
@@ -110,8 +116,64 @@ typedef struct {
 #else
 	int sd;
 #endif
+	int family;
 } DCHK_SOCKET;
 
+#define IRISLWZ_NO_DEADLINE 0x7fffffffffffffffLL
+
+// Retransmission timer according to RFC 6298, all values in microseconds
+#define IRISLWZ_RTO_INITIAL		1000000
+#define IRISLWZ_RTO_MIN			200000
+#define IRISLWZ_RTO_MAX			60000000
+#define IRISLWZ_RTO_GRANULARITY	1000
+
+// Minimum number of measured round trip times before requests are hedged
+#define IRISLWZ_HEDGE_MINSAMPLES	5
+
+// Default maximum ratio between decompressed and compressed size of an answer
+#define IRISLWZ_INFLATE_RATIO		256
+
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+	#define IRISLWZ_HAVE_MMSG
+#endif
+
+typedef struct {
+	IRISLWZ_PACKET request;
+	void *privatedata;
+	long long deadline;				// next retransmission or expire, whatever comes first
+	long long expire;				// request times out
+	long long sent;					// time of last transmission
+	int rto;						// current retransmission timeout
+	int retransmits;
+	int heappos;
+	int error;						// error code, if the request could not be sent
+	int unsentpos;					// position in list of unsent requests or -1
+	unsigned short tid;
+} IRISLWZ_TRANSACTION;
+
+typedef struct {
+	IRISLWZ_TRANSACTION *slots;
+	int *heap;						// outstanding transactions, ordered by deadline
+	int *freeslots;
+	int size;
+	int outstanding;
+	int numfree;
+	unsigned short *slotbytid;		// 65536 entries: slot index+1 or 0 if tid is unused
+	// Batched I/O
+	int batch;
+	int *unsent;					// requests waiting for irislwz_PipelineFlush
+	int numunsent;
+	char *ring;						// receive buffers
+	int *ringlength;
+	int ringbuffersize;
+	int ringhead;
+	int ringcount;
+#ifdef IRISLWZ_HAVE_MMSG
+	struct mmsghdr *smsg, *rmsg;
+	struct iovec *siov, *riov;
+#endif
+} IRISLWZ_PIPELINE;
+
 
 
 static void irislwz_debugout(int level, const char *text, void *privatedata)
@@ -215,36 +277,377 @@ static int rfc1951_deflate(Bytef *dst, uLongf *dstlen, const Bytef *src, uLong s
 	return ret;
 }
 
-static int rfc1951_inflate(Bytef *dest, uLongf *destLen, const Bytef *source, uLong sourceLen)
+long long irislwz_GetTime()
+/*!\brief Returns a timestamp in microseconds
+ *
+ * \internal
+ * This function returns a timestamp in microseconds, which is used to calculate deadlines
+ * of outstanding requests. Only the difference between two timestamps is meaningful.
+ */
 {
-	int ret;
-	z_stream z;
-	memset(&z,0,sizeof(z));
-	z.next_in=(Bytef*)source;
-	z.avail_in=sourceLen;
-	z.next_out=dest;
-	z.avail_out=*destLen;
-	ret=inflateInit2(&z,-15);
-	if (ret!=Z_OK) {
-		return ret;
+#ifdef _WIN32
+	return (long long)GetTickCount()*1000;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	if (clock_gettime(CLOCK_MONOTONIC,&ts)==0) return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+	return (long long)time(NULL)*1000000;
+#else
+	struct timeval tv;
+	gettimeofday(&tv,NULL);
+	return (long long)tv.tv_sec*1000000+tv.tv_usec;
+#endif
+}
+
+static int irislwz_WaitForData(IRISLWZ_HANDLE *handle, long long timeout)
+/*!\brief Waits until the socket becomes readable
+ *
+ * \internal
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] timeout maximum time to wait in microseconds or a negative value to wait forever
+ * \returns Returns 1 if data is available, 0 on timeout or interruption and -1 on error.
+ */
+{
+	DCHK_SOCKET *s=(DCHK_SOCKET*)handle->socket;
+#ifdef HAVE_SYS_POLL_H
+	struct pollfd pfd;
+	pfd.fd=s->sd;
+	pfd.events=POLLIN;
+	pfd.revents=0;
+	int ms=-1;
+	if (timeout>=0) ms=(int)((timeout+999)/1000);
+	int ret=poll(&pfd,1,ms);
+#else
+	fd_set rset;
+	struct timeval tv, *tvp=NULL;
+#ifndef _WIN32
+	if (s->sd>=FD_SETSIZE) {
+		irislwz_SetError(handle,74111,"%s:%i",handle->server,handle->port);
+		return -1;
 	}
-	ret=inflate(&z, Z_FINISH);
-	/*
-	if (ret==Z_STREAM_END) printf ("inflate meldet: Z_STREAM_END\n");
-	else if (ret==Z_OK) printf ("inflate meldet: Z_OK\n");
-	else if (ret==Z_BUF_ERROR) printf ("inflate meldet: Z_BUF_ERROR\n");
-	else if (ret==Z_STREAM_ERROR) printf ("inflate meldet: Z_STREAM_ERROR\n");
-	else printf ("inflate meldet: anderer Fehler: %i\n",ret);
-	*/
+#endif
+	FD_ZERO(&rset);
+	FD_SET(s->sd,&rset);
+	if (timeout>=0) {
+		tv.tv_sec=(long)(timeout/1000000);
+		tv.tv_usec=(long)(timeout%1000000);
+		tvp=&tv;
+	}
+	int ret=select((int)s->sd+1,&rset,NULL,NULL,tvp);
+#endif
+	if (ret<0) {
+		int e=irislwz_TranslateSocketError();
+		if (e==1062) return 0;		// EINTR
+		irislwz_SetError(handle,e,"%s:%i",handle->server,handle->port);
+		return -1;
+	}
+	return (ret>0);
+}
 
-	if (ret!=Z_STREAM_END) {
-		if (ret==Z_OK) ret=Z_BUF_ERROR;
-		inflateEnd(&z);
-		return ret;
+static int irislwz_CurrentRTO(IRISLWZ_HANDLE *handle)
+/*!\brief Returns the retransmission timeout in microseconds
+ *
+ * \internal
+ * As long as there is no round trip time measured, the initial timeout of one second
+ * recommended by RFC 6298 is used.
+ */
+{
+	if (handle->rto>0) return handle->rto;
+	return IRISLWZ_RTO_INITIAL;
+}
+
+static void irislwz_UpdateRTT(IRISLWZ_HANDLE *handle, long long rtt)
+/*!\brief Update the round trip time estimation with a new measurement
+ *
+ * \internal
+ * Calculates the smoothed round trip time, its variation and the retransmission timeout
+ * as described in <a href="http://tools.ietf.org/html/rfc6298">RFC 6298</a>. The caller must
+ * follow Karn's rule and must not pass measurements of retransmitted requests.
+ */
+{
+	long long delta, var;
+	if (rtt<1) rtt=1;
+	if (rtt>IRISLWZ_RTO_MAX) rtt=IRISLWZ_RTO_MAX;
+	handle->rtthistory[handle->rtthistorycount%IRISLWZ_RTT_HISTORY]=(int)rtt;
+	handle->rtthistorycount++;
+	if (handle->rtthistorycount>=2*IRISLWZ_RTT_HISTORY) handle->rtthistorycount-=IRISLWZ_RTT_HISTORY;
+	if (handle->srtt==0) {
+		handle->srtt=(int)rtt;
+		handle->rttvar=(int)(rtt/2);
+	} else {
+		delta=handle->srtt-rtt;
+		if (delta<0) delta=-delta;
+		handle->rttvar=(int)((3*(long long)handle->rttvar+delta)/4);
+		handle->srtt=(int)((7*(long long)handle->srtt+rtt)/8);
 	}
-	*destLen=z.total_out;
-	ret=inflateEnd(&z);
-	return ret;
+	var=4*(long long)handle->rttvar;
+	if (var<IRISLWZ_RTO_GRANULARITY) var=IRISLWZ_RTO_GRANULARITY;
+	var+=handle->srtt;
+	if (var<IRISLWZ_RTO_MIN) var=IRISLWZ_RTO_MIN;
+	if (var>IRISLWZ_RTO_MAX) var=IRISLWZ_RTO_MAX;
+	handle->rto=(int)var;
+}
+
+static long long irislwz_GetHedgeDelay(IRISLWZ_HANDLE *handle)
+/*!\brief Returns the time in microseconds, after which a request is hedged
+ *
+ * \internal
+ * The delay is the percentile set with \ref irislwz_SetHedging of the recently measured
+ * round trip times.
+ * \returns Delay in microseconds or -1, if hedging is disabled or there are not enough
+ * measurements yet.
+ */
+{
+	int i, j, n, v, sorted[IRISLWZ_RTT_HISTORY];
+	if (handle->hedge<=0 || handle->rtthistorycount<IRISLWZ_HEDGE_MINSAMPLES) return -1;
+	n=handle->rtthistorycount;
+	if (n>IRISLWZ_RTT_HISTORY) n=IRISLWZ_RTT_HISTORY;
+	for (i=0;i<n;i++) {
+		v=handle->rtthistory[i];
+		for (j=i;j>0 && sorted[j-1]>v;j--) sorted[j]=sorted[j-1];
+		sorted[j]=v;
+	}
+	return sorted[(n-1)*handle->hedge/100];
+}
+
+static long long irislwz_GetExpireTime(IRISLWZ_HANDLE *handle, long long now)
+/*!\brief Returns the time, at which a request sent at \p now times out
+ *
+ * \internal
+ */
+{
+	if (handle->timeout_seconds>0 || handle->timeout_useconds>0) {
+		return now+(long long)handle->timeout_seconds*1000000+handle->timeout_useconds;
+	}
+	return IRISLWZ_NO_DEADLINE;
+}
+
+static void irislwz_HeapSwap(IRISLWZ_PIPELINE *pl, int a, int b)
+{
+	int t=pl->heap[a];
+	pl->heap[a]=pl->heap[b];
+	pl->heap[b]=t;
+	pl->slots[pl->heap[a]].heappos=a;
+	pl->slots[pl->heap[b]].heappos=b;
+}
+
+static void irislwz_HeapUpdate(IRISLWZ_PIPELINE *pl, int pos)
+/*!\brief Restores the heap order after the deadline at position \p pos has changed
+ *
+ * \internal
+ */
+{
+	int parent, smallest, l, r;
+	while (pos>0) {
+		parent=(pos-1)/2;
+		if (pl->slots[pl->heap[parent]].deadline<=pl->slots[pl->heap[pos]].deadline) break;
+		irislwz_HeapSwap(pl,pos,parent);
+		pos=parent;
+	}
+	while (1) {
+		smallest=pos;
+		l=pos*2+1;
+		r=l+1;
+		if (l<pl->outstanding && pl->slots[pl->heap[l]].deadline<pl->slots[pl->heap[smallest]].deadline) smallest=l;
+		if (r<pl->outstanding && pl->slots[pl->heap[r]].deadline<pl->slots[pl->heap[smallest]].deadline) smallest=r;
+		if (smallest==pos) break;
+		irislwz_HeapSwap(pl,pos,smallest);
+		pos=smallest;
+	}
+}
+
+static void irislwz_ReleaseTransaction(IRISLWZ_PIPELINE *pl, int slot)
+/*!\brief Removes a transaction from the pipeline
+ *
+ * \internal
+ * The transaction id gets available again and the slot is put back on the list of free
+ * slots. The request packet of the transaction is not touched, the caller must free or
+ * take it over.
+ */
+{
+	IRISLWZ_TRANSACTION *t=&pl->slots[slot];
+	int pos=t->heappos;
+	if (t->unsentpos>=0) {
+		pl->numunsent--;
+		if (t->unsentpos!=pl->numunsent) {
+			pl->unsent[t->unsentpos]=pl->unsent[pl->numunsent];
+			pl->slots[pl->unsent[t->unsentpos]].unsentpos=t->unsentpos;
+		}
+		t->unsentpos=-1;
+	}
+	pl->slotbytid[t->tid]=0;
+	pl->outstanding--;
+	if (pos!=pl->outstanding) {
+		irislwz_HeapSwap(pl,pos,pl->outstanding);
+		irislwz_HeapUpdate(pl,pos);
+	}
+	t->heappos=-1;
+	t->privatedata=NULL;
+	pl->freeslots[pl->numfree++]=slot;
+}
+
+static void irislwz_FreeRing(IRISLWZ_PIPELINE *pl)
+{
+	if (pl->ring) free(pl->ring);
+	if (pl->ringlength) free(pl->ringlength);
+#ifdef IRISLWZ_HAVE_MMSG
+	if (pl->rmsg) free(pl->rmsg);
+	if (pl->riov) free(pl->riov);
+	pl->rmsg=NULL;
+	pl->riov=NULL;
+#endif
+	pl->ring=NULL;
+	pl->ringlength=NULL;
+	pl->ringbuffersize=0;
+	pl->ringhead=0;
+	pl->ringcount=0;
+}
+
+static int irislwz_AllocRing(IRISLWZ_HANDLE *handle, IRISLWZ_PIPELINE *pl)
+/*!\brief Allocate the receive buffers for batched I/O
+ *
+ * \internal
+ * The ring consists of one buffer per datagram of a batch. The buffers and the message
+ * headers pointing to them are allocated once and reused for every call of recvmmsg.
+ * When the maximum response length was raised, the ring is reallocated.
+ */
+{
+	int i, size=handle->maximumResponseLength+8192;
+	if (pl->ring && pl->ringbuffersize>=size) return 1;
+	irislwz_FreeRing(pl);
+	pl->ring=(char*)malloc((size_t)size*pl->batch);
+	pl->ringlength=(int*)calloc(pl->batch,sizeof(int));
+#ifdef IRISLWZ_HAVE_MMSG
+	pl->rmsg=(struct mmsghdr*)calloc(pl->batch,sizeof(struct mmsghdr));
+	pl->riov=(struct iovec*)calloc(pl->batch,sizeof(struct iovec));
+	if (!pl->rmsg || !pl->riov) {
+		irislwz_FreeRing(pl);
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+#endif
+	if (!pl->ring || !pl->ringlength) {
+		irislwz_FreeRing(pl);
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	pl->ringbuffersize=size;
+#ifdef IRISLWZ_HAVE_MMSG
+	for (i=0;i<pl->batch;i++) {
+		pl->riov[i].iov_base=pl->ring+(size_t)i*size;
+		pl->riov[i].iov_len=size-1;
+		pl->rmsg[i].msg_hdr.msg_iov=&pl->riov[i];
+		pl->rmsg[i].msg_hdr.msg_iovlen=1;
+	}
+#else
+	(void)i;
+#endif
+	return 1;
+}
+
+static void irislwz_FreePipeline(IRISLWZ_HANDLE *handle)
+{
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	if (!pl) return;
+	irislwz_PipelineReset(handle);
+	free(pl->slots);
+	free(pl->heap);
+	free(pl->freeslots);
+	free(pl->slotbytid);
+	if (pl->unsent) free(pl->unsent);
+	irislwz_FreeRing(pl);
+#ifdef IRISLWZ_HAVE_MMSG
+	if (pl->smsg) free(pl->smsg);
+	if (pl->siov) free(pl->siov);
+#endif
+	free(pl);
+	handle->pipeline=NULL;
+}
+
+static IRISLWZ_PIPELINE *irislwz_GetPipeline(IRISLWZ_HANDLE *handle)
+/*!\brief Returns the pipeline of the handle
+ *
+ * \internal
+ * The pipeline is created on first use with the size of the window configured by
+ * \ref irislwz_SetWindow.
+ */
+{
+	int i;
+	if (handle->pipeline) return (IRISLWZ_PIPELINE*)handle->pipeline;
+	int size=handle->window;
+	if (size<1) size=1;
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)calloc(1,sizeof(IRISLWZ_PIPELINE));
+	if (!pl) {
+		irislwz_SetError(handle,74024,NULL);
+		return NULL;
+	}
+	pl->slots=(IRISLWZ_TRANSACTION*)calloc(size,sizeof(IRISLWZ_TRANSACTION));
+	pl->heap=(int*)malloc(size*sizeof(int));
+	pl->freeslots=(int*)malloc(size*sizeof(int));
+	pl->slotbytid=(unsigned short*)calloc(65536,sizeof(unsigned short));
+	if (!pl->slots || !pl->heap || !pl->freeslots || !pl->slotbytid) {
+		if (pl->slots) free(pl->slots);
+		if (pl->heap) free(pl->heap);
+		if (pl->freeslots) free(pl->freeslots);
+		if (pl->slotbytid) free(pl->slotbytid);
+		free(pl);
+		irislwz_SetError(handle,74024,NULL);
+		return NULL;
+	}
+	for (i=0;i<size;i++) {
+		pl->slots[i].heappos=-1;
+		pl->slots[i].unsentpos=-1;
+		pl->freeslots[i]=size-1-i;
+	}
+	pl->size=size;
+	pl->numfree=size;
+	pl->batch=1;
+	if (handle->batch>1) {
+		pl->batch=handle->batch;
+		pl->unsent=(int*)malloc(pl->batch*sizeof(int));
+#ifdef IRISLWZ_HAVE_MMSG
+		pl->smsg=(struct mmsghdr*)calloc(pl->batch,sizeof(struct mmsghdr));
+		pl->siov=(struct iovec*)calloc(pl->batch,sizeof(struct iovec));
+		if (!pl->smsg || !pl->siov) {
+			handle->pipeline=pl;
+			irislwz_FreePipeline(handle);
+			irislwz_SetError(handle,74024,NULL);
+			return NULL;
+		}
+#endif
+		if (!pl->unsent || !irislwz_AllocRing(handle,pl)) {
+			handle->pipeline=pl;
+			irislwz_FreePipeline(handle);
+			irislwz_SetError(handle,74024,NULL);
+			return NULL;
+		}
+	}
+	handle->pipeline=pl;
+	return pl;
+}
+
+static unsigned short irislwz_NewTransactionId(IRISLWZ_HANDLE *handle)
+/*!\brief Returns a transaction id for the next request
+ *
+ * \internal
+ * As recommended by <a href="http://tools.ietf.org/html/rfc4993">RFC 4993</a> the transaction
+ * id is chosen randomly, but it is guaranteed to differ from the id of the previous request and
+ * from the ids of all requests still outstanding in the pipeline. The only exception is a
+ * window of 65534 requests, where the id of the previous request may be the only free one.
+ * The values 0 and 0xffff are never used.
+ */
+{
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	unsigned int tid=irislwz_rand(1,65534);
+	int i;
+	for (i=0;i<65534;i++) {
+		if (tid<1 || tid>65534) tid=1;
+		if (tid!=handle->lasttid && (pl==NULL || pl->slotbytid[tid]==0)) break;
+		tid++;
+	}
+	// With a full window the id of the previous request can be the only one left
+	if (i==65534) tid=handle->lasttid;
+	handle->lasttid=(unsigned short)tid;
+	return (unsigned short)tid;
 }
 
 const char *irislwz_GetVersion()
@@ -351,6 +754,7 @@ int irislwz_Init(IRISLWZ_HANDLE *handle)
 {
 	if (!handle) return 0;
 	memset(handle, 0, sizeof(IRISLWZ_HANDLE));
+	irislwz_InitLibrary();
 	handle->port=715;
 	handle->initialized=1;
 	handle->authority=NULL;
@@ -360,7 +764,19 @@ int irislwz_Init(IRISLWZ_HANDLE *handle)
 	handle->timeout_useconds=0;
 	handle->socket=(DCHK_SOCKET*)malloc(sizeof(DCHK_SOCKET));
 	((DCHK_SOCKET*)handle->socket)->sd=0;
+	((DCHK_SOCKET*)handle->socket)->family=0;
 	handle->DebugHandler=irislwz_debugout;
+	handle->window=1;
+	handle->batch=1;
+	handle->retries=3;
+	handle->deflateLevel=Z_BEST_COMPRESSION;
+	handle->deflateStrategy=Z_DEFAULT_STRATEGY;
+	handle->maxInflateRatio=IRISLWZ_INFLATE_RATIO;
+	handle->retain=IRISLWZ_RETAIN_ALL;
+	handle->idnToASCII=0;
+	handle->localValidation=0;
+	handle->routes=NULL;
+	handle->dnscache=NULL;
 	return 1;
 }
 
@@ -381,12 +797,27 @@ int irislwz_Exit(IRISLWZ_HANDLE *handle)
 	if (!handle) return 0;
 	if (!handle->initialized) return 1;
 	if (handle->errortext) free(handle->errortext);
-	if (handle->authority) free(handle->authority);
-	if (handle->server) free(handle->server);
-	if (handle->localcharset) free(handle->localcharset);
-	if (handle->socket) free(handle->socket);
+	irislwz_FreeString(handle,handle->authority);
+	irislwz_FreeString(handle,handle->server);
+	irislwz_FreeString(handle,handle->localcharset);
+	if (handle->socket) {
+		if (((DCHK_SOCKET*)handle->socket)->sd>0) {
+#ifdef _WIN32
+			closesocket(((DCHK_SOCKET*)handle->socket)->sd);
+#else
+			close(((DCHK_SOCKET*)handle->socket)->sd);
+#endif
+		}
+		free(handle->socket);
+	}
+	irislwz_FreePipeline(handle);
+	irislwz_ClearServers(handle);
 	irislwz_FreePacket(&handle->request);
 	irislwz_FreePacket(&handle->response);
+	if (handle->rxbuffer) free(handle->rxbuffer);
+	if (handle->inflatebuffer) free(handle->inflatebuffer);
+	irislwz_FreeCodec(handle);
+	irislwz_ReleaseConfig((DCHK_CONFIG*)handle->config);
 	memset(handle, 0, sizeof(IRISLWZ_HANDLE));
 	return 1;
 }
@@ -474,6 +905,7 @@ int irislwz_SetTimeout(IRISLWZ_HANDLE *handle, int seconds, int useconds)
  * has to wait for the response. As UDP is an unreliable protocol the client
  * can not detect if the request packet reached it's destination. It is also possible,
  * that the answer packet got lost. By default the library has a timeout of 5 seconds.
+ * Within this time, a request without answer is retransmitted (see \ref irislwz_SetRetries).
  *
  * With this function you can define a shorter timeout.
  *
@@ -507,7 +939,7 @@ int irislwz_SetAuthority(IRISLWZ_HANDLE *handle, const char *authority)
  */
 {
 	if (!handle) return 0;
-	if (handle->authority) free(handle->authority);
+	irislwz_FreeString(handle,handle->authority);
 	handle->authority=NULL;
 	if (!authority) return 1;
 	if (strlen(authority)>255) {
@@ -520,6 +952,30 @@ int irislwz_SetAuthority(IRISLWZ_HANDLE *handle, const char *authority)
 	return 0;
 }
 
+const char *irislwz_GetAuthorityOfDomain(IRISLWZ_HANDLE *handle, const char *domain)
+/*!\brief Returns the authority responsible for a domain
+ *
+ * \internal
+ * \returns Pointer to the authority of the matching route of the routing table of the handle,
+ * to the TLD within \p domain, a static string for ENUM domains or NULL, if \p domain has no TLD.
+ */
+{
+	if (handle->routes) {
+		DCHK_ROUTES *routes=(DCHK_ROUTES*)handle->routes;
+		int route=dchk_FindRoute(routes,domain);
+		if (route>=0) return dchk_GetRouteAuthority(routes,route);
+	}
+	const char *tld=strrchr(domain,'.');		// Find last occurrance of '.'
+	if (!tld) return NULL;
+	tld++;										// Point to first char after '.'
+	if (strcasecmp(tld,"arpa")==0) {
+		// We need to do some more work. For now only support german ENUM domains
+		// TODO: How can we implement a generic support?
+		if (strstr(domain,"9.4.e164.arpa")) tld="9.4.e164.arpa";
+	}
+	return tld;
+}
+
 int irislwz_SetAuthorityByDomain(IRISLWZ_HANDLE *handle, const char *domain)
 /*!\brief Sets authority for IRISLWZ requests by using the TLD of a domain
  *
@@ -531,9 +987,11 @@ int irislwz_SetAuthorityByDomain(IRISLWZ_HANDLE *handle, const char *domain)
  * \returns Returns 1 on success or 0 when an error occurred.
  *
  * \note
- * If the TLD is set to "arpa", a special handling takes place. At the moment the
- * library only checks if the domain ends with "9.4.e164.arpa" (german ENUM domains). If this is
- * the case "9.4.e164.arpa" is used as authority name. Other arpa zones are not implemented.
+ * If a routing table was set with \ref dchk_SetRoutes, the authority of the route matching
+ * the domain is used. Without a table or a matching route and if the TLD is set to "arpa", a
+ * special handling takes place. At the moment the library only checks if the domain ends with
+ * "9.4.e164.arpa" (german ENUM domains). If this is the case "9.4.e164.arpa" is used as
+ * authority name. Other arpa zones need a routing table.
  *
  * \ingroup DCHK_API_IRISLWZ
  */
@@ -541,18 +999,13 @@ int irislwz_SetAuthorityByDomain(IRISLWZ_HANDLE *handle, const char *domain)
 	if (!handle) return 0;
 	if (!domain) {
 		irislwz_SetError(handle,74025,"int irislwz_SetAuthorityByDomain(IRISLWZ_HANDLE *handle, ==> const char *domain <==)");
+		return 0;
 	}
-	const char *tld=strrchr(domain,'.');		// Find last occurrance of '.'
-	if (tld) tld++;								// Point to first char after '.'
+	const char *tld=irislwz_GetAuthorityOfDomain(handle,domain);
 	if (!tld) {
 		irislwz_SetError(handle,74058,domain);
 		return 0;
 	}
-	if (strcasecmp(tld,"arpa")==0) {
-		// We need to do some more work. For now only support german ENUM domains
-		// TODO: How can we implement a generic support?
-		if (strstr(domain,"9.4.e164.arpa")) tld="9.4.e164.arpa";
-	}
 	return irislwz_SetAuthority(handle,tld);
 }
 
@@ -568,7 +1021,8 @@ int irislwz_SetAuthorityByDomainList(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *li
  *
  * \remarks
  * The function actually only picks the first domain name from the list and calls the function
- * irislwz_SetAuthorityByDomain.
+ * irislwz_SetAuthorityByDomain. If the list contains domains of different authorities, use
+ * \ref dchk_QueryDomainListByAuthority instead.
  *
  * \ingroup DCHK_API_IRISLWZ
  */
@@ -653,7 +1107,7 @@ int irislwz_SetHost(IRISLWZ_HANDLE *handle, const char *host, int port)
 		irislwz_SetError(handle,74025,"int irislwz_SetHost(IRISLWZ_HANDLE *handle, ==> const char *host <==, int port)");
 		return 0;
 	}
-	if (handle->server) free(handle->server);
+	irislwz_FreeString(handle,handle->server);
 	handle->server=strdup(host);
 	if (!handle->server) {
 		irislwz_SetError(handle,74024,NULL);
@@ -661,6 +1115,8 @@ int irislwz_SetHost(IRISLWZ_HANDLE *handle, const char *host, int port)
 	}
 	if (port) handle->port=port;
 	else handle->port=715;
+	// An explicitly set host replaces the server pool
+	irislwz_ClearServers(handle);
 	return 1;
 }
 
@@ -733,14 +1189,155 @@ int irislwz_SendDeflated(IRISLWZ_HANDLE *handle, int flag)
  * \param[in] flag set to 1, if we want to send compressed requests, set to 0 if not
  * \returns Always returns 1.
  *
+ * \remarks
+ * This is the same as calling \ref irislwz_SetCompression with IRISLWZ_COMPRESSION_ALWAYS or
+ * IRISLWZ_COMPRESSION_OFF, level and strategy are not changed.
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	handle->sendDeflated=(char) (flag ? IRISLWZ_COMPRESSION_ALWAYS : IRISLWZ_COMPRESSION_OFF);
+	return 1;
+}
+
+int irislwz_SetCompression(IRISLWZ_HANDLE *handle, int mode, int level, int strategy)
+/*!\brief Set compression policy for requests
+ *
+ * With this function you can choose, if and how requests are compressed:
+ * - IRISLWZ_COMPRESSION_OFF: requests are sent uncompressed (default)
+ * - IRISLWZ_COMPRESSION_ALWAYS: requests are always sent compressed
+ * - IRISLWZ_COMPRESSION_AUTO: each request is compressed, but the compressed version is only
+ *   sent, if it is smaller than the uncompressed one by more than the threshold set with
+ *   \ref irislwz_SetCompressionThreshold. Otherwise the request is sent uncompressed.
+ *   \ref dchk_BuildBundle does not check the compressed size in this mode, as the request
+ *   can always be sent uncompressed.
+ *
+ * In all modes the request is compressed only once, the compressed data is sent as it is.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] mode One of IRISLWZ_COMPRESSION_OFF, IRISLWZ_COMPRESSION_ALWAYS or
+ * IRISLWZ_COMPRESSION_AUTO
+ * \param[in] level zlib compression level between 0 (none) and 9 (best), or -1 for the zlib
+ * default. The default of the library is 9.
+ * \param[in] strategy zlib compression strategy between 0 and 4 (Z_DEFAULT_STRATEGY,
+ * Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE, Z_FIXED)
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (mode<IRISLWZ_COMPRESSION_OFF || mode>IRISLWZ_COMPRESSION_AUTO
+		|| level<-1 || level>9 || strategy<0 || strategy>4) {
+		irislwz_SetError(handle,74065,"int irislwz_SetCompression(IRISLWZ_HANDLE *handle, ==> int mode, int level, int strategy <==)");
+		return 0;
+	}
+	handle->sendDeflated=(char)mode;
+	handle->deflateLevel=level;
+	handle->deflateStrategy=strategy;
+	return 1;
+}
+
+int irislwz_SetCompressionThreshold(IRISLWZ_HANDLE *handle, int bytes)
+/*!\brief Set minimum saving for compressed requests
+ *
+ * In mode IRISLWZ_COMPRESSION_AUTO (see \ref irislwz_SetCompression) a request is only sent
+ * compressed, if this saves more than \p bytes. The default is 0, so every request, which
+ * gets smaller by compression, is sent compressed.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] bytes Minimum number of bytes, which must be saved
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (bytes<0) {
+		irislwz_SetError(handle,74065,"int irislwz_SetCompressionThreshold(IRISLWZ_HANDLE *handle, ==> int bytes <==)");
+		return 0;
+	}
+	handle->deflateThreshold=bytes;
+	return 1;
+}
+
+int irislwz_SetMaxInflateRatio(IRISLWZ_HANDLE *handle, int ratio)
+/*!\brief Set maximum expansion ratio of compressed answers
+ *
+ * Compressed answers are decompressed into a buffer of the handle, which grows as needed.
+ * To protect against decompression bombs, no answer is decompressed beyond the size of the
+ * compressed payload multiplied by \p ratio plus 1024 bytes. If an answer needs more space,
+ * it is rejected with error 74068. The default ratio is 256.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] ratio Maximum ratio between 1 and 100000 or 0 for no limit
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (ratio<0 || ratio>100000) {
+		irislwz_SetError(handle,74065,"int irislwz_SetMaxInflateRatio(IRISLWZ_HANDLE *handle, ==> int ratio <==)");
+		return 0;
+	}
+	handle->maxInflateRatio=ratio;
+	return 1;
+}
+
+int irislwz_SetRetention(IRISLWZ_HANDLE *handle, int flags)
+/*!\brief Set which packets are kept after the results are parsed
+ *
+ * By default the request and the response of the last query are kept in the handle
+ * (IRISLWZ_HANDLE::request and IRISLWZ_HANDLE::response), so they can be inspected or shown
+ * to the user, like the GUI does. Applications which only need the results can drop the
+ * packets, their payloads, beautified versions and parsed documents as soon as
+ * \ref dchk_XML_ParseResult has stored the results in the domain list.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] flags One of the following values:
+ * - IRISLWZ_RETAIN_NONE: drop request and response
+ * - IRISLWZ_RETAIN_REQUEST: keep only the request
+ * - IRISLWZ_RETAIN_RESPONSE: keep only the response
+ * - IRISLWZ_RETAIN_ALL: keep both (default)
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
  * \ingroup DCHK_API_IRISLWZ
  */
 {
 	if (!handle) return 0;
-	handle->sendDeflated=(char) flag;
+	if (flags<IRISLWZ_RETAIN_NONE || flags>IRISLWZ_RETAIN_ALL) {
+		irislwz_SetError(handle,74065,"int irislwz_SetRetention(IRISLWZ_HANDLE *handle, ==> int flags <==)");
+		return 0;
+	}
+	handle->retain=(char)flags;
 	return 1;
 }
 
+void irislwz_ReleasePackets(IRISLWZ_HANDLE *handle)
+/*!\brief Free the packets, which should not be retained
+ *
+ * \internal
+ * Is called after the results of an answer are stored (see \ref irislwz_SetRetention).
+ */
+{
+	if (!(handle->retain&IRISLWZ_RETAIN_REQUEST)) irislwz_FreePacket(&handle->request);
+	if (!(handle->retain&IRISLWZ_RETAIN_RESPONSE)) irislwz_FreePacket(&handle->response);
+}
+
 int irislwz_IgnoreInvalidXML(IRISLWZ_HANDLE *handle, int flag)
 /*!\brief Tell the library to ignore invalid XML
  *
@@ -927,6 +1524,9 @@ int irislwz_Connect(IRISLWZ_HANDLE *handle)
  * protocol, there is no connection made to the server, but the hostname gets
  * resolved and the TCP stack checks, if the destination host is reachable.
  *
+ * If the handle has a server pool (see \ref irislwz_AddServer), a server is selected from
+ * the pool by \ref irislwz_SelectServer and all of its addresses are tried.
+ *
  * \param[in] handle pointer to an IRISLWZ_HANDLE object
  * \returns On success, this function returns 1, on error 0.
  *
@@ -943,23 +1543,20 @@ int irislwz_Connect(IRISLWZ_HANDLE *handle)
 		irislwz_SetError(handle,74031,NULL);
 		return 0;
 	}
+	if (irislwz_GetServerCount(handle)>0) return irislwz_PoolConnect(handle);
 
 	struct timeval tv;
 	tv.tv_sec=handle->timeout_seconds;
 	tv.tv_usec=handle->timeout_useconds;
 
 	// Resolve Hostname
-	struct protoent *proto=getprotobyname("UDP");
 	int n;
 	struct addrinfo hints, *res, *ressave;
 	bzero(&hints,sizeof(struct addrinfo));
 	hints.ai_family=AF_UNSPEC;
 	hints.ai_socktype=SOCK_DGRAM;
-	if (proto) {
-		hints.ai_protocol=proto->p_proto;
-	} else {
-		hints.ai_protocol=17;	// UDP
-	}
+	// getprotobyname is not reentrant, the protocol number of UDP is fixed anyway
+	hints.ai_protocol=IPPROTO_UDP;
 	if ((n=getaddrinfo(handle->server,NULL,&hints,&res))!=0) {
 #ifdef _WIN32
 		irislwz_SetError(handle,irislwz_TranslateSocketError(),NULL);
@@ -970,13 +1567,14 @@ int irislwz_Connect(IRISLWZ_HANDLE *handle)
 	}
 	ressave=res;
 
-	int e=0, conres=-1;
+	int e=0, conres=-1, family=0;
 
 	do {
 		sockfd=socket(res->ai_family,res->ai_socktype,res->ai_protocol);
 		if (sockfd<0) continue;		// Error, try next one
 		((struct sockaddr_in*)res->ai_addr)->sin_port=htons(handle->port);
 		conres=connect(sockfd,res->ai_addr,res->ai_addrlen);
+		family=res->ai_family;
 		if (conres==0) break;
 		e=irislwz_TranslateSocketError();
 		#ifdef _WIN32
@@ -1009,40 +1607,135 @@ int irislwz_Connect(IRISLWZ_HANDLE *handle)
 			}
 	}
 	((DCHK_SOCKET*)handle->socket)->sd=sockfd;
+	((DCHK_SOCKET*)handle->socket)->family=family;
+	// Round trip times of a previous server are meaningless
+	handle->srtt=0;
+	handle->rttvar=0;
+	handle->rto=0;
+	handle->rtthistorycount=0;
 	return 1;
 }
 
-int irislwz_Disconnect(IRISLWZ_HANDLE *handle)
-/*!\brief Destroys socket to IRISLWZ server
+int irislwz_ConnectAddress(IRISLWZ_HANDLE *handle, const struct sockaddr *addr, int addrlen)
+/*!\brief Connect the socket to an already resolved address
  *
- * This function destroys the socket to IRISLWZ server.
+ * \internal
+ * This function is used by the server pool to switch between servers. If the socket is already
+ * connected to an address of the same family, it is just connected to the new address, which
+ * does not cost more than a system call. Otherwise a new socket is created. Answers of the previous
+ * server are not accepted any longer, so there must not be outstanding requests in the pipeline.
  *
  * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] addr Address of the server including the port
+ * \param[in] addrlen Size of the address
  * \returns On success, this function returns 1, on error 0.
- *
- * \ingroup DCHK_API_IRISLWZ
  */
 {
-	if (!handle) return 0;
-	if (((DCHK_SOCKET*)handle->socket)->sd<=0) {
-		irislwz_SetError(handle,74032,NULL);
+#ifdef _WIN32
+	SOCKET	sockfd;
+#else
+	int sockfd;
+#endif
+	int e;
+	DCHK_SOCKET *s=(DCHK_SOCKET*)handle->socket;
+	if (irislwz_PipelineOutstanding(handle)) {
+		irislwz_SetError(handle,74062,NULL);
+		return 0;
+	}
+	if (s->sd>0 && s->family==addr->sa_family) {
+		if (connect(s->sd,addr,addrlen)==0) return 1;
+		e=irislwz_TranslateSocketError();
+		irislwz_SetError(handle,74012,"%s, %i:%s",handle->server,e,irislwz_GetSocketError(e));
 		return 0;
 	}
+	if (s->sd>0) {
 #ifdef _WIN32
-	closesocket(((DCHK_SOCKET*)handle->socket)->sd);
+		closesocket(s->sd);
 #else
-	// close (((DCHK_SOCKET*)handle->socket)->sd);
-	shutdown(((DCHK_SOCKET*)handle->socket)->sd,SHUT_RDWR);
+		close(s->sd);
 #endif
-	((DCHK_SOCKET*)handle->socket)->sd=0;
-	return 1;
-}
-
-void irislwz_FreePacket(IRISLWZ_PACKET *p)
-/*!\brief Frees the memory used by an IRISLWZ_PACKET
+		s->sd=0;
+	}
+	sockfd=socket(addr->sa_family,SOCK_DGRAM,0);
+	if (sockfd<0) {
+		e=irislwz_TranslateSocketError();
+		irislwz_SetError(handle,74012,"%s, %i:%s",handle->server,e,irislwz_GetSocketError(e));
+		return 0;
+	}
+	if (connect(sockfd,addr,addrlen)!=0) {
+		e=irislwz_TranslateSocketError();
+#ifdef _WIN32
+		closesocket(sockfd);
+#else
+		close(sockfd);
+#endif
+		irislwz_SetError(handle,74012,"%s, %i:%s",handle->server,e,irislwz_GetSocketError(e));
+		return 0;
+	}
+	if (handle->timeout_seconds>0 || handle->timeout_useconds>0) {
+		struct timeval tv;
+		tv.tv_sec=handle->timeout_seconds;
+		tv.tv_usec=handle->timeout_useconds;
+		if (setsockopt(sockfd,SOL_SOCKET,SO_RCVTIMEO,(const char*)&tv,sizeof(tv))!=0) {
+			e=irislwz_TranslateSocketError();
+#ifdef _WIN32
+			closesocket(sockfd);
+#else
+			close(sockfd);
+#endif
+			irislwz_SetError(handle,74033,"%i: %s", e, irislwz_GetSocketError(e));
+			return 0;
+		}
+	}
+	s->sd=sockfd;
+	s->family=addr->sa_family;
+	return 1;
+}
+
+int irislwz_IsConnected(IRISLWZ_HANDLE *handle)
+/*!\brief Returns 1, if the handle has a connected socket
+ *
+ * \internal
+ */
+{
+	if (!handle) return 0;
+	if (!handle->socket) return 0;
+	return ((DCHK_SOCKET*)handle->socket)->sd>0 ? 1 : 0;
+}
+
+int irislwz_Disconnect(IRISLWZ_HANDLE *handle)
+/*!\brief Destroys socket to IRISLWZ server
+ *
+ * This function destroys the socket to IRISLWZ server.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (((DCHK_SOCKET*)handle->socket)->sd<=0) {
+		irislwz_SetError(handle,74032,NULL);
+		return 0;
+	}
+#ifdef _WIN32
+	closesocket(((DCHK_SOCKET*)handle->socket)->sd);
+#else
+	// close (((DCHK_SOCKET*)handle->socket)->sd);
+	shutdown(((DCHK_SOCKET*)handle->socket)->sd,SHUT_RDWR);
+#endif
+	((DCHK_SOCKET*)handle->socket)->sd=0;
+	irislwz_PipelineReset(handle);
+	return 1;
+}
+
+void irislwz_FreePacket(IRISLWZ_PACKET *p)
+/*!\brief Frees the memory used by an IRISLWZ_PACKET
  *
  * This function frees the memory allocated within an IRISLWZ_PACKET object.
- * The object itself is not freed.
+ * The object itself is not freed. Received packets and their decompressed payload point into
+ * buffers of the handle (see IRISLWZ_PACKET::shared), which are not freed.
  *
  * \param[in] p Pointer to an IRISLWZ_PACKET
  *
@@ -1050,9 +1743,10 @@ void irislwz_FreePacket(IRISLWZ_PACKET *p)
  */
 {
 	if (!p) return;
-	if (p->packet) free(p->packet);
-	if (p->uncompressed_payload!=NULL && p->uncompressed_payload!=p->payload) free(p->uncompressed_payload);
+	if (p->packet && !(p->shared&1)) free(p->packet);
+	if (p->uncompressed_payload!=NULL && p->uncompressed_payload!=p->payload && !(p->shared&2)) free(p->uncompressed_payload);
 	if (p->beautified) free(p->beautified);
+	irislwz_FreeDocument(p->doc);
 	bzero(p,sizeof(IRISLWZ_PACKET));
 }
 
@@ -1075,7 +1769,7 @@ int irislwz_PrepareQuery(IRISLWZ_HANDLE *handle)
 	if (!handle) return 0;
 	IRISLWZ_HEADER *header=handle->request.header;
 	header->header=0;
-	header->transactionId=htons(irislwz_rand(1,65534));
+	header->transactionId=htons(irislwz_NewTransactionId(handle));
 	header->max_response_length=htons(handle->maximumResponseLength);
 	if (handle->authority) {
 		header->authority_length=strlen(handle->authority);
@@ -1088,36 +1782,13 @@ int irislwz_PrepareQuery(IRISLWZ_HANDLE *handle)
 	return 1;
 }
 
-int irislwz_Talk(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *request, IRISLWZ_PACKET *response)
-/*!\brief Talk with an IRISLWZ server
- *
- * This function is used for communication with an IRISLWZ-server. The server must be
- * connected previously with \ref irislwz_Connect.
- *
- * \param[in] handle pointer to an IRISLWZ_HANDLE object
- * \param[in] request pointer to an IRISLWZ_PACKET object, which holds the request
- * \param[out] response pointer to an IRISLWZ_PACKET object, in which the answer is stored
- *
- * \returns On success, this function returns 1, on error 0.
+static void irislwz_OutputPacket(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *request)
+/*!\brief Prepare a request packet for sending
  *
- * \ingroup DCHK_API_IRISLWZ
+ * \internal
+ * This function applies the testing options to the \p request and prints the verbose output.
  */
 {
-	int e, ret;
-	if (!handle) return 0;
-	if (((DCHK_SOCKET*)handle->socket)->sd<=0) {
-		irislwz_SetError(handle,74032,NULL);
-		return 0;
-	}
-	if (!request) {
-		irislwz_SetError(handle,74025,"int irislwz_Talk(IRISLWZ_HANDLE *handle, ==> IRISLWZ_PACKET *request <==, IRISLWZ_PACKET *response)");
-		return 0;
-	}
-	if (!response) {
-		irislwz_SetError(handle,74025,"int irislwz_Talk(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *request, ==> IRISLWZ_PACKET *response <==)");
-		return 0;
-	}
-
 	// Testing options
 	if (handle->test_flags&8) request->header->authority_length=handle->test_authlen;
 	if (handle->test_flags&1) {
@@ -1132,16 +1803,25 @@ int irislwz_Talk(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *request, IRISLWZ_PACKET
 
 
 	if (handle->verboseflag&1) VerboseOut(handle,"Request",request->uncompressed_payload);
-	if (handle->verboseflag&2) VerboseOut(handle,"Request beautified",request->beautified);
+	if (handle->verboseflag&2) VerboseOut(handle,"Request beautified",irislwz_GetBeautified(handle,request));
 
 	if (handle->verboseflag&4) {
-		char *buffer=ExplainHeader(&handle->request);
+		char *buffer=ExplainHeader(request);
 		if (buffer) {
 			VerboseOut(handle,"Request Header",buffer);
 			free(buffer);
 		}
 	}
+}
 
+static int irislwz_TransmitPacket(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *request)
+/*!\brief Send a prepared request packet to the server
+ *
+ * \internal
+ * This function is used for the first transmission and retransmissions of a request.
+ */
+{
+	int e;
 	ssize_t bytes=send(((DCHK_SOCKET*)handle->socket)->sd, request->packet, request->size,0);
 	if (bytes<0) {
 		e=irislwz_TranslateSocketError();
@@ -1149,105 +1829,264 @@ int irislwz_Talk(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *request, IRISLWZ_PACKET
 		irislwz_SetError(handle,e,"%s:%i",handle->server,handle->port);
 		return 0;
 	}
-	size_t maxsize=handle->maximumResponseLength+8192;
-	void *buffer=malloc(maxsize);
-	if (!buffer) {
-		irislwz_SetError(handle,74024,NULL);
-		return 0;
-	}
-	bytes=recv(((DCHK_SOCKET*)handle->socket)->sd,(char*)buffer,maxsize,0);
-	if (bytes<=0) {
+	return 1;
+}
+
+static int irislwz_TransmitWithHeader(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *request, IRISLWZ_HEADER *header)
+/*!\brief Send a request packet with a different header
+ *
+ * \internal
+ * The \p header replaces the first 6 bytes of the \p request. Header and the rest of the
+ * packet are sent with a single gather write, so the packet does not need to be copied,
+ * e.g. for hedged requests.
+ */
+{
+	int e;
+	size_t headersize=request->size<6 ? request->size : 6;
+	size_t rest=request->size-headersize;
+#ifdef _WIN32
+	WSABUF buf[2];
+	DWORD sent=0;
+	buf[0].buf=(char*)header;
+	buf[0].len=(ULONG)headersize;
+	buf[1].buf=request->packet+headersize;
+	buf[1].len=(ULONG)rest;
+	if (WSASend(((DCHK_SOCKET*)handle->socket)->sd,buf,2,&sent,0,NULL,NULL)!=0) {
+#else
+	struct iovec iov[2];
+	struct msghdr msg;
+	iov[0].iov_base=header;
+	iov[0].iov_len=headersize;
+	iov[1].iov_base=request->packet+headersize;
+	iov[1].iov_len=rest;
+	bzero(&msg,sizeof(msg));
+	msg.msg_iov=iov;
+	msg.msg_iovlen=2;
+	if (sendmsg(((DCHK_SOCKET*)handle->socket)->sd,&msg,0)<0) {
+#endif
 		e=irislwz_TranslateSocketError();
-		if (e==1006) e=1031;
-		irislwz_SetError(handle,e,"%s:%i, Bytes: %i",handle->server,handle->port,bytes);
-		free(buffer);
+		irislwz_SetError(handle,e,"%s:%i",handle->server,handle->port);
 		return 0;
 	}
+	return 1;
+}
+
+static int irislwz_SendPacket(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *request)
+/*!\brief Send a request packet to the server
+ *
+ * \internal
+ * This function applies the testing options to the \p request and sends it to the server.
+ */
+{
+	irislwz_OutputPacket(handle,request);
+	return irislwz_TransmitPacket(handle,request);
+}
+
+static int irislwz_StorePacket(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *response, char *buffer, int bytes)
+/*!\brief Make a response packet point to a received datagram
+ *
+ * \internal
+ * The datagram is not copied, the \p buffer belongs to the handle and is reused by the
+ * next receive. There must be space for one more byte behind the datagram, which is used
+ * to terminate the payload.
+ */
+{
 	if (bytes<3) {
 		irislwz_SetError(handle,74036,"%i Bytes",bytes);
-		free(buffer);
 		return 0;
 	}
 	response->size=bytes;
-	response->packet=(char*)malloc(bytes+1);
-	if (!response->packet) {
-		irislwz_SetError(handle,74024,NULL);
-		free(buffer);
-		return 0;
-	}
-	memcpy(response->packet,buffer,bytes);
-	free(buffer);
+	response->packet=buffer;
+	response->shared=1;
 	response->header=(IRISLWZ_HEADER*)response->packet;
 	response->payload=response->packet+3;
 	response->size_payload=bytes-3;
 	response->payload[response->size_payload]=(unsigned char)0;
-	if (request->header->transactionId!=response->header->transactionId && response->header->transactionId!=0xffff) {
-		// TransactionId does not fit
-		irislwz_SetError(handle,74103,NULL);
+	return 1;
+}
+
+static int irislwz_ReceivePacket(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *response, int flags)
+/*!\brief Receive a response packet from the server
+ *
+ * \internal
+ * This function reads the next datagram from the socket into the receive buffer of the handle
+ * and lets \p response point to it. The payload is not decompressed. The \p flags are passed to recv. If MSG_DONTWAIT is
+ * used and no datagram is available, the function returns -1 without setting an error.
+ */
+{
+	int e;
+	int maxsize=handle->maximumResponseLength+8192;
+	if (handle->rxbuffersize<maxsize) {
+		// The buffer is allocated once and only grows when the maximum response length is raised
+		if (handle->rxbuffer) free(handle->rxbuffer);
+		handle->rxbuffersize=0;
+		handle->rxbuffer=(char*)malloc(maxsize+1);
+		if (!handle->rxbuffer) {
+			irislwz_SetError(handle,74024,NULL);
+			return 0;
+		}
+		handle->rxbuffersize=maxsize;
+	}
+	ssize_t bytes=recv(((DCHK_SOCKET*)handle->socket)->sd,handle->rxbuffer,handle->rxbuffersize,flags);
+	if (bytes<=0) {
+		e=irislwz_TranslateSocketError();
+		if (e==1006 && flags!=0) return -1;
+		if (e==1006) e=1031;
+		irislwz_SetError(handle,e,"%s:%i, Bytes: %i",handle->server,handle->port,bytes);
 		return 0;
 	}
+	return irislwz_StorePacket(handle,response,handle->rxbuffer,(int)bytes);
+}
+
+static int irislwz_DecodePacket(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *response)
+/*!\brief Decompress and validate a response packet
+ *
+ * \internal
+ */
+{
 	// is response compressed?
 	if ((response->header->header)&16) {
-		// DCHK answers compress really good, so we have to allocate a big
-		// buffer for decompression. We use 10 times the compressed size plus a bit extra
-		uLongf dstlen=(bytes-3)*10+1024;
-		//printf ("Bytes= %i, dstlen=%i\n",bytes,dstlen);
-		int retrycounter=0;
-		while (1) {
-			response->uncompressed_payload=(char*)malloc(dstlen);
-			uLongf srclen=bytes-3;
-			if (handle->rfc1950_workaround) ret=uncompress((Bytef*)response->uncompressed_payload,&dstlen,
-					(const Bytef*) response->payload,srclen);
-			else ret=rfc1951_inflate((Bytef*)response->uncompressed_payload,&dstlen,
-					(const Bytef*) response->payload,srclen);
-			if (ret!=Z_OK) {
-				if (ret==Z_BUF_ERROR && retrycounter<5) {
-					// We increase the buffer for uncompressed data
-					free(response->uncompressed_payload);
-					dstlen+=dstlen;
-					//printf ("Increasing decompression-Buffer to %i Bytes\n",dstlen);
-					response->uncompressed_payload=(char*)malloc(dstlen);
-					retrycounter++;
-					continue;
+		if (!irislwz_Inflate(handle,response)) {
+			if (handle->verboseflag&32) {
+				char *buffer=ExplainHeader(response);
+				if (buffer) {
+					VerboseOut(handle,"Response Header",buffer);
+					free(buffer);
 				}
-				if (handle->verboseflag&32) {
-					char *buffer=ExplainHeader(&handle->response);
-					if (buffer) {
-						VerboseOut(handle,"Response Header",buffer);
-						free(buffer);
-						//irislwz_HexDump(response->payload,srclen);
-					}
-				}
-				irislwz_SetError(handle,74037,NULL);
-				return 0;
-			} else {
-				break;
 			}
+			return 0;
 		}
-		response->size_uncompressed=dstlen;
 	} else {
 		response->uncompressed_payload=response->payload;
 		response->size_uncompressed=response->size_payload;
 	}
 	if (handle->verboseflag&32) {
-		char *buffer=ExplainHeader(&handle->response);
+		char *buffer=ExplainHeader(response);
 		if (buffer) {
 			VerboseOut(handle,"Response Header",buffer);
 			free(buffer);
 		}
 	}
 
+	response->uncompressed_payload[response->size_uncompressed]=0;
 	if ((handle->verboseflag&8) && (response->uncompressed_payload)) VerboseOut(handle,"Response",response->uncompressed_payload);
 
-	response->uncompressed_payload[response->size_uncompressed]=0;
-	if (irislwz_Validate(handle,response->uncompressed_payload,&response->beautified)) {
-		if (handle->verboseflag&16) VerboseOut(handle,"Response beautified",response->beautified);
+	// Answers known to the scanner are not parsed by libxml2 at all
+	if (irislwz_ScanPacket(handle,response) || irislwz_ParsePacket(handle,response)) {
+		if (handle->verboseflag&16) VerboseOut(handle,"Response beautified",irislwz_GetBeautified(handle,response));
 		return 1;
 	}
 	if (handle->error==74044) handle->error=74046;
 	return 0;
 }
 
+int irislwz_Talk(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *request, IRISLWZ_PACKET *response)
+/*!\brief Talk with an IRISLWZ server
+ *
+ * This function is used for communication with an IRISLWZ-server. The server must be
+ * connected previously with \ref irislwz_Connect.
+ *
+ * If the answer does not arrive within the retransmission timeout, the request is sent again
+ * with the same transaction id, up to the number of times set with \ref irislwz_SetRetries.
+ * The retransmission timeout is calculated from the measured round trip times to the server
+ * and doubled with every retransmission. The function gives up, when the timeout set by
+ * \ref irislwz_SetTimeout is reached. Answers with a different transaction id, e.g. late
+ * answers to previous requests, are discarded.
+ *
+ * If hedging is enabled with \ref irislwz_SetHedging, a copy of the request with a new
+ * transaction id is sent, when the answer takes longer than usual. The first answer to
+ * one of both requests is returned, the other one is discarded.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] request pointer to an IRISLWZ_PACKET object, which holds the request
+ * \param[out] response pointer to an IRISLWZ_PACKET object, in which the answer is stored
+ *
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (((DCHK_SOCKET*)handle->socket)->sd<=0) {
+		irislwz_SetError(handle,74032,NULL);
+		return 0;
+	}
+	if (!request) {
+		irislwz_SetError(handle,74025,"int irislwz_Talk(IRISLWZ_HANDLE *handle, ==> IRISLWZ_PACKET *request <==, IRISLWZ_PACKET *response)");
+		return 0;
+	}
+	if (!response) {
+		irislwz_SetError(handle,74025,"int irislwz_Talk(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *request, ==> IRISLWZ_PACKET *response <==)");
+		return 0;
+	}
+	int ret, retransmits=0, hedged=0;
+	long long now, sent, expire, next, wait, hedgetime, hedgesent=0;
+	IRISLWZ_HEADER hedge;
+	bzero(&hedge,sizeof(IRISLWZ_HEADER));
+	if (!irislwz_SendPacket(handle,request)) return 0;
+	sent=irislwz_GetTime();
+	expire=irislwz_GetExpireTime(handle,sent);
+	int rto=irislwz_CurrentRTO(handle);
+	next=sent+rto;
+	hedgetime=irislwz_GetHedgeDelay(handle);
+	if (hedgetime>=0) hedgetime+=sent;
+	while (1) {
+		now=irislwz_GetTime();
+		if (expire!=IRISLWZ_NO_DEADLINE && now>=expire) {
+			irislwz_SetError(handle,1031,"%s:%i",handle->server,handle->port);
+			return 0;
+		}
+		if (hedgetime>=0 && now>=hedgetime) {
+			// Send a copy of the request with a new transaction id. If this fails, we
+			// just keep waiting for the answer to the original request.
+			// Only the header is copied, the rest of the packet is shared with the request.
+			hedgetime=-1;
+			memcpy(&hedge,request->packet,request->size<6 ? request->size : 6);
+			hedge.transactionId=htons(irislwz_NewTransactionId(handle));
+			irislwz_Debug(handle,2,"Hedging request with transaction id %i, new transaction id %i",
+					ntohs(request->header->transactionId),ntohs(hedge.transactionId));
+			if (irislwz_TransmitWithHeader(handle,request,&hedge)) {
+				hedgesent=irislwz_GetTime();
+				hedged=1;
+			}
+			continue;
+		}
+		if (retransmits<handle->retries && now>=next) {
+			irislwz_Debug(handle,2,"Retransmitting request with transaction id %i",
+					ntohs(request->header->transactionId));
+			if (!irislwz_TransmitPacket(handle,request)) return 0;
+			retransmits++;
+			rto*=2;
+			if (rto>IRISLWZ_RTO_MAX) rto=IRISLWZ_RTO_MAX;
+			next=now+rto;
+			continue;
+		}
+		wait=-1;
+		if (retransmits<handle->retries) wait=next-now;
+		if (hedgetime>=0 && (wait<0 || hedgetime-now<wait)) wait=hedgetime-now;
+		if (expire!=IRISLWZ_NO_DEADLINE && (wait<0 || expire-now<wait)) wait=expire-now;
+		ret=irislwz_WaitForData(handle,wait);
+		if (ret==0) continue;
+		if (ret>0) ret=irislwz_ReceivePacket(handle,response,0);
+		if (ret!=1) return 0;
+		if (hedged && hedge.transactionId==response->header->transactionId) {
+			// The hedged request won, its round trip time is not ambiguous
+			irislwz_UpdateRTT(handle,irislwz_GetTime()-hedgesent);
+		} else if (request->header->transactionId!=response->header->transactionId && response->header->transactionId!=0xffff) {
+			// TransactionId does not fit, probably a late answer to a previous request
+			irislwz_Debug(handle,2,"Discarding answer with unknown transaction id %i",
+					ntohs(response->header->transactionId));
+			irislwz_FreePacket(response);
+			continue;
+		} else if (retransmits==0) {
+			// Karn's rule: the round trip time of a retransmitted request is ambiguous
+			irislwz_UpdateRTT(handle,irislwz_GetTime()-sent);
+		}
+		return irislwz_DecodePacket(handle,response);
+	}
+	return 0;
+}
+
 int irislwz_QueryVersion(IRISLWZ_HANDLE *handle)
 /*!\brief Send a version request to the server
  *
@@ -1316,13 +2155,90 @@ int irislwz_GetCompressedSize(const char *buffer, int size, int rfc1950)
 	if (!dst) return 0;
 	if (rfc1950==1) suberr=compress2((Bytef*)dst,(uLongf *)&dstlen,(const Bytef*)buffer,size,Z_BEST_COMPRESSION);
 	else suberr=rfc1951_deflate((Bytef*)dst,(uLongf *)&dstlen,(const Bytef*)buffer,size,Z_BEST_COMPRESSION);
-	if (suberr!=Z_OK) {
-		return 0;
-	}
 	free(dst);
+	if (suberr!=Z_OK) return 0;
 	return (int)dstlen;
 }
 
+static int irislwz_BuildRequest(IRISLWZ_HANDLE *handle, const char *payload, int bytes, int validate)
+/*!\brief Build a request packet
+ *
+ * \internal
+ * This function builds the complete request packet for \p payload in the request
+ * structure of the \p handle, including the IRISLWZ header and the optional compression.
+ * The payload is copied or compressed only once, directly behind the header. An uncompressed
+ * request uses the payload inside the packet as its uncompressed_payload. In compression mode
+ * IRISLWZ_COMPRESSION_AUTO the uncompressed payload replaces the compressed one, if compression
+ * does not save enough. If \p validate is 0, the payload was built by the library and is
+ * not validated again.
+ */
+{
+	int c,p;
+	irislwz_FreePacket(&handle->request);
+
+	int headersize=6;
+	if (handle->authority) headersize+=strlen(handle->authority);
+	// Do we want to deflate the request packet? compressBound is big enough for
+	// RFC 1950 and RFC 1951.
+	int size=bytes;
+	if (handle->sendDeflated) size=(int)compressBound(bytes)+16;
+	handle->request.packet=(char*)malloc(headersize+size+1);
+	if (!handle->request.packet) {
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	handle->request.header=(IRISLWZ_HEADER*)handle->request.packet;
+	irislwz_PrepareQuery(handle);
+	handle->request.payload=handle->request.packet+headersize;
+	if (handle->authority) handle->request.authority=handle->request.packet+6;
+
+	if (handle->sendDeflated) {
+		// We need a copy of the uncompressed payload for validation and verbose output
+		handle->request.uncompressed_payload=(char*)malloc(bytes+1);
+		if (!handle->request.uncompressed_payload) {
+			irislwz_SetError(handle,74024,NULL);
+			return 0;
+		}
+		memcpy(handle->request.uncompressed_payload,payload,bytes);
+	} else {
+		memcpy(handle->request.payload,payload,bytes);
+		handle->request.uncompressed_payload=handle->request.payload;
+	}
+	handle->request.uncompressed_payload[bytes]=0;
+	handle->request.size_uncompressed=bytes;
+	// The beautified version is only created on demand (irislwz_GetBeautified)
+	if (validate && handle->dontValidateInput==0) {
+		if (!irislwz_Validate(handle,handle->request.uncompressed_payload,NULL)) {
+			if (handle->error==74044) handle->error=74045;
+			if (!handle->ignoreInvalidXML) return 0;
+		}
+	}
+
+	// Send deflated?
+	if (handle->sendDeflated) {
+		// Compress with the codec of the handle
+		if (!irislwz_Deflate(handle,handle->request.payload,&size,payload,bytes)) return 0;
+		if (handle->sendDeflated==IRISLWZ_COMPRESSION_AUTO && size+handle->deflateThreshold>=bytes) {
+			// Compression does not pay, the request is sent uncompressed
+			free(handle->request.uncompressed_payload);
+			memcpy(handle->request.payload,payload,bytes);
+			handle->request.payload[bytes]=0;
+			handle->request.uncompressed_payload=handle->request.payload;
+			handle->request.header->header&=~16;
+			size=bytes;
+		} else if (handle->test_flags&32) {
+			// Corrupt compression
+			for (c=0;c<20;c++) {
+				p=irislwz_rand(0,size);
+				handle->request.payload[p]=irislwz_rand(0,255);
+			}
+		}
+	}
+	handle->request.size_payload=size;
+	handle->request.size=headersize+size;
+	return 1;
+}
+
 int irislwz_Query(IRISLWZ_HANDLE *handle, const char *payload)
 /*!\brief Send a request to an IRISLWZ server
  *
@@ -1363,7 +2279,6 @@ int irislwz_Query2(IRISLWZ_HANDLE *handle, const char *payload, int bytes)
  * \ingroup DCHK_API_IRISLWZ
  */
 {
-	int c,p,suberr;
 	if (!handle) return 0;
 	if (!payload) {
 		irislwz_SetError(handle,74025,"int irislwz_Query2(IRISLWZ_HANDLE *handle, ==> char *payload <==, int bytes)");
@@ -1373,106 +2288,874 @@ int irislwz_Query2(IRISLWZ_HANDLE *handle, const char *payload, int bytes)
 		irislwz_SetError(handle,74025,"int irislwz_Query2(IRISLWZ_HANDLE *handle, char *payload, ==> int bytes <==)");
 		return 0;
 	}
-	irislwz_FreePacket(&handle->request);
+	return irislwz_QueryPayload(handle,payload,bytes,1);
+}
+
+int irislwz_QueryPayload(IRISLWZ_HANDLE *handle, const char *payload, int bytes, int validate)
+/*!\brief Send a request to an IRISLWZ server
+ *
+ * \internal
+ * Works like \ref irislwz_Query2. Requests built by the library are sent with \p validate
+ * set to 0, so they are not validated again.
+ */
+{
 	irislwz_FreePacket(&handle->response);
+	if (!irislwz_BuildRequest(handle,payload,bytes,validate)) return 0;
+	return irislwz_Talk(handle,&handle->request, &handle->response);
+}
 
-	// We copy the uncompressed payload into the request structure
-	handle->request.uncompressed_payload=(char*)malloc(bytes+1);
-	if (!handle->request.uncompressed_payload) {
-		irislwz_SetError(handle,74024,NULL);
+int irislwz_CheckResponse(IRISLWZ_HANDLE *handle)
+/*!\brief Check response if it contains size or other information
+ *
+ * This function can be used to check if a response packet contains size information or other
+ * information.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ *
+ * \returns
+ * The function returns 1, if there is no flag indicating size or other information. Otherwise it returns 0
+ * and an apropriate errorcode is set. It can also return 0, if the \p handle parameter is NULL.
+ *
+ * \since
+ * Version 0.5.4
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ *
+ */
+{
+	if (!handle) return 0;
+	// Size Information
+	if ((handle->response.header->header&3)==2) {
+		int octets=dchk_XML_ParseSize(handle);
+		if (octets) irislwz_SetError(handle,74040,"required: %i bytes, maximum set: %i bytes",octets,
+				handle->maximumResponseLength);
 		return 0;
 	}
-	memcpy(handle->request.uncompressed_payload,payload,bytes);
-	handle->request.uncompressed_payload[bytes]=0;
-	handle->request.size_uncompressed=bytes;
-	// beautify it
-	if (handle->dontValidateInput==0) {
-		if (!irislwz_Validate(handle,handle->request.uncompressed_payload,&handle->request.beautified)) {
-			if (handle->error==74044) handle->error=74045;
-			if (!handle->ignoreInvalidXML) return 0;
-		}
+	// Other Information, usually error messages from the server
+	if ((handle->response.header->header&3)==3) {
+		if (dchk_XML_ParseOther(handle)) return 0;
+		irislwz_SetError(handle,74047,NULL);
+		return 0;
 	}
-	// Do we want to deflate the request packet?
-	size_t size;
-	if (handle->sendDeflated) {
-		size=irislwz_GetCompressedSize(payload,handle->request.size_uncompressed, handle->rfc1950_workaround);
-		if (!size) {
-			irislwz_SetError(handle,74039,NULL);
+	return 1;
+}
+
+static int irislwz_ReceiveBatch(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *response, int flags)
+/*!\brief Receive a response packet using the receive ring
+ *
+ * \internal
+ * If the ring is empty, all datagrams waiting on the socket are read with a single call of
+ * recvmmsg into the ring. Then the next datagram is taken from the ring. Return values
+ * are the same as of irislwz_ReceivePacket.
+ */
+{
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	if (pl==NULL || pl->batch<2) return irislwz_ReceivePacket(handle,response,flags);
+#ifdef IRISLWZ_HAVE_MMSG
+	int i, e;
+	if (pl->ringcount==0) {
+		if (!irislwz_AllocRing(handle,pl)) return 0;
+		for (i=0;i<pl->batch;i++) {
+			pl->riov[i].iov_len=pl->ringbuffersize-1;
+			pl->rmsg[i].msg_len=0;
+		}
+		// Block for the first datagram only if the caller wants to block
+		int n=recvmmsg(((DCHK_SOCKET*)handle->socket)->sd,pl->rmsg,pl->batch,
+				flags==0 ? MSG_WAITFORONE : flags,NULL);
+		if (n<=0) {
+			e=irislwz_TranslateSocketError();
+			if (e==1006 && flags!=0) return -1;
+			if (e==1006) e=1031;
+			irislwz_SetError(handle,e,"%s:%i",handle->server,handle->port);
 			return 0;
 		}
+		for (i=0;i<n;i++) pl->ringlength[i]=(int)pl->rmsg[i].msg_len;
+		pl->ringhead=0;
+		pl->ringcount=n;
+	}
+	i=pl->ringhead++;
+	pl->ringcount--;
+	return irislwz_StorePacket(handle,response,pl->ring+(size_t)i*pl->ringbuffersize,pl->ringlength[i]);
+#else
+	return irislwz_ReceivePacket(handle,response,flags);
+#endif
+}
+
+static void irislwz_SetNextEvent(IRISLWZ_HANDLE *handle, IRISLWZ_PIPELINE *pl, IRISLWZ_TRANSACTION *t)
+/*!\brief Schedule the next retransmission or the timeout of a transaction
+ *
+ * \internal
+ */
+{
+	t->deadline=t->expire;
+	if (t->retransmits<handle->retries && t->sent+t->rto<t->deadline) t->deadline=t->sent+t->rto;
+	irislwz_HeapUpdate(pl,t->heappos);
+}
+
+static void irislwz_SetDeadline(IRISLWZ_HANDLE *handle, IRISLWZ_PIPELINE *pl, int slot, long long now)
+/*!\brief Start the timers of a transaction, which was just sent
+ *
+ * \internal
+ */
+{
+	IRISLWZ_TRANSACTION *t=&pl->slots[slot];
+	t->sent=now;
+	t->expire=irislwz_GetExpireTime(handle,now);
+	t->rto=irislwz_CurrentRTO(handle);
+	t->retransmits=0;
+	irislwz_SetNextEvent(handle,pl,t);
+}
+
+static int irislwz_Retransmit(IRISLWZ_HANDLE *handle, IRISLWZ_PIPELINE *pl, long long now)
+/*!\brief Retransmit all requests, whose retransmission timeout is reached
+ *
+ * \internal
+ * Requests are retransmitted with the same transaction id and the retransmission timeout
+ * of the request is doubled (exponential backoff). Retransmissions are not batched, as they
+ * should be rare.
+ *
+ * \returns Returns 1, if the oldest request reached its timeout or could not be sent and
+ * must be expired, otherwise 0.
+ */
+{
+	IRISLWZ_TRANSACTION *t;
+	while (pl->outstanding) {
+		t=&pl->slots[pl->heap[0]];
+		if (t->deadline==IRISLWZ_NO_DEADLINE || t->deadline>now) return 0;
+		if (t->error || t->deadline>=t->expire || t->retransmits>=handle->retries) return 1;
+		irislwz_Debug(handle,2,"Retransmitting request with transaction id %i",t->tid);
+		if (!irislwz_TransmitPacket(handle,&t->request)) {
+			t->error=handle->error;
+			return 1;
+		}
+		t->retransmits++;
+		t->sent=now;
+		t->rto*=2;
+		if (t->rto>IRISLWZ_RTO_MAX) t->rto=IRISLWZ_RTO_MAX;
+		irislwz_SetNextEvent(handle,pl,t);
+	}
+	return 0;
+}
+
+static void irislwz_CompleteTransaction(IRISLWZ_HANDLE *handle, int slot, void **privatedata)
+/*!\brief Remove a transaction from the pipeline and make its request the current one
+ *
+ * \internal
+ */
+{
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	IRISLWZ_TRANSACTION *t=&pl->slots[slot];
+	if (privatedata) *privatedata=t->privatedata;
+	irislwz_FreePacket(&handle->request);
+	handle->request=t->request;
+	bzero(&t->request,sizeof(IRISLWZ_PACKET));
+	irislwz_ReleaseTransaction(pl,slot);
+}
+
+static void irislwz_ExpireTransaction(IRISLWZ_HANDLE *handle, void **privatedata)
+/*!\brief Remove the oldest request because of a timeout or send error
+ *
+ * \internal
+ */
+{
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	int e=pl->slots[pl->heap[0]].error;
+	irislwz_CompleteTransaction(handle,pl->heap[0],privatedata);
+	if (e==0) e=1031;
+	irislwz_SetError(handle,e,"%s:%i",handle->server,handle->port);
+}
+
+static int irislwz_ReadAnswer(IRISLWZ_HANDLE *handle, void **privatedata, int flags)
+/*!\brief Read one datagram and match it to an outstanding request
+ *
+ * \internal
+ * \returns Returns 1 if the answer was matched and decoded, 0 on error, -1 if no datagram
+ * was available and -2 if the datagram was discarded.
+ */
+{
+	int slot, ret;
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	irislwz_FreePacket(&handle->response);
+	ret=irislwz_ReceiveBatch(handle,&handle->response,flags);
+	if (ret!=1) return ret;
+	unsigned short tid=ntohs(handle->response.header->transactionId);
+	if (tid==0xffff) {
+		// Server could not read the transaction id, we assign the answer to the oldest request
+		slot=pl->heap[0];
+	} else if (pl->slotbytid[tid]) {
+		slot=pl->slotbytid[tid]-1;
 	} else {
-		size=handle->request.size_uncompressed;
+		irislwz_Debug(handle,2,"Discarding answer with unknown transaction id %i",tid);
+		irislwz_FreePacket(&handle->response);
+		return -2;
 	}
-	handle->request.size_payload=size;
-	handle->request.size=6;
-	if (handle->authority) handle->request.size+=strlen(handle->authority);
-	handle->request.size+=size;
-	handle->request.packet=(char*)malloc(handle->request.size+16);
-	if (!handle->request.packet) {
-		irislwz_SetError(handle,74024,NULL);
+	// Karn's rule: the round trip time of a retransmitted request is ambiguous
+	IRISLWZ_TRANSACTION *t=&pl->slots[slot];
+	if (t->retransmits==0 && t->unsentpos<0 && t->error==0) irislwz_UpdateRTT(handle,irislwz_GetTime()-t->sent);
+	irislwz_CompleteTransaction(handle,slot,privatedata);
+	return irislwz_DecodePacket(handle,&handle->response);
+}
+
+int irislwz_SetWindow(IRISLWZ_HANDLE *handle, int requests)
+/*!\brief Set maximum number of outstanding requests
+ *
+ * With this function you can define how many requests may be sent to the server
+ * by \ref irislwz_PipelineSend without waiting for their answers. Each outstanding request
+ * gets its own transaction id, which is unique among all outstanding requests, so the
+ * answers can be matched to their requests in any order. By default the window is 1,
+ * which means \ref dchk_QueryDomainList will wait for each answer before sending the
+ * next request.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] requests Number of requests between 1 and 65534
+ * \returns On success, this function returns 1, on error 0. The window can not be changed
+ * while there are outstanding requests.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (requests<1 || requests>65534) {
+		irislwz_SetError(handle,74065,"int irislwz_SetWindow(IRISLWZ_HANDLE *handle, ==> int requests <==)");
 		return 0;
 	}
-	handle->request.header=(IRISLWZ_HEADER*)handle->request.packet;
-	irislwz_PrepareQuery(handle);
-	handle->request.payload=handle->request.packet+(handle->request.size-size);
-	if (handle->authority) handle->request.authority=handle->request.packet+6;
+	if (irislwz_PipelineOutstanding(handle)) {
+		irislwz_SetError(handle,74062,NULL);
+		return 0;
+	}
+	irislwz_FreePipeline(handle);
+	handle->window=requests;
+	return 1;
+}
 
-	// Send deflated?
-	if (handle->sendDeflated) {
-		uLongf dstlen=size+16;
-		// Compress with zlib
-		if (handle->rfc1950_workaround) suberr=compress2((Bytef*)handle->request.payload,(uLongf *)&dstlen,(const Bytef*)payload,strlen(payload),Z_BEST_COMPRESSION);
-		else suberr=rfc1951_deflate((Bytef*)handle->request.payload,(uLongf *)&dstlen,(const Bytef*)payload,strlen(payload),Z_BEST_COMPRESSION);
-		if (suberr!=Z_OK) {
-			irislwz_SetError(handle,74039,NULL);
-			return 0;
-		}
-		// Corrupt compression?
-		if (handle->test_flags&32) {
-			for (c=0;c<20;c++) {
-				p=irislwz_rand(0,dstlen);
-				handle->request.payload[p]=irislwz_rand(0,255);
-			}
-		}
+int irislwz_SetBatchSize(IRISLWZ_HANDLE *handle, int packets)
+/*!\brief Enable batched I/O
+ *
+ * Sending and receiving every datagram with its own system call is expensive at high query rates.
+ * With batched I/O enabled, \ref irislwz_PipelineSend collects up to \p packets request packets
+ * and sends them with a single system call (see \ref irislwz_PipelineFlush). Answers are read in
+ * the same way: all answers waiting on the socket are read with one system call into a ring of
+ * preallocated buffers. On Linux sendmmsg and recvmmsg are used, on other platforms the packets are
+ * still sent and received one by one.
+ *
+ * Batched I/O only affects the pipeline functions and \ref dchk_QueryDomainList with a window
+ * greater than 1. It should not be bigger than the window (see \ref irislwz_SetWindow).
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] packets Maximum number of packets per system call between 1 and 1024. A value
+ * of 1 disables batched I/O, which is the default.
+ * \returns On success, this function returns 1, on error 0. The batch size can not be changed
+ * while there are outstanding requests.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (packets<1 || packets>1024) {
+		irislwz_SetError(handle,74065,"int irislwz_SetBatchSize(IRISLWZ_HANDLE *handle, ==> int packets <==)");
+		return 0;
+	}
+	if (irislwz_PipelineOutstanding(handle)) {
+		irislwz_SetError(handle,74062,NULL);
+		return 0;
+	}
+	irislwz_FreePipeline(handle);
+	handle->batch=packets;
+	return 1;
+}
 
-	} else {
-		memcpy(handle->request.payload,payload,size);
+int irislwz_SetRetries(IRISLWZ_HANDLE *handle, int retries)
+/*!\brief Set number of retransmissions
+ *
+ * UDP does not guarantee the delivery of a datagram, so a request or its answer can get lost.
+ * As recommended by <a href="http://tools.ietf.org/html/rfc4993">RFC 4993</a>, the library
+ * retransmits a request, if its answer does not arrive within the retransmission timeout (RTO).
+ * The RTO is calculated from the measured round trip times to the server as described in
+ * <a href="http://tools.ietf.org/html/rfc6298">RFC 6298</a>. Until the first round trip time is
+ * measured, the RTO is 1 second. It is doubled with every retransmission of the same request.
+ * Round trip times of retransmitted requests are not measured (Karn's rule).
+ *
+ * A retransmitted request uses the same transaction id, so the answer to any of the transmissions
+ * is accepted. The request fails, when the timeout set by \ref irislwz_SetTimeout is reached.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] retries Maximum number of retransmissions of a request between 0 and 20.
+ * A value of 0 disables retransmissions. The default is 3.
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (retries<0 || retries>20) {
+		irislwz_SetError(handle,74065,"int irislwz_SetRetries(IRISLWZ_HANDLE *handle, ==> int retries <==)");
+		return 0;
 	}
-	return irislwz_Talk(handle,&handle->request, &handle->response);
+	handle->retries=retries;
+	return 1;
 }
 
-int irislwz_CheckResponse(IRISLWZ_HANDLE *handle)
-/*!\brief Check response if it contains size or other information
+int irislwz_GetRTO(IRISLWZ_HANDLE *handle)
+/*!\brief Returns the current retransmission timeout
  *
- * This function can be used to check if a response packet contains size information or other
- * information.
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \returns Retransmission timeout for the next request in milliseconds, as calculated from the
+ * round trip times measured since \ref irislwz_Connect (see \ref irislwz_SetRetries).
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	return irislwz_CurrentRTO(handle)/1000;
+}
+
+int irislwz_SetHedging(IRISLWZ_HANDLE *handle, int percentile)
+/*!\brief Enable hedged requests
+ *
+ * Most of the time the server answers within a few milliseconds, but sometimes an answer is slow
+ * or gets lost. With hedging enabled, \ref irislwz_Talk sends a copy of the request with a new
+ * transaction id, if the answer did not arrive after the given \p percentile of the last
+ * round trip times (at most \ref IRISLWZ_RTT_HISTORY). The first answer to one of both requests
+ * wins, the other one is discarded when it arrives. This reduces the latency of the slowest
+ * requests at the cost of some additional requests to the server.
+ *
+ * The copy is made from the request packet already built, so the payload is not compressed again.
+ * Hedging starts after a few round trip times have been measured, before that only
+ * retransmissions are used (see \ref irislwz_SetRetries). It only affects the blocking functions
+ * like \ref irislwz_Query or \ref dchk_QueryDomainList without window, not the pipeline.
  *
  * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] percentile Percentile of the round trip times between 1 and 99, e.g. 95. A value
+ * of 0 disables hedging, which is the default.
+ * \returns On success, this function returns 1, on error 0.
  *
- * \returns
- * The function returns 1, if there is no flag indicating size or other information. Otherwise it returns 0
- * and an apropriate errorcode is set. It can also return 0, if the \p handle parameter is NULL.
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (percentile<0 || percentile>99) {
+		irislwz_SetError(handle,74065,"int irislwz_SetHedging(IRISLWZ_HANDLE *handle, ==> int percentile <==)");
+		return 0;
+	}
+	handle->hedge=percentile;
+	return 1;
+}
+
+int irislwz_PipelineSend(IRISLWZ_HANDLE *handle, const char *payload, int bytes, void *privatedata)
+/*!\brief Send a request without waiting for the answer
+ *
+ * This function builds a request packet for \p payload and sends it to the server, but
+ * does not wait for the answer. Use \ref irislwz_PipelineReceive to collect the answers.
+ * Up to the number of requests set with \ref irislwz_SetWindow can be outstanding at the
+ * same time.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] payload Request, which should be send to IRIS server
+ * \param[in] bytes Size of the payload
+ * \param[in] privatedata Pointer to some optional data, which is returned by
+ * \ref irislwz_PipelineReceive together with the answer to this request
+ * \returns On success, this function returns 1, on error 0. If the window is full, error
+ * 74063 is set.
  *
  * \since
- * Version 0.5.4
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (!payload) {
+		irislwz_SetError(handle,74025,"int irislwz_PipelineSend(IRISLWZ_HANDLE *handle, ==> char *payload <==, int bytes, void *privatedata)");
+		return 0;
+	}
+	if (bytes<1) {
+		irislwz_SetError(handle,74025,"int irislwz_PipelineSend(IRISLWZ_HANDLE *handle, char *payload, ==> int bytes <==, void *privatedata)");
+		return 0;
+	}
+	return irislwz_PipelineSendPayload(handle,payload,bytes,privatedata,1);
+}
+
+int irislwz_PipelineSendPayload(IRISLWZ_HANDLE *handle, const char *payload, int bytes, void *privatedata, int validate)
+/*!\brief Send a request without waiting for the answer
+ *
+ * \internal
+ * Works like \ref irislwz_PipelineSend. Requests built by the library are sent with
+ * \p validate set to 0, so they are not validated again.
+ */
+{
+	if (((DCHK_SOCKET*)handle->socket)->sd<=0) {
+		irislwz_SetError(handle,74032,NULL);
+		return 0;
+	}
+	IRISLWZ_PIPELINE *pl=irislwz_GetPipeline(handle);
+	if (!pl) return 0;
+	if (pl->numfree==0) {
+		irislwz_SetError(handle,74063,NULL);
+		return 0;
+	}
+	if (!irislwz_BuildRequest(handle,payload,bytes,validate)) return 0;
+	if (pl->batch>1) irislwz_OutputPacket(handle,&handle->request);
+	else if (!irislwz_SendPacket(handle,&handle->request)) return 0;
+	int slot=pl->freeslots[--pl->numfree];
+	IRISLWZ_TRANSACTION *t=&pl->slots[slot];
+	// The pipeline takes over the request packet
+	t->request=handle->request;
+	bzero(&handle->request,sizeof(IRISLWZ_PACKET));
+	t->privatedata=privatedata;
+	t->error=0;
+	t->tid=ntohs(t->request.header->transactionId);
+	t->deadline=IRISLWZ_NO_DEADLINE;
+	// If the transaction id is already in use (only possible with irislwz_TestSetTransactionId),
+	// answers are matched to the newest request
+	pl->slotbytid[t->tid]=(unsigned short)(slot+1);
+	t->heappos=pl->outstanding;
+	pl->heap[pl->outstanding++]=slot;
+	if (pl->batch>1) {
+		// Request is sent with the next batch
+		t->unsentpos=pl->numunsent;
+		pl->unsent[pl->numunsent++]=slot;
+		if (pl->numunsent>=pl->batch) irislwz_PipelineFlush(handle);
+	} else {
+		irislwz_SetDeadline(handle,pl,slot,irislwz_GetTime());
+	}
+	return 1;
+}
+
+int irislwz_PipelineFlush(IRISLWZ_HANDLE *handle)
+/*!\brief Send all queued requests
+ *
+ * If batched I/O is enabled with \ref irislwz_SetBatchSize, \ref irislwz_PipelineSend only
+ * queues the request packets. This function sends all queued packets at once, on Linux with a
+ * single call of sendmmsg. It is called automatically when the batch is full and before
+ * waiting for answers, so usually there is no need to call it directly.
+ *
+ * The timeout of a request starts when it is sent. Requests which could not be sent, stay
+ * in the pipeline and are reported by \ref irislwz_PipelineReceive or \ref irislwz_PipelineExpire
+ * with the error code of the failed send.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \returns Returns 1, if all queued requests were sent, otherwise 0.
+ *
+ * \since
+ * Version 0.5.8
  *
  * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	int i, slot, e=0, sent=0;
+	IRISLWZ_TRANSACTION *t;
+	if (!handle) return 0;
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	if (pl==NULL || pl->numunsent==0) return 1;
+#ifdef IRISLWZ_HAVE_MMSG
+	for (i=0;i<pl->numunsent;i++) {
+		t=&pl->slots[pl->unsent[i]];
+		pl->siov[i].iov_base=t->request.packet;
+		pl->siov[i].iov_len=t->request.size;
+		pl->smsg[i].msg_hdr.msg_iov=&pl->siov[i];
+		pl->smsg[i].msg_hdr.msg_iovlen=1;
+	}
+	while (sent<pl->numunsent) {
+		int n=sendmmsg(((DCHK_SOCKET*)handle->socket)->sd,pl->smsg+sent,pl->numunsent-sent,0);
+		if (n<0) {
+			// The packet at position "sent" failed, we try the remaining ones
+			e=irislwz_TranslateSocketError();
+			if (e==1062) continue;		// EINTR
+			pl->slots[pl->unsent[sent]].error=e;
+			n=1;
+		}
+		sent+=n;
+	}
+#else
+	for (sent=0;sent<pl->numunsent;sent++) {
+		t=&pl->slots[pl->unsent[sent]];
+		if (send(((DCHK_SOCKET*)handle->socket)->sd,t->request.packet,t->request.size,0)<0) {
+			e=irislwz_TranslateSocketError();
+			t->error=e;
+		}
+	}
+#endif
+	long long now=irislwz_GetTime();
+	for (i=0;i<pl->numunsent;i++) {
+		slot=pl->unsent[i];
+		t=&pl->slots[slot];
+		t->unsentpos=-1;
+		if (t->error) {
+			// Report the error as soon as possible
+			t->deadline=now;
+			t->expire=now;
+			irislwz_HeapUpdate(pl,t->heappos);
+		} else {
+			irislwz_SetDeadline(handle,pl,slot,now);
+		}
+	}
+	pl->numunsent=0;
+	if (e) {
+		irislwz_SetError(handle,e,"%s:%i",handle->server,handle->port);
+		return 0;
+	}
+	return 1;
+}
+
+int irislwz_PipelineReceive(IRISLWZ_HANDLE *handle, void **privatedata)
+/*!\brief Wait for the answer of an outstanding request
+ *
+ * This function waits for the next answer to one of the requests sent with
+ * \ref irislwz_PipelineSend. Answers can arrive in any order, they are matched to their
+ * requests by the transaction id. Answers with an unknown transaction id, e.g. late
+ * answers to requests which already timed out, are discarded. While waiting, requests
+ * without answer are retransmitted as described in \ref irislwz_SetRetries.
+ *
+ * After return, the request and response structures of the \p handle contain the
+ * matching request and answer, so \ref irislwz_CheckResponse and \ref dchk_XML_ParseResult
+ * can be used as usual.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[out] privatedata Optional pointer, which receives the privatedata passed to
+ * \ref irislwz_PipelineSend for the request belonging to the answer. If the
+ * function fails because of a timeout or an invalid answer, it points to the privatedata
+ * of the failed request. On other errors it is set to NULL.
+ * \returns On success, this function returns 1, on error 0. If the oldest outstanding request
+ * reached its timeout, error 1031 is set and the request is removed from the pipeline.
  *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
  */
 {
+	int ret;
+	long long now, wait;
+	if (privatedata) *privatedata=NULL;
 	if (!handle) return 0;
-	// Size Information
-	if ((handle->response.header->header&3)==2) {
-		int octets=dchk_XML_ParseSize(handle);
-		if (octets) irislwz_SetError(handle,74040,"required: %i bytes, maximum set: %i bytes",octets,
-				handle->maximumResponseLength);
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	if (pl==NULL || pl->outstanding==0) {
+		irislwz_SetError(handle,74064,NULL);
 		return 0;
 	}
-	// Other Information, usually error messages from the server
-	if ((handle->response.header->header&3)==3) {
-		if (dchk_XML_ParseOther(handle)) return 0;
-		irislwz_SetError(handle,74047,NULL);
+	irislwz_PipelineFlush(handle);
+	while (1) {
+		now=irislwz_GetTime();
+		if (irislwz_Retransmit(handle,pl,now)) {
+			// Oldest request timed out
+			irislwz_ExpireTransaction(handle,privatedata);
+			return 0;
+		}
+		IRISLWZ_TRANSACTION *t=&pl->slots[pl->heap[0]];
+		if (pl->ringcount==0) {
+			if (t->deadline==IRISLWZ_NO_DEADLINE) wait=-1;
+			else wait=t->deadline-now;
+			ret=irislwz_WaitForData(handle,wait);
+			if (ret<0) return 0;
+			if (ret==0) continue;
+		}
+		ret=irislwz_ReadAnswer(handle,privatedata,0);
+		if (ret>=0) return ret;
+	}
+	return 0;
+}
+
+int irislwz_PipelineOutstanding(IRISLWZ_HANDLE *handle)
+/*!\brief Returns the number of outstanding requests
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \returns Number of requests sent with \ref irislwz_PipelineSend, which did not get
+ * an answer or timeout yet.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (!handle->pipeline) return 0;
+	return ((IRISLWZ_PIPELINE*)handle->pipeline)->outstanding;
+}
+
+void irislwz_PipelineReset(IRISLWZ_HANDLE *handle)
+/*!\brief Discard all outstanding requests
+ *
+ * This function removes all outstanding requests from the pipeline. Answers, which
+ * arrive later, are discarded by \ref irislwz_PipelineReceive.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return;
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	if (!pl) return;
+	while (pl->outstanding) {
+		int slot=pl->heap[pl->outstanding-1];
+		irislwz_FreePacket(&pl->slots[slot].request);
+		irislwz_ReleaseTransaction(pl,slot);
+	}
+}
+
+void irislwz_CopySettings(IRISLWZ_HANDLE *handle, IRISLWZ_HANDLE *source)
+/*!\brief Copy the numeric settings and flags of a handle
+ *
+ * \internal
+ * Used by \ref irislwz_CloneHandle and \ref irislwz_InitFromConfig. The strings are
+ * handled by the callers.
+ */
+{
+	handle->port=source->port;
+	handle->acceptDeflated=source->acceptDeflated;
+	handle->sendDeflated=source->sendDeflated;
+	handle->deflateLevel=source->deflateLevel;
+	handle->deflateStrategy=source->deflateStrategy;
+	handle->deflateThreshold=source->deflateThreshold;
+	handle->maxInflateRatio=source->maxInflateRatio;
+	handle->retain=source->retain;
+	handle->idnToASCII=source->idnToASCII;
+	handle->localValidation=source->localValidation;
+	handle->routes=source->routes;
+	handle->dnscache=source->dnscache;
+	handle->flag_si=source->flag_si;
+	handle->flag_oi=source->flag_oi;
+	handle->rfc1950_workaround=source->rfc1950_workaround;
+	handle->ignoreInvalidXML=source->ignoreInvalidXML;
+	handle->dontValidateInput=source->dontValidateInput;
+	handle->maximumResponseLength=source->maximumResponseLength;
+	handle->timeout_seconds=source->timeout_seconds;
+	handle->timeout_useconds=source->timeout_useconds;
+	handle->DebugHandler=source->DebugHandler;
+	handle->debugdata=source->debugdata;
+	handle->debuglevel=source->debuglevel;
+	handle->verboseflag=source->verboseflag;
+	handle->test_flags=source->test_flags;
+	handle->test_version=source->test_version;
+	handle->test_header=source->test_header;
+	handle->test_tid=source->test_tid;
+	handle->test_authlen=source->test_authlen;
+	handle->test_truncate=source->test_truncate;
+	handle->window=source->window;
+	handle->batch=source->batch;
+	handle->retries=source->retries;
+	handle->hedge=source->hedge;
+}
+
+int irislwz_CloneHandle(IRISLWZ_HANDLE *handle, IRISLWZ_HANDLE *source)
+/*!\brief Initialize a handle with the settings of another handle
+ *
+ * This function initializes \p handle with \ref irislwz_Init and copies all settings of
+ * \p source into it: server, port, authority, timeouts, compression and testing flags, debug
+ * and verbose settings, window, batch size, retries, hedging and the inflate ratio. The socket, the pipeline,
+ * the server pool and the last request and response are not copied, so the new handle must
+ * be connected with \ref irislwz_Connect before it can be used.
+ *
+ * \param[out] handle pointer to an uninitialized IRISLWZ_HANDLE object
+ * \param[in] source pointer to an initialized IRISLWZ_HANDLE object
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (!source) return 0;
+	if (!irislwz_Init(handle)) return 0;
+	if (source->localcharset) {
+		free(handle->localcharset);
+		handle->localcharset=strdup(source->localcharset);
+	}
+	if (source->authority) handle->authority=strdup(source->authority);
+	if (source->server) handle->server=strdup(source->server);
+	if ((source->localcharset && !handle->localcharset)
+		|| (source->authority && !handle->authority)
+		|| (source->server && !handle->server)) {
+		irislwz_Exit(handle);
 		return 0;
 	}
+	irislwz_CopySettings(handle,source);
+	return 1;
+}
+
+void irislwz_MovePackets(IRISLWZ_HANDLE *handle, IRISLWZ_HANDLE *source)
+/*!\brief Move the last request and response of a handle to another handle
+ *
+ * \internal
+ * The receive and inflate buffers are moved, too, because the response points into them.
+ */
+{
+	irislwz_FreePacket(&handle->request);
+	irislwz_FreePacket(&handle->response);
+	if (handle->rxbuffer) free(handle->rxbuffer);
+	if (handle->inflatebuffer) free(handle->inflatebuffer);
+	handle->request=source->request;
+	handle->response=source->response;
+	handle->rxbuffer=source->rxbuffer;
+	handle->rxbuffersize=source->rxbuffersize;
+	handle->inflatebuffer=source->inflatebuffer;
+	handle->inflatebuffersize=source->inflatebuffersize;
+	bzero(&source->request,sizeof(IRISLWZ_PACKET));
+	bzero(&source->response,sizeof(IRISLWZ_PACKET));
+	source->rxbuffer=NULL;
+	source->rxbuffersize=0;
+	source->inflatebuffer=NULL;
+	source->inflatebuffersize=0;
+}
+
+int irislwz_GetSocket(IRISLWZ_HANDLE *handle)
+/*!\brief Returns the socket descriptor
+ *
+ * This function returns the descriptor of the UDP socket created by \ref irislwz_Connect.
+ * It can be used to wait for answers with select, poll or epoll, when the pipeline
+ * is driven by \ref irislwz_PipelinePoll.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \returns The socket descriptor or -1, if the handle is not connected.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return -1;
+	if (((DCHK_SOCKET*)handle->socket)->sd<=0) {
+		irislwz_SetError(handle,74032,NULL);
+		return -1;
+	}
+	return (int)((DCHK_SOCKET*)handle->socket)->sd;
+}
+
+int irislwz_PipelinePoll(IRISLWZ_HANDLE *handle, void **privatedata)
+/*!\brief Read an answer without blocking
+ *
+ * This function is the non-blocking counterpart of \ref irislwz_PipelineReceive. It reads
+ * the datagrams already waiting on the socket until it finds an answer to one of the
+ * outstanding requests. Answers with an unknown transaction id are discarded. Timeouts are
+ * not checked, use \ref irislwz_PipelineExpire for this.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[out] privatedata Optional pointer, which receives the privatedata passed to
+ * \ref irislwz_PipelineSend for the request belonging to the answer.
+ * \returns Returns 1, if an answer was received. The request and response structures of the
+ * \p handle contain the matching request and answer. Returns 0 on error and -1 if no answer
+ * is available.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	int ret;
+	if (privatedata) *privatedata=NULL;
+	if (!handle) return 0;
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	if (pl==NULL || pl->outstanding==0) return -1;
+	irislwz_PipelineFlush(handle);
+#ifdef MSG_DONTWAIT
+	while ((ret=irislwz_ReadAnswer(handle,privatedata,MSG_DONTWAIT))==-2) ;
+	return ret;
+#else
+	irislwz_SetError(handle,74022,NULL);
+	return 0;
+#endif
+}
+
+int irislwz_PipelineExpire(IRISLWZ_HANDLE *handle, void **privatedata)
+/*!\brief Remove a timed out request from the pipeline
+ *
+ * This function retransmits all requests, whose retransmission timeout is reached (see
+ * \ref irislwz_SetRetries), and checks if the oldest outstanding request has reached its
+ * timeout. In this case the request is removed from the pipeline and copied into the request
+ * structure of the \p handle. Call this function repeatedly until it returns 0 to remove all
+ * timed out requests.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[out] privatedata Optional pointer, which receives the privatedata passed to
+ * \ref irislwz_PipelineSend for the timed out request.
+ * \returns Returns 1 and sets error 1031, if a request timed out, otherwise 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (privatedata) *privatedata=NULL;
+	if (!handle) return 0;
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	if (pl==NULL || pl->outstanding==0) return 0;
+	if (!irislwz_Retransmit(handle,pl,irislwz_GetTime())) return 0;
+	irislwz_ExpireTransaction(handle,privatedata);
 	return 1;
 }
+
+int irislwz_PipelineCancel(IRISLWZ_HANDLE *handle, void **privatedata)
+/*!\brief Remove the oldest outstanding request from the pipeline
+ *
+ * This function removes the oldest outstanding request from the pipeline without waiting for
+ * its answer. The request is copied into the request structure of the \p handle. An answer,
+ * which arrives later, is discarded.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[out] privatedata Optional pointer, which receives the privatedata passed to
+ * \ref irislwz_PipelineSend for the removed request.
+ * \returns Returns 1 if a request was removed or 0 if there are no outstanding requests.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (privatedata) *privatedata=NULL;
+	if (!handle) return 0;
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	if (pl==NULL || pl->outstanding==0) return 0;
+	irislwz_CompleteTransaction(handle,pl->heap[0],privatedata);
+	return 1;
+}
+
+int irislwz_PipelineNextTimeout(IRISLWZ_HANDLE *handle)
+/*!\brief Returns the time until the next request times out
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \returns Number of milliseconds until the next retransmission or until the oldest outstanding
+ * request reaches its timeout, 0 if \ref irislwz_PipelineExpire should be called immediately,
+ * or -1 if there are no outstanding requests or no timeout is set.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return -1;
+	IRISLWZ_PIPELINE *pl=(IRISLWZ_PIPELINE*)handle->pipeline;
+	if (pl==NULL || pl->outstanding==0) return -1;
+	if (pl->numunsent>0 || pl->ringcount>0) return 0;
+	IRISLWZ_TRANSACTION *t=&pl->slots[pl->heap[0]];
+	if (t->deadline==IRISLWZ_NO_DEADLINE) return -1;
+	long long wait=t->deadline-irislwz_GetTime();
+	if (wait<=0) return 0;
+	// round up, so we don't wake up just before the deadline
+	return (int)((wait+999)/1000);
+}
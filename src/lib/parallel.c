@@ -0,0 +1,605 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+#ifdef HAVE_STRINGS_H
+	#include <strings.h>
+#endif
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <windows.h>
+	#define DCHK_HAVE_THREADS
+#elif defined(HAVE_PTHREAD_H)
+	#include <pthread.h>
+	#define DCHK_HAVE_THREADS
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+
+// Number of domains a worker takes from the list at once, if the bundles are not limited
+#define DCHK_PARALLEL_CHUNK		32
+#define DCHK_PARALLEL_MAXTHREADS	256
+
+#ifdef DCHK_HAVE_THREADS
+
+#ifdef _WIN32
+	typedef CRITICAL_SECTION DCHK_MUTEX;
+	#define dchk_MutexInit(m)		InitializeCriticalSection(m)
+	#define dchk_MutexDestroy(m)	DeleteCriticalSection(m)
+	#define dchk_MutexLock(m)		EnterCriticalSection(m)
+	#define dchk_MutexUnlock(m)		LeaveCriticalSection(m)
+#else
+	typedef pthread_mutex_t DCHK_MUTEX;
+	#define dchk_MutexInit(m)		pthread_mutex_init(m,NULL)
+	#define dchk_MutexDestroy(m)	pthread_mutex_destroy(m)
+	#define dchk_MutexLock(m)		pthread_mutex_lock(m)
+	#define dchk_MutexUnlock(m)		pthread_mutex_unlock(m)
+#endif
+
+/*!\brief Shared state of the workers of a parallel query
+ *
+ * \internal
+ */
+typedef struct {
+	DCHK_MUTEX mutex;
+	DCHK_RECORD *next;				//!< First record, which was not taken by a worker yet
+	int chunk;						//!< Number of records a worker takes at once
+	int maxdomainsperquery;
+	int failed;						//!< Set by the first worker, which failed
+} DCHK_PARALLEL;
+
+/*!\brief A thread, which calls \p func with \p arg
+ *
+ * \internal
+ */
+typedef struct {
+#ifdef _WIN32
+	HANDLE thread;
+#else
+	pthread_t thread;
+#endif
+	void (*func)(void *arg);
+	void *arg;
+} DCHK_THREAD;
+
+/*!\brief A worker thread of a parallel query
+ *
+ * \internal
+ */
+typedef struct {
+	DCHK_PARALLEL *parallel;
+	IRISLWZ_HANDLE handle;
+	int ret;
+} DCHK_WORKER;
+
+#ifdef _WIN32
+static DWORD WINAPI dchk_parallel_Thread(LPVOID arg)
+{
+	((DCHK_THREAD*)arg)->func(((DCHK_THREAD*)arg)->arg);
+	return 0;
+}
+#else
+static void *dchk_parallel_Thread(void *arg)
+{
+	((DCHK_THREAD*)arg)->func(((DCHK_THREAD*)arg)->arg);
+	return NULL;
+}
+#endif
+
+static int dchk_parallel_Run(int num, void (*func)(void *arg), void *args, size_t argsize)
+/*!\brief Run \p func on \p num threads and wait until all of them are finished
+ *
+ * \internal
+ * Thread \p i gets a pointer to the \p i-th element of the array \p args, whose elements
+ * are \p argsize bytes big. A single call runs in the calling thread. If threads can not be
+ * started, \p func is called for the first element in the calling thread, so \p func has
+ * to keep working until there is nothing left to do.
+ *
+ * \returns The number of threads, which were started.
+ */
+{
+	int i, started=0;
+	DCHK_THREAD *threads=NULL;
+	if (num>1) threads=(DCHK_THREAD*)calloc(num,sizeof(DCHK_THREAD));
+	if (threads) {
+		for (started=0;started<num;started++) {
+			threads[started].func=func;
+			threads[started].arg=(char*)args+started*argsize;
+#ifdef _WIN32
+			threads[started].thread=CreateThread(NULL,0,dchk_parallel_Thread,&threads[started],0,NULL);
+			if (!threads[started].thread) break;
+#else
+			if (pthread_create(&threads[started].thread,NULL,dchk_parallel_Thread,&threads[started])!=0) break;
+#endif
+		}
+	}
+	// If no thread could be started, we do the work ourself
+	if (started==0) func(args);
+	for (i=0;i<started;i++) {
+#ifdef _WIN32
+		WaitForSingleObject(threads[i].thread,INFINITE);
+		CloseHandle(threads[i].thread);
+#else
+		pthread_join(threads[i].thread,NULL);
+#endif
+	}
+	if (threads) free(threads);
+	return started;
+}
+
+static int dchk_parallel_Take(DCHK_PARALLEL *p, DCHK_DOMAINLIST *chunk)
+/*!\brief Take the next records from the list
+ *
+ * \internal
+ * \returns 1, if \p chunk contains records, 0 if the list is done or a worker failed.
+ */
+{
+	DCHK_RECORD *r;
+	dchk_MutexLock(&p->mutex);
+	if (p->failed || !p->next) {
+		dchk_MutexUnlock(&p->mutex);
+		return 0;
+	}
+	r=p->next;
+	chunk->first=r;
+	chunk->num=1;
+	while (chunk->num<p->chunk && r->next) {
+		r=r->next;
+		chunk->num++;
+	}
+	chunk->last=r;
+	p->next=r->next;
+	dchk_MutexUnlock(&p->mutex);
+	return 1;
+}
+
+static void dchk_parallel_Work(void *arg)
+/*!\brief Query the records of the list until all are done
+ *
+ * \internal
+ * A chunk is queried with \ref dchk_QueryDomainList, so bundling, pipelining and the server
+ * pool work like on a single handle. The chunk is cut from the list while it is queried,
+ * so the query stops at its end. The records after the chunk belong to other workers,
+ * which never read the link of the last record of this chunk.
+ */
+{
+	DCHK_WORKER *w=(DCHK_WORKER*)arg;
+	DCHK_PARALLEL *p=w->parallel;
+	DCHK_DOMAINLIST chunk;
+	DCHK_RECORD *rest;
+	w->ret=1;
+	while (dchk_parallel_Take(p,&chunk)) {
+		rest=chunk.last->next;
+		chunk.last->next=NULL;
+		w->ret=dchk_QueryDomainList(&w->handle,&chunk,p->maxdomainsperquery);
+		chunk.last->next=rest;
+		if (!w->ret) {
+			dchk_MutexLock(&p->mutex);
+			p->failed=1;
+			dchk_MutexUnlock(&p->mutex);
+			return;
+		}
+	}
+}
+
+static int dchk_parallel_InitWorker(IRISLWZ_HANDLE *handle, DCHK_CONFIG *config, DCHK_WORKER *w)
+/*!\brief Create the handle of a worker from the configuration of the template handle
+ *
+ * \internal
+ * In case of an error, it is set on \p handle.
+ */
+{
+	if (!irislwz_InitFromConfig(&w->handle,config) || !irislwz_Connect(&w->handle)) {
+		irislwz_SetError(handle,w->handle.error,w->handle.errortext ? "%s" : NULL,w->handle.errortext);
+		irislwz_Exit(&w->handle);
+		return 0;
+	}
+	// The list is checked once by the calling thread
+	w->handle.localValidation=0;
+	return 1;
+}
+
+static void dchk_parallel_ExitWorker(DCHK_WORKER *w)
+{
+	irislwz_Disconnect(&w->handle);
+	irislwz_Exit(&w->handle);
+}
+
+#else
+
+// Without threads, everything runs in the calling thread
+typedef int DCHK_MUTEX;
+#define dchk_MutexInit(m)
+#define dchk_MutexDestroy(m)
+#define dchk_MutexLock(m)
+#define dchk_MutexUnlock(m)
+#define dchk_parallel_Run(num,func,args,argsize)	((func)(args),0)
+
+#endif	// DCHK_HAVE_THREADS
+
+int dchk_QueryDomainListParallel(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list, int maxdomainsperquery, int threads)
+/*!\brief Checks status of domains in domain list with multiple threads
+ *
+ * This function works like \ref dchk_QueryDomainList, but the domains are queried by a pool of
+ * \p threads worker threads. Each worker gets its own handle and socket, which are created
+ * with \ref irislwz_InitFromConfig from a configuration of \p handle, including the server
+ * pool. The workers take the domains in portions from the list, bundle them and query them
+ * with window and server pool as set on \p handle. The results are stored in the records of
+ * the \p list.
+ *
+ * \p handle itself is not used for queries, it does not even have to be connected. The
+ * library must be initialized with \ref irislwz_InitLibrary before, which is done by
+ * \ref irislwz_Init.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object, which serves as template for the workers
+ * \param[in,out] list pointer to DCHK_DOMAINLIST, which was created with dchk_NewDomainList
+ * and filled with dchk_AddDomain
+ * \param[in] maxdomainsperquery maximum number of domains which can be bundled to one request
+ * A value of "0" means unlimited.
+ * \param[in] threads Number of worker threads between 1 and 256. Not more threads are started
+ * than portions of domains are in the list. A single worker runs in the calling thread.
+ * \returns On success, the function returns 1 and the domain \p list is updated. If an
+ * error occurred, it returns 0 and the error of the first worker, which failed, is set on
+ * \p handle. In this case some domains might not be checked.
+ *
+ * \remarks
+ * On platforms without threads, the domains are queried by \ref dchk_QueryDomainList on
+ * \p handle, which has to be connected in this case.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!handle) return 0;
+	if (!list) {
+		irislwz_SetError(handle,74025,"int dchk_QueryDomainListParallel(IRISLWZ_HANDLE *handle, ==> DCHK_DOMAINLIST *list <==, int maxdomainsperquery, int threads)");
+		return 0;
+	}
+	if (threads<1 || threads>DCHK_PARALLEL_MAXTHREADS) {
+		irislwz_SetError(handle,74065,"threads: %i",threads);
+		return 0;
+	}
+#ifndef DCHK_HAVE_THREADS
+	return dchk_QueryDomainList(handle,list,maxdomainsperquery);
+#else
+	if (list->num==0) {
+		irislwz_SetError(handle,74038,NULL);
+		return 0;
+	}
+	if (maxdomainsperquery<0) maxdomainsperquery=0;
+	DCHK_PARALLEL p;
+	p.chunk=(maxdomainsperquery>0 ? maxdomainsperquery : DCHK_PARALLEL_CHUNK)*(handle->window>1 ? handle->window : 1);
+	if (threads>(list->num+p.chunk-1)/p.chunk) threads=(list->num+p.chunk-1)/p.chunk;
+	if (handle->localValidation) dchk_ValidateDomainList(handle,list);
+
+	DCHK_WORKER *workers=(DCHK_WORKER*)calloc(threads,sizeof(DCHK_WORKER));
+	if (!workers) {
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	// The workers share the settings and the resolved server pool of the template
+	DCHK_CONFIG *config=irislwz_NewConfig(handle);
+	if (!config) {
+		free(workers);
+		return 0;
+	}
+	int i, ret=1;
+	for (i=0;i<threads;i++) {
+		if (!dchk_parallel_InitWorker(handle,config,&workers[i])) break;
+		workers[i].parallel=&p;
+		workers[i].ret=1;
+	}
+	irislwz_ReleaseConfig(config);
+	if (i<threads) {
+		while (--i>=0) dchk_parallel_ExitWorker(&workers[i]);
+		free(workers);
+		return 0;
+	}
+	p.next=list->first;
+	p.maxdomainsperquery=maxdomainsperquery;
+	p.failed=0;
+	dchk_MutexInit(&p.mutex);
+	dchk_parallel_Run(threads,dchk_parallel_Work,workers,sizeof(DCHK_WORKER));
+	dchk_MutexDestroy(&p.mutex);
+	for (i=0;i<threads;i++) {
+		if (ret && !workers[i].ret) {
+			irislwz_SetError(handle,workers[i].handle.error,
+				workers[i].handle.errortext ? "%s" : NULL,workers[i].handle.errortext);
+			ret=0;
+		}
+		dchk_parallel_ExitWorker(&workers[i]);
+	}
+	free(workers);
+	return ret;
+#endif
+}
+
+/*!\brief A group of domains with the same authority
+ *
+ * \internal
+ */
+typedef struct {
+	const char *authority;			//!< Points into the domain of the first record, the routing table or NULL
+	int index;						//!< Route in the routing table or -1
+	DCHK_DOMAINLIST list;
+	IRISLWZ_HANDLE handle;
+	int ret;
+} DCHK_ROUTE;
+
+/*!\brief Shared state of a query by authority
+ *
+ * \internal
+ */
+typedef struct {
+	DCHK_MUTEX mutex;
+	DCHK_ROUTE *routes;
+	int num;
+	int next;						//!< Next group, which was not taken by a worker yet
+	DCHK_CONFIG *config;
+	int discover;					//!< Servers are found by DNS
+	int maxdomainsperquery;
+} DCHK_ROUTING;
+
+static void dchk_route_Query(DCHK_ROUTING *rt, DCHK_ROUTE *route)
+/*!\brief Query the domains of one authority
+ *
+ * \internal
+ * The handle of the group stays initialized, so the caller can take the error or the packets.
+ */
+{
+	IRISLWZ_HANDLE *h=&route->handle;
+	route->ret=0;
+	if (!irislwz_InitFromConfig(h,rt->config)) return;
+	if (route->authority) {
+		if (!irislwz_SetAuthority(h,route->authority)) return;
+	} else if (!h->authority) {
+		irislwz_SetError(h,74058,"%s",route->list.first->domain);
+		return;
+	}
+	int servers=dchk_SetRouteServers(h,(DCHK_ROUTES*)h->routes,route->index);
+	if (servers==0) return;
+	if (servers<0 && rt->discover && !dchk_SetHostByDNS(h,h->authority)) return;
+	if (!irislwz_Connect(h)) return;
+	route->ret=dchk_QueryDomainList(h,&route->list,rt->maxdomainsperquery);
+	irislwz_Disconnect(h);
+}
+
+static void dchk_route_Work(void *arg)
+/*!\brief Query groups until all are done
+ *
+ * \internal
+ */
+{
+	DCHK_ROUTING *rt=*(DCHK_ROUTING**)arg;
+	int i;
+	while (1) {
+		dchk_MutexLock(&rt->mutex);
+		i=rt->next++;
+		dchk_MutexUnlock(&rt->mutex);
+		if (i>=rt->num) return;
+		dchk_route_Query(rt,&rt->routes[i]);
+	}
+}
+
+static int dchk_route_Match(DCHK_ROUTE *route, int index, const char *authority)
+{
+	if (route->index!=index) return 0;
+	if (index>=0 || route->authority==authority) return 1;
+	if (!route->authority || !authority) return 0;
+	return strcasecmp(route->authority,authority)==0;
+}
+
+static int dchk_route_Partition(IRISLWZ_HANDLE *handle, DCHK_ROUTING *rt, DCHK_RECORD **order, int num)
+/*!\brief Link the records of each authority to a list of their own
+ *
+ * \internal
+ * The original order is kept in \p order. Groups are created in the order, in which their
+ * authorities first appear in the list. Each route of the routing table gets a group of its
+ * own, which is found by the number of the route.
+ */
+{
+	int i, g, size=0, index=-1;
+	const char *authority;
+	DCHK_ROUTE *route=NULL;
+	DCHK_ROUTES *routes=(DCHK_ROUTES*)handle->routes;
+	int *groups=NULL;
+	if (routes) {
+		groups=(int*)malloc((dchk_GetRouteCount(routes)+1)*sizeof(int));
+		if (!groups) {
+			irislwz_SetError(handle,74024,NULL);
+			return 0;
+		}
+		for (i=0;i<dchk_GetRouteCount(routes);i++) groups[i]=-1;
+	}
+	for (i=0;i<num;i++) {
+		index=routes ? dchk_FindRoute(routes,order[i]->domain) : -1;
+		if (index>=0) authority=dchk_GetRouteAuthority(routes,index);
+		else authority=irislwz_GetAuthorityOfDomain(handle,order[i]->domain);
+		// Lists are often sorted by TLD, so the group of the previous domain is tried first
+		if (!route || !dchk_route_Match(route,index,authority)) {
+			if (index>=0) {
+				g=groups[index];
+				if (g<0) g=rt->num;
+			} else {
+				for (g=0;g<rt->num;g++) {
+					if (dchk_route_Match(&rt->routes[g],index,authority)) break;
+				}
+			}
+			if (g==rt->num) {
+				if (rt->num>=size) {
+					size=size ? size*2 : 8;
+					route=(DCHK_ROUTE*)realloc(rt->routes,size*sizeof(DCHK_ROUTE));
+					if (!route) {
+						if (groups) free(groups);
+						irislwz_SetError(handle,74024,NULL);
+						return 0;
+					}
+					rt->routes=route;
+				}
+				route=&rt->routes[rt->num++];
+				bzero(route,sizeof(DCHK_ROUTE));
+				route->authority=authority;
+				route->index=index;
+				if (index>=0) groups[index]=g;
+			} else {
+				route=&rt->routes[g];
+			}
+		}
+		order[i]->next=NULL;
+		if (route->list.last) route->list.last->next=order[i];
+		else route->list.first=order[i];
+		route->list.last=order[i];
+		route->list.num++;
+	}
+	if (groups) free(groups);
+	return 1;
+}
+
+int dchk_QueryDomainListByAuthority(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list, int maxdomainsperquery, int threads)
+/*!\brief Checks status of domains of different registries
+ *
+ * \ref dchk_QueryDomainList sends all domains of the list to one server with one authority.
+ * This function splits the \p list into groups of domains with the same authority (the TLD
+ * or "9.4.e164.arpa" for German ENUM domains, see \ref irislwz_SetAuthorityByDomain) or the
+ * same route of the routing table of \p handle (see \ref dchk_SetRoutes). Each
+ * group is queried with its own handle, which is created from a configuration of \p handle
+ * (see \ref irislwz_InitFromConfig) and gets the authority of the group. The groups are
+ * queried concurrently by up to \p threads threads.
+ *
+ * Groups of a route with servers are sent to these servers. Otherwise, if \p handle has no
+ * server, the server of each group is found with \ref dchk_SetHostByDNS.
+ * If it has a server, the other groups are sent to the server or server pool of \p handle,
+ * each with its own authority. Domains without a TLD get the authority of \p handle.
+ *
+ * The results are stored in the records of the \p list, which keeps its order. The last
+ * request and response of the group of the first domain are moved to \p handle, so they can
+ * be inspected as after \ref dchk_QueryDomainList. \p handle itself does not have to be
+ * connected.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object, which serves as template for the groups
+ * \param[in,out] list pointer to DCHK_DOMAINLIST, which was created with dchk_NewDomainList
+ * and filled with dchk_AddDomain
+ * \param[in] maxdomainsperquery maximum number of domains which can be bundled to one request
+ * A value of "0" means unlimited.
+ * \param[in] threads Maximum number of threads between 1 and 256 or 0 for one thread per
+ * authority. On platforms without threads, the groups are queried one after the other.
+ * \returns If all groups could be queried, the function returns 1. Otherwise it returns 0 and
+ * the error of the first group, which failed, is set on \p handle. The domains of the
+ * other groups are checked anyway, the domains of failed groups might have no status.
+ *
+ * \example
+ * \code
+IRISLWZ_HANDLE handle;
+irislwz_Init(&handle);
+DCHK_DOMAINLIST *list=dchk_NewDomainList();
+dchk_AddDomain(list,"denic.de");
+dchk_AddDomain(list,"nic.at");
+dchk_AddDomain(list,"1.2.3.4.9.4.e164.arpa");
+if (!dchk_QueryDomainListByAuthority(&handle,list,0,0)) irislwz_PrintError(&handle);
+dchk_PrintResults(list);
+ * \endcode
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!handle) return 0;
+	if (!list) {
+		irislwz_SetError(handle,74025,"int dchk_QueryDomainListByAuthority(IRISLWZ_HANDLE *handle, ==> DCHK_DOMAINLIST *list <==, int maxdomainsperquery, int threads)");
+		return 0;
+	}
+	if (threads<0 || threads>DCHK_PARALLEL_MAXTHREADS) {
+		irislwz_SetError(handle,74065,"threads: %i",threads);
+		return 0;
+	}
+	int i, num=0, ret=1;
+	DCHK_RECORD *r;
+	for (r=list->first;r;r=r->next) num++;
+	if (num==0) {
+		irislwz_SetError(handle,74038,NULL);
+		return 0;
+	}
+	DCHK_RECORD **order=(DCHK_RECORD**)malloc(num*sizeof(DCHK_RECORD*));
+	if (!order) {
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	for (i=0,r=list->first;r;r=r->next) order[i++]=r;
+
+	DCHK_ROUTING rt;
+	bzero(&rt,sizeof(DCHK_ROUTING));
+	rt.maxdomainsperquery=maxdomainsperquery<0 ? 0 : maxdomainsperquery;
+	rt.discover=(irislwz_GetServerCount(handle)==0 && handle->server==NULL);
+	DCHK_ROUTING **args=NULL;
+	if (dchk_route_Partition(handle,&rt,order,num)
+		&& (rt.config=irislwz_NewConfig(handle))!=NULL) {
+		if (threads==0 || threads>rt.num) threads=rt.num;
+		args=(DCHK_ROUTING**)malloc(threads*sizeof(DCHK_ROUTING*));
+		if (!args) irislwz_SetError(handle,74024,NULL);
+	}
+	if (args) {
+		for (i=0;i<threads;i++) args[i]=&rt;
+		dchk_MutexInit(&rt.mutex);
+		dchk_parallel_Run(threads,dchk_route_Work,args,sizeof(DCHK_ROUTING*));
+		dchk_MutexDestroy(&rt.mutex);
+		free(args);
+		for (i=0;i<rt.num;i++) {
+			DCHK_ROUTE *route=&rt.routes[i];
+			if (ret && !route->ret) {
+				irislwz_SetError(handle,route->handle.error,
+					route->handle.errortext ? "%s" : NULL,route->handle.errortext);
+				ret=0;
+			}
+			if (i==0) irislwz_MovePackets(handle,&route->handle);
+			irislwz_Exit(&route->handle);
+		}
+	} else {
+		ret=0;
+	}
+	// Restore the original order of the list
+	for (i=0;i<num-1;i++) order[i]->next=order[i+1];
+	order[num-1]->next=NULL;
+	list->first=order[0];
+	list->last=order[num-1];
+	if (rt.config) irislwz_ReleaseConfig(rt.config);
+	if (rt.routes) free(rt.routes);
+	free(order);
+	return ret;
+}
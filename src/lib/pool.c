@@ -0,0 +1,881 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+#ifdef HAVE_STRINGS_H
+	#include <strings.h>
+#endif
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <Ws2tcpip.h>
+	#include <windows.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+    #include <unistd.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+    #include <sys/socket.h>
+#endif
+#ifdef HAVE_NETINET_IN_H
+    #include <netinet/in.h>
+#endif
+#ifdef HAVE_NETDB_H
+    #include <netdb.h>
+#endif
+#include <time.h>
+#ifndef _WIN32
+	#include <sys/time.h>
+	#include <sys/select.h>
+#endif
+#ifdef HAVE_SYS_POLL_H
+    #include <sys/poll.h>
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+
+#define IRISLWZ_POOL_HOLDDOWN	30			// Seconds a failed server is not used
+
+typedef struct {
+	char *host;
+	int port;
+	int priority;
+	int weight;
+	struct sockaddr_storage *addr;	// resolved addresses including the port
+	int *addrlen;
+	int numaddr;					// -1 if not resolved yet
+	int nextaddr;					// address used for the next connect
+	time_t failed;					// server is not used before this time
+	int srtt, rttvar, rto;			// round trip times measured to this server
+	int wrr;						// current weight for striping
+} IRISLWZ_SERVER;
+
+typedef struct {
+	IRISLWZ_SERVER *servers;
+	int num;
+	int size;
+	int current;					// server in use or -1
+} IRISLWZ_POOL;
+
+
+static int irislwz_ResolveServer(IRISLWZ_HANDLE *handle, IRISLWZ_SERVER *srv)
+/*!\brief Resolve all addresses of a server
+ *
+ * \internal
+ * All IPv4 and IPv6 addresses of the server are resolved once and kept in the pool, so
+ * switching between servers does not need a DNS lookup.
+ */
+{
+	struct addrinfo hints, *res, *r;
+	int n, i;
+	bzero(&hints,sizeof(struct addrinfo));
+	hints.ai_family=AF_UNSPEC;
+	hints.ai_socktype=SOCK_DGRAM;
+	if ((n=getaddrinfo(srv->host,NULL,&hints,&res))!=0) {
+#ifdef _WIN32
+		irislwz_SetError(handle,irislwz_TranslateSocketError(),NULL);
+#else
+		irislwz_SetError(handle,irislwz_TranslateGaiError(n),"%s",srv->host);
+#endif
+		return 0;
+	}
+	for (n=0,r=res;r!=NULL;r=r->ai_next) n++;
+	srv->addr=(struct sockaddr_storage*)calloc(n,sizeof(struct sockaddr_storage));
+	srv->addrlen=(int*)calloc(n,sizeof(int));
+	if (!srv->addr || !srv->addrlen) {
+		if (srv->addr) free(srv->addr);
+		if (srv->addrlen) free(srv->addrlen);
+		srv->addr=NULL;
+		srv->addrlen=NULL;
+		freeaddrinfo(res);
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	for (i=0,r=res;r!=NULL;r=r->ai_next) {
+		if (r->ai_addrlen>sizeof(struct sockaddr_storage)) continue;
+		memcpy(&srv->addr[i],r->ai_addr,r->ai_addrlen);
+		if (r->ai_family==AF_INET) ((struct sockaddr_in*)&srv->addr[i])->sin_port=htons(srv->port);
+		else if (r->ai_family==AF_INET6) ((struct sockaddr_in6*)&srv->addr[i])->sin6_port=htons(srv->port);
+		else continue;
+		srv->addrlen[i]=(int)r->ai_addrlen;
+		i++;
+	}
+	freeaddrinfo(res);
+	srv->numaddr=i;
+	srv->nextaddr=0;
+	return 1;
+}
+
+static int irislwz_GetBestPriority(IRISLWZ_POOL *pool)
+/*!\brief Returns the lowest priority of all usable servers
+ *
+ * \internal
+ * If all servers failed recently, they are all made usable again, as it is better to try them
+ * again than to give up.
+ */
+{
+	int i, priority=-1;
+	time_t now=time(NULL);
+	for (i=0;i<pool->num;i++) {
+		if (pool->servers[i].failed>now) continue;
+		if (priority<0 || pool->servers[i].priority<priority) priority=pool->servers[i].priority;
+	}
+	if (priority>=0) return priority;
+	for (i=0;i<pool->num;i++) {
+		pool->servers[i].failed=0;
+		if (priority<0 || pool->servers[i].priority<priority) priority=pool->servers[i].priority;
+	}
+	return priority;
+}
+
+static int irislwz_PickServer(IRISLWZ_POOL *pool)
+/*!\brief Select a server according to RFC 2782
+ *
+ * \internal
+ * Only the usable servers with the lowest priority are considered. Among them a server is
+ * selected randomly, the probability is proportional to its weight. Servers with weight 0
+ * have a very small chance to be selected, unless all servers have weight 0.
+ */
+{
+	int i, pass, count=0, sum=0, running=0;
+	unsigned int r;
+	time_t now=time(NULL);
+	int priority=irislwz_GetBestPriority(pool);
+	for (i=0;i<pool->num;i++) {
+		if (pool->servers[i].failed>now || pool->servers[i].priority!=priority) continue;
+		sum+=pool->servers[i].weight;
+		count++;
+	}
+	if (sum==0) {
+		r=irislwz_rand(0,count-1);
+		for (i=0;i<pool->num;i++) {
+			if (pool->servers[i].failed>now || pool->servers[i].priority!=priority) continue;
+			if (r==0) return i;
+			r--;
+		}
+		return -1;
+	}
+	r=irislwz_rand(0,sum);
+	// RFC 2782: servers with weight 0 are placed at the beginning of the list
+	for (pass=0;pass<2;pass++) {
+		for (i=0;i<pool->num;i++) {
+			if (pool->servers[i].failed>now || pool->servers[i].priority!=priority) continue;
+			if ((pool->servers[i].weight==0)!=(pass==0)) continue;
+			running+=pool->servers[i].weight;
+			if ((unsigned int)running>=r) return i;
+		}
+	}
+	return -1;
+}
+
+static int irislwz_SwitchServer(IRISLWZ_HANDLE *handle, IRISLWZ_POOL *pool, int index)
+/*!\brief Make the server with \p index the current one
+ *
+ * \internal
+ * The round trip times measured to the previous server are saved and those of the new server
+ * are restored, so the retransmission timeout fits to the server in use.
+ */
+{
+	IRISLWZ_SERVER *srv;
+	if (index<0) {
+		irislwz_SetError(handle,74067,NULL);
+		return 0;
+	}
+	if (index==pool->current) return 1;
+	srv=&pool->servers[index];
+	char *name=strdup(srv->host);
+	if (!name) {
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	if (pool->current>=0) {
+		pool->servers[pool->current].srtt=handle->srtt;
+		pool->servers[pool->current].rttvar=handle->rttvar;
+		pool->servers[pool->current].rto=handle->rto;
+	}
+	irislwz_FreeString(handle,handle->server);
+	handle->server=name;
+	handle->port=srv->port;
+	handle->srtt=srv->srtt;
+	handle->rttvar=srv->rttvar;
+	handle->rto=srv->rto;
+	pool->current=index;
+	return 1;
+}
+
+int irislwz_AddServer(IRISLWZ_HANDLE *handle, const char *host, int port, int priority, int weight)
+/*!\brief Add a server to the server pool
+ *
+ * Registries often operate several DCHK servers for the same authority. With this function
+ * you can add all of them to the server pool of the \p handle. Each request is then sent to a
+ * server selected from the pool as described in
+ * <a href="http://tools.ietf.org/html/rfc2782">RFC 2782</a>: only servers with the lowest
+ * priority are used, and among them the servers are selected randomly according to their
+ * weight. Servers with a higher priority are only used, if all servers with a lower priority
+ * failed. \ref dchk_SetHostByDNS fills the pool automatically with all SRV records of the TLD.
+ *
+ * All addresses of a server are resolved on first use. If a server does not answer, the next
+ * address is used, and when all addresses failed, the server is not used for 30 seconds.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] host name or IP address of the server
+ * \param[in] port port of the server (0=default port 715)
+ * \param[in] priority priority between 0 and 65535, lower values are preferred
+ * \param[in] weight weight between 0 and 65535
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \remarks
+ * \ref irislwz_SetHost removes all servers from the pool.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (!host || !host[0]) {
+		irislwz_SetError(handle,74025,"int irislwz_AddServer(IRISLWZ_HANDLE *handle, ==> const char *host <==, int port, int priority, int weight)");
+		return 0;
+	}
+	if (port<0 || port>65535 || priority<0 || priority>65535 || weight<0 || weight>65535) {
+		irislwz_SetError(handle,74065,"int irislwz_AddServer(IRISLWZ_HANDLE *handle, const char *host, ==> int port, int priority, int weight <==)");
+		return 0;
+	}
+	IRISLWZ_POOL *pool=(IRISLWZ_POOL*)handle->pool;
+	if (!pool) {
+		pool=(IRISLWZ_POOL*)calloc(1,sizeof(IRISLWZ_POOL));
+		if (!pool) {
+			irislwz_SetError(handle,74024,NULL);
+			return 0;
+		}
+		pool->current=-1;
+		handle->pool=pool;
+	}
+	if (pool->num>=pool->size) {
+		int size=pool->size ? pool->size*2 : 4;
+		IRISLWZ_SERVER *servers=(IRISLWZ_SERVER*)realloc(pool->servers,size*sizeof(IRISLWZ_SERVER));
+		if (!servers) {
+			irislwz_SetError(handle,74024,NULL);
+			return 0;
+		}
+		pool->servers=servers;
+		pool->size=size;
+	}
+	IRISLWZ_SERVER *srv=&pool->servers[pool->num];
+	bzero(srv,sizeof(IRISLWZ_SERVER));
+	srv->host=strdup(host);
+	if (!srv->host) {
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	srv->port=port ? port : 715;
+	srv->priority=priority;
+	srv->weight=weight;
+	srv->numaddr=-1;
+	pool->num++;
+	return 1;
+}
+
+void irislwz_ClearServers(IRISLWZ_HANDLE *handle)
+/*!\brief Remove all servers from the server pool
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	int i;
+	if (!handle) return;
+	IRISLWZ_POOL *pool=(IRISLWZ_POOL*)handle->pool;
+	if (!pool) return;
+	for (i=0;i<pool->num;i++) {
+		free(pool->servers[i].host);
+		if (pool->servers[i].addr) free(pool->servers[i].addr);
+		if (pool->servers[i].addrlen) free(pool->servers[i].addrlen);
+	}
+	if (pool->servers) free(pool->servers);
+	free(pool);
+	handle->pool=NULL;
+}
+
+int irislwz_GetServerCount(IRISLWZ_HANDLE *handle)
+/*!\brief Returns the number of servers in the server pool
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \returns Number of servers added by \ref irislwz_AddServer or \ref dchk_SetHostByDNS
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (!handle->pool) return 0;
+	return ((IRISLWZ_POOL*)handle->pool)->num;
+}
+
+int irislwz_GetServer(IRISLWZ_HANDLE *handle, int index, const char **host, int *port, int *priority, int *weight)
+/*!\brief Returns a server of the server pool
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] index Index of the server, starting with 0
+ * \param[out] host Optional pointer, which receives a pointer to the hostname of the server
+ * \param[out] port Optional pointer, which receives the port
+ * \param[out] priority Optional pointer, which receives the priority
+ * \param[out] weight Optional pointer, which receives the weight
+ * \returns On success, this function returns 1, on error 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	if (index<0 || index>=irislwz_GetServerCount(handle)) {
+		irislwz_SetError(handle,74065,"int irislwz_GetServer(IRISLWZ_HANDLE *handle, ==> int index <==, ...)");
+		return 0;
+	}
+	IRISLWZ_SERVER *srv=&((IRISLWZ_POOL*)handle->pool)->servers[index];
+	if (host) *host=srv->host;
+	if (port) *port=srv->port;
+	if (priority) *priority=srv->priority;
+	if (weight) *weight=srv->weight;
+	return 1;
+}
+
+int irislwz_CopyPool(IRISLWZ_HANDLE *handle, IRISLWZ_HANDLE *source, int resolve)
+/*!\brief Copy the server pool of another handle
+ *
+ * \internal
+ * The servers are copied with their resolved addresses, the round trip times measured to
+ * them and the time until a failed server is used again. If \p resolve is set, servers
+ * which were not resolved yet are resolved now. A server, which can not be resolved, is
+ * resolved again on first use. \p handle must not have a pool.
+ */
+{
+	int i;
+	IRISLWZ_POOL *src=(IRISLWZ_POOL*)source->pool;
+	if (!src || src->num==0) return 1;
+	IRISLWZ_POOL *pool=(IRISLWZ_POOL*)calloc(1,sizeof(IRISLWZ_POOL));
+	if (!pool) {
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	pool->servers=(IRISLWZ_SERVER*)calloc(src->num,sizeof(IRISLWZ_SERVER));
+	if (!pool->servers) {
+		free(pool);
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	pool->size=src->num;
+	pool->current=-1;
+	handle->pool=pool;
+	for (i=0;i<src->num;i++) {
+		IRISLWZ_SERVER *srv=&pool->servers[i];
+		*srv=src->servers[i];
+		srv->host=strdup(srv->host);
+		srv->addr=NULL;
+		srv->addrlen=NULL;
+		srv->wrr=0;
+		if (!srv->host) {
+			irislwz_SetError(handle,74024,NULL);
+			irislwz_ClearServers(handle);
+			return 0;
+		}
+		pool->num++;
+		if (srv->numaddr>0) {
+			srv->addr=(struct sockaddr_storage*)malloc(srv->numaddr*sizeof(struct sockaddr_storage));
+			srv->addrlen=(int*)malloc(srv->numaddr*sizeof(int));
+			if (!srv->addr || !srv->addrlen) {
+				irislwz_SetError(handle,74024,NULL);
+				irislwz_ClearServers(handle);
+				return 0;
+			}
+			memcpy(srv->addr,src->servers[i].addr,srv->numaddr*sizeof(struct sockaddr_storage));
+			memcpy(srv->addrlen,src->servers[i].addrlen,srv->numaddr*sizeof(int));
+		} else if (resolve && srv->numaddr<0) {
+			irislwz_ResolveServer(handle,srv);
+		}
+	}
+	return 1;
+}
+
+int irislwz_GetServerAddresses(IRISLWZ_HANDLE *handle, int index, const struct sockaddr_storage **addr, const int **addrlen)
+/*!\brief Returns the resolved addresses of a server of the pool
+ *
+ * \internal
+ * The server is resolved, if this was not done yet.
+ * \returns Number of addresses or -1, if the server could not be resolved. In this case the
+ * error is set on \p handle.
+ */
+{
+	IRISLWZ_POOL *pool=(IRISLWZ_POOL*)handle->pool;
+	if (!pool || index<0 || index>=pool->num) {
+		irislwz_SetError(handle,74065,"int irislwz_GetServerAddresses(IRISLWZ_HANDLE *handle, ==> int index <==, ...)");
+		return -1;
+	}
+	IRISLWZ_SERVER *srv=&pool->servers[index];
+	if (srv->numaddr<0 && !irislwz_ResolveServer(handle,srv)) return -1;
+	*addr=srv->addr;
+	*addrlen=srv->addrlen;
+	return srv->numaddr;
+}
+
+int irislwz_SetServerAddresses(IRISLWZ_HANDLE *handle, int index, const struct sockaddr_storage *addr, const int *addrlen, int num)
+/*!\brief Set the addresses of a server of the pool, which were resolved before
+ *
+ * \internal
+ * The addresses must already contain the port of the server.
+ */
+{
+	IRISLWZ_POOL *pool=(IRISLWZ_POOL*)handle->pool;
+	if (!pool || index<0 || index>=pool->num || num<0) {
+		irislwz_SetError(handle,74065,"int irislwz_SetServerAddresses(IRISLWZ_HANDLE *handle, ==> int index <==, ...)");
+		return 0;
+	}
+	IRISLWZ_SERVER *srv=&pool->servers[index];
+	if (srv->addr) free(srv->addr);
+	if (srv->addrlen) free(srv->addrlen);
+	srv->addr=NULL;
+	srv->addrlen=NULL;
+	srv->numaddr=-1;
+	if (num>0) {
+		srv->addr=(struct sockaddr_storage*)malloc(num*sizeof(struct sockaddr_storage));
+		srv->addrlen=(int*)malloc(num*sizeof(int));
+		if (!srv->addr || !srv->addrlen) {
+			if (srv->addr) free(srv->addr);
+			if (srv->addrlen) free(srv->addrlen);
+			srv->addr=NULL;
+			srv->addrlen=NULL;
+			irislwz_SetError(handle,74024,NULL);
+			return 0;
+		}
+		memcpy(srv->addr,addr,num*sizeof(struct sockaddr_storage));
+		memcpy(srv->addrlen,addrlen,num*sizeof(int));
+	}
+	srv->numaddr=num;
+	srv->nextaddr=0;
+	return 1;
+}
+
+int irislwz_PoolConnect(IRISLWZ_HANDLE *handle)
+/*!\brief Connect to the current server of the pool
+ *
+ * \internal
+ * This function is called by \ref irislwz_Connect and \ref irislwz_SelectServer. All addresses of
+ * the current server are tried. If none of them can be used, the server is marked as failed and
+ * the next server is selected.
+ */
+{
+	int tries, i, k;
+	IRISLWZ_POOL *pool=(IRISLWZ_POOL*)handle->pool;
+	if (!pool || pool->num==0) {
+		irislwz_SetError(handle,74067,NULL);
+		return 0;
+	}
+	if (pool->current<0 && !irislwz_SwitchServer(handle,pool,irislwz_PickServer(pool))) return 0;
+	for (tries=0;tries<pool->num;tries++) {
+		IRISLWZ_SERVER *srv=&pool->servers[pool->current];
+		if (srv->numaddr>=0 || irislwz_ResolveServer(handle,srv)) {
+			for (i=0;i<srv->numaddr;i++) {
+				k=(srv->nextaddr+i)%srv->numaddr;
+				if (irislwz_ConnectAddress(handle,(struct sockaddr*)&srv->addr[k],srv->addrlen[k])) {
+					srv->nextaddr=k;
+					return 1;
+				}
+			}
+		}
+		srv->failed=time(NULL)+IRISLWZ_POOL_HOLDDOWN;
+		if (!irislwz_SwitchServer(handle,pool,irislwz_PickServer(pool))) return 0;
+	}
+	return 0;
+}
+
+int irislwz_SelectServer(IRISLWZ_HANDLE *handle)
+/*!\brief Select the server for the next request
+ *
+ * This function selects a server from the server pool according to its priority and weight
+ * (see \ref irislwz_AddServer). If the handle is already connected, the socket is connected to the
+ * new server, which is cheap for UDP sockets. \ref dchk_QueryDomainList calls this function
+ * before each bundled request, so the requests are spread across the pool. There must not be
+ * outstanding requests in the pipeline.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \returns On success, this function returns 1, on error 0. Error 74067 is set, if the
+ * pool is empty.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return 0;
+	IRISLWZ_POOL *pool=(IRISLWZ_POOL*)handle->pool;
+	if (!pool || pool->num==0) {
+		irislwz_SetError(handle,74067,NULL);
+		return 0;
+	}
+	int previous=pool->current;
+	if (!irislwz_SwitchServer(handle,pool,irislwz_PickServer(pool))) return 0;
+	if (!irislwz_IsConnected(handle)) return 1;
+	if (previous==pool->current) return 1;
+	return irislwz_PoolConnect(handle);
+}
+
+void irislwz_ServerFailed(IRISLWZ_HANDLE *handle)
+/*!\brief Report that the current server of the pool did not answer
+ *
+ * The next connect to this server uses its next address. When all addresses of the server
+ * failed, the server is not used for 30 seconds, unless there is no other server left.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return;
+	IRISLWZ_POOL *pool=(IRISLWZ_POOL*)handle->pool;
+	if (!pool || pool->current<0) return;
+	IRISLWZ_SERVER *srv=&pool->servers[pool->current];
+	if (srv->numaddr>1) {
+		srv->nextaddr=(srv->nextaddr+1)%srv->numaddr;
+		if (srv->nextaddr!=0) return;
+	}
+	srv->failed=time(NULL)+IRISLWZ_POOL_HOLDDOWN;
+}
+
+static int dchk_StripeFailover(IRISLWZ_SERVER *srv, IRISLWZ_HANDLE *h, int *alive, int *numalive,
+	DCHK_DOMAINLIST **retry, int *numretry)
+/*!\brief Take a server out of striping
+ *
+ * \internal
+ * If the server \p h is connected to failed with a socket error and there are other servers
+ * left, all of its outstanding requests are moved to the \p retry stack and the function
+ * returns 1. Otherwise it returns 0 and the query has to be aborted.
+ */
+{
+	DCHK_DOMAINLIST *domainset;
+	if (h->error<1000 || h->error>1999 || *numalive<2) return 0;
+	*alive=0;
+	(*numalive)--;
+	srv->failed=time(NULL)+IRISLWZ_POOL_HOLDDOWN;
+	while (irislwz_PipelineCancel(h,(void**)&domainset)) retry[(*numretry)++]=domainset;
+	return 1;
+}
+
+static void dchk_CopyError(IRISLWZ_HANDLE *handle, IRISLWZ_HANDLE *source)
+{
+	if (source->errortext) irislwz_SetError(handle,source->error,"%s",source->errortext);
+	else irislwz_SetError(handle,source->error,NULL);
+}
+
+int dchk_QueryDomainListStriped(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *list, int maxdomainsperquery)
+/*!\brief Checks status of domains in domain list using all servers of the pool in parallel
+ *
+ * This function works like \ref dchk_QueryDomainList, but the bundled requests are spread across
+ * all usable servers with the lowest priority in the server pool (see \ref irislwz_AddServer) and
+ * sent to them in parallel. Each server gets its own socket and a share of the bundles, which is
+ * proportional to its weight. Up to the window set with \ref irislwz_SetWindow requests are
+ * outstanding per server. If a server does not answer, its requests are sent to the
+ * remaining servers.
+ *
+ * If the pool has less than two usable servers, the function just calls \ref dchk_QueryDomainList.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in,out] list pointer to DCHK_DOMAINLIST, which was created with dchk_NewDomainList
+ * and filled with dchk_AddDomain
+ * \param[in] maxdomainsperquery maximum number of domains which can be bundled to one request
+ * A value of "0" means unlimited.
+ * \returns On success, the function returns 1 and the domain \p list is updated. If an
+ * error occurred, it returns 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	int i, k, n=0, priority, best, total, weight, outstanding, ret=1, t, wait, validate;
+	if (!handle) return 0;
+	if (!list) {
+		irislwz_SetError(handle,74025,"int dchk_QueryDomainListStriped(IRISLWZ_HANDLE *handle, ==> DCHK_DOMAINLIST *list <==, int maxdomainsperquery)");
+		return 0;
+	}
+	if (list->num==0) {
+		irislwz_SetError(handle,74038,NULL);
+		return 0;
+	}
+	IRISLWZ_POOL *pool=(IRISLWZ_POOL*)handle->pool;
+	if (!pool || pool->num<2) return dchk_QueryDomainList(handle,list,maxdomainsperquery);
+	time_t now=time(NULL);
+	priority=irislwz_GetBestPriority(pool);
+	for (i=0;i<pool->num;i++) {
+		if (pool->servers[i].failed<=now && pool->servers[i].priority==priority) n++;
+	}
+	if (n<2) return dchk_QueryDomainList(handle,list,maxdomainsperquery);
+	if (maxdomainsperquery<0) maxdomainsperquery=0;
+	if (handle->localValidation) dchk_ValidateDomainList(handle,list);
+	DCHK_RECORD *r=list->first, *rr;
+	while (r && r->checkedLocally) r=r->next;
+	if (!r) return 1;
+
+	int window=handle->window>1 ? handle->window : 1;
+	int *index=(int*)malloc(2*n*sizeof(int));
+	IRISLWZ_HANDLE *h=(IRISLWZ_HANDLE*)calloc(n,sizeof(IRISLWZ_HANDLE));
+	DCHK_DOMAINLIST *sets=(DCHK_DOMAINLIST*)malloc(n*window*(sizeof(DCHK_DOMAINLIST)+2*sizeof(DCHK_DOMAINLIST*)));
+	char *payload=(char*)malloc(7000);
+#ifdef HAVE_SYS_POLL_H
+	struct pollfd *pfd=(struct pollfd*)malloc(n*sizeof(struct pollfd));
+	if (!pfd) {
+		if (payload) free(payload);
+		payload=NULL;
+	}
+#endif
+	if (!index || !h || !sets || !payload) {
+		if (index) free(index);
+		if (h) free(h);
+		if (sets) free(sets);
+		if (payload) free(payload);
+#ifdef HAVE_SYS_POLL_H
+		if (pfd) free(pfd);
+#endif
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	int *alive=index+n;
+	// Every server gets its own handle and socket. Servers, which can not be connected,
+	// are left out.
+	int numsets=n*window;
+	n=0;
+	for (i=0;i<pool->num;i++) {
+		IRISLWZ_SERVER *srv=&pool->servers[i];
+		if (srv->failed>now || srv->priority!=priority) continue;
+		if (!irislwz_CloneHandle(&h[n],handle)) {
+			irislwz_SetError(handle,74024,NULL);
+			ret=0;
+			break;
+		}
+		if (!irislwz_SetHost(&h[n],srv->host,srv->port)) {
+			dchk_CopyError(handle,&h[n]);
+			irislwz_Exit(&h[n]);
+			ret=0;
+			break;
+		}
+		if (i==pool->current) {
+			h[n].srtt=handle->srtt;
+			h[n].rttvar=handle->rttvar;
+			h[n].rto=handle->rto;
+		} else {
+			h[n].srtt=srv->srtt;
+			h[n].rttvar=srv->rttvar;
+			h[n].rto=srv->rto;
+		}
+		if (srv->numaddr>=0 || irislwz_ResolveServer(&h[n],srv)) {
+			for (k=0;k<srv->numaddr;k++) {
+				t=(srv->nextaddr+k)%srv->numaddr;
+				if (irislwz_ConnectAddress(&h[n],(struct sockaddr*)&srv->addr[t],srv->addrlen[t])) break;
+			}
+			if (k<srv->numaddr) {
+				srv->wrr=0;
+				alive[n]=1;
+				index[n++]=i;
+				continue;
+			}
+		}
+		srv->failed=now+IRISLWZ_POOL_HOLDDOWN;
+		dchk_CopyError(handle,&h[n]);
+		irislwz_Exit(&h[n]);
+	}
+	if (n==0) ret=0;
+
+	DCHK_DOMAINLIST *domainset;
+	// freesets holds the unused domainsets, retry the bundles of failed servers,
+	// which have to be sent again
+	DCHK_DOMAINLIST **freesets=(DCHK_DOMAINLIST**)(sets+numsets);
+	DCHK_DOMAINLIST **retry=freesets+numsets;
+	int numfree=numsets, numretry=0, numalive=n;
+	for (i=0;i<numfree;i++) freesets[i]=&sets[i];
+	IRISLWZ_HANDLE *failed=NULL;
+#ifndef HAVE_SYS_POLL_H
+	fd_set rset;
+	struct timeval tv;
+	int maxfd;
+#endif
+
+	while (ret) {
+		// Spread the bundles by smooth weighted round robin over the servers,
+		// which have space left in their window
+		while (r || numretry>0) {
+			best=-1;
+			total=0;
+			for (k=0;k<n;k++) {
+				if (!alive[k] || irislwz_PipelineOutstanding(&h[k])>=window) continue;
+				weight=pool->servers[index[k]].weight;
+				if (weight<1) weight=1;
+				pool->servers[index[k]].wrr+=weight;
+				total+=weight;
+				if (best<0 || pool->servers[index[k]].wrr>pool->servers[index[best]].wrr) best=k;
+			}
+			if (best<0) break;
+			pool->servers[index[best]].wrr-=total;
+			if (numretry>0) {
+				// Rebuilding a bundle with the same domains results in the same request.
+				// The limit only counts the domains, which were sent.
+				domainset=retry[--numretry];
+				for (t=0,k=0,rr=domainset->first;k<domainset->num;k++,rr=rr->next) {
+					if (!rr->checkedLocally) t++;
+				}
+				rr=domainset->first;
+				t=dchk_BuildRequest(&h[best],&rr,t,payload,domainset,&validate);
+			} else {
+				domainset=freesets[--numfree];
+				t=dchk_BuildRequest(&h[best],&r,maxdomainsperquery,payload,domainset,&validate);
+			}
+			if (!t) {
+				failed=&h[best];
+				ret=0;
+				break;
+			}
+			if (!irislwz_PipelineSendPayload(&h[best],payload,t,domainset,validate)) {
+				retry[numretry++]=domainset;
+				if (!dchk_StripeFailover(&pool->servers[index[best]],&h[best],&alive[best],&numalive,retry,&numretry)) {
+					failed=&h[best];
+					ret=0;
+					break;
+				}
+			}
+		}
+		if (!ret) break;
+		// Wait for answers on all sockets
+#ifndef HAVE_SYS_POLL_H
+		FD_ZERO(&rset);
+		maxfd=0;
+#endif
+		wait=-1;
+		outstanding=0;
+		for (k=0;k<n;k++) {
+			if (!alive[k] || !irislwz_PipelineOutstanding(&h[k])) continue;
+			irislwz_PipelineFlush(&h[k]);
+			t=irislwz_GetSocket(&h[k]);
+#ifdef HAVE_SYS_POLL_H
+			pfd[outstanding].fd=t;
+			pfd[outstanding].events=POLLIN;
+			pfd[outstanding].revents=0;
+#else
+	#ifndef _WIN32
+			if (t>=FD_SETSIZE) {
+				irislwz_SetError(handle,74111,"%s:%i",h[k].server,h[k].port);
+				ret=0;
+				break;
+			}
+	#endif
+			FD_SET(t,&rset);
+			if (t>maxfd) maxfd=t;
+#endif
+			outstanding++;
+			t=irislwz_PipelineNextTimeout(&h[k]);
+			if (t>=0 && (wait<0 || t<wait)) wait=t;
+		}
+		if (!ret || !outstanding) break;
+		if (wait!=0) {
+#ifdef HAVE_SYS_POLL_H
+			t=poll(pfd,outstanding,wait);
+			if (t<0) {
+				t=irislwz_TranslateSocketError();
+				if (t!=1062) {		// EINTR
+					irislwz_SetError(handle,t,"poll");
+					ret=0;
+					break;
+				}
+			}
+#else
+			tv.tv_sec=wait/1000;
+			tv.tv_usec=(wait%1000)*1000;
+			if (select(maxfd+1,&rset,NULL,NULL,wait<0 ? NULL : &tv)<0) {
+				t=irislwz_TranslateSocketError();
+				if (t!=1062) {		// EINTR
+					irislwz_SetError(handle,t,"select");
+					ret=0;
+					break;
+				}
+			}
+#endif
+		}
+		// Read answers and check timeouts
+		for (k=0;k<n && ret;k++) {
+			if (!alive[k]) continue;
+			while ((t=irislwz_PipelinePoll(&h[k],(void**)&domainset))==1) {
+				freesets[numfree++]=domainset;
+				if (!irislwz_CheckResponse(&h[k]) || !dchk_XML_ParseResult(&h[k],domainset)) {
+					t=0;
+					break;
+				}
+			}
+			if (t!=0 && !irislwz_PipelineExpire(&h[k],(void**)&domainset)) continue;
+			if (t!=0) retry[numretry++]=domainset;
+			// If the server does not answer, its requests are sent to the other servers
+			if (!dchk_StripeFailover(&pool->servers[index[k]],&h[k],&alive[k],&numalive,retry,&numretry)) {
+				failed=&h[k];
+				ret=0;
+			}
+		}
+	}
+	if (failed) dchk_CopyError(handle,failed);
+	for (k=0;k<n;k++) {
+		pool->servers[index[k]].srtt=h[k].srtt;
+		pool->servers[index[k]].rttvar=h[k].rttvar;
+		pool->servers[index[k]].rto=h[k].rto;
+		irislwz_Exit(&h[k]);
+	}
+	free(index);
+	free(h);
+	free(sets);
+	free(payload);
+#ifdef HAVE_SYS_POLL_H
+	free(pfd);
+#endif
+	return ret;
+}
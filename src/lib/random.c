@@ -71,10 +71,24 @@ static char sccsid[] = "@(#)random.c	8.2 (Berkeley) 5/19/95";
 #include <sys/types.h>
 #ifndef _WIN32
 #include <unistd.h>
+#include <fcntl.h>
 #endif
 #include "dchk.h"
 #include "compat.h"
 
+/*
+ * Every thread has its own state for the random number generator, so transaction IDs can
+ * be created on multiple threads without locking. irislwz_srand, irislwz_rand_initstate and
+ * irislwz_rand_setstate only change the state of the calling thread.
+ */
+#if defined(_MSC_VER)
+	#define DCHK_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+	#define DCHK_THREAD_LOCAL __thread
+#else
+	#define DCHK_THREAD_LOCAL
+#endif
+
 
 
 
@@ -192,7 +206,7 @@ static long seps [MAX_TYPES] =	{ SEP_0, SEP_1, SEP_2, SEP_3, SEP_4 };
  *	MAX_TYPES * (rptr - state) + TYPE_3 == TYPE_3.
  */
 
-static long randtbl[DEG_3 + 1] = {
+static DCHK_THREAD_LOCAL long randtbl[DEG_3 + 1] = {
 	TYPE_3,
 #ifdef  USE_WEAK_SEEDING
 /* Historic implementation compatibility */
@@ -227,8 +241,8 @@ static long randtbl[DEG_3 + 1] = {
  * in the initialization of randtbl) because the state table pointer is set
  * to point to randtbl[1] (as explained below).
  */
-static long *fptr = &randtbl[SEP_3 + 1];
-static long *rptr = &randtbl[1];
+static DCHK_THREAD_LOCAL long *fptr = NULL;
+static DCHK_THREAD_LOCAL long *rptr = NULL;
 
 /*
  * The following things are the pointer to the state information table, the
@@ -240,11 +254,23 @@ static long *rptr = &randtbl[1];
  * this is more efficient than indexing every time to find the address of
  * the last element to see if the front and rear pointers have wrapped.
  */
-static long *state = &randtbl[1];
-static long rand_type = TYPE_3;
-static long rand_deg = DEG_3;
-static long rand_sep = SEP_3;
-static long *end_ptr = &randtbl[DEG_3 + 1];
+static DCHK_THREAD_LOCAL long *state = NULL;
+static DCHK_THREAD_LOCAL long rand_type = TYPE_3;
+static DCHK_THREAD_LOCAL long rand_deg = DEG_3;
+static DCHK_THREAD_LOCAL long rand_sep = SEP_3;
+static DCHK_THREAD_LOCAL long *end_ptr = NULL;
+
+/*
+ * The addresses of thread local variables are not constant, so the pointers are set,
+ * when the generator is used the first time on a thread.
+ */
+static void irislwz_rand_InitThread()
+{
+	state = &randtbl[1];
+	fptr = &randtbl[SEP_3 + 1];
+	rptr = &randtbl[1];
+	end_ptr = &randtbl[DEG_3 + 1];
+}
 
 #ifndef _WIN32
 #define __inline inline
@@ -293,13 +319,14 @@ static __inline long good_rand (register long x)
  * for default usage relies on values produced by this routine.
  */
 
-static int dchksrand_called=0;
+static DCHK_THREAD_LOCAL int dchksrand_called=0;
 
 void irislwz_srand(unsigned int x)
 /*!\ingroup PPLGroupMath
  */
 {
 	register long i;
+	if (!state) irislwz_rand_InitThread();
 	dchksrand_called=1;
 
 	if (rand_type == TYPE_0)
@@ -346,9 +373,12 @@ char * irislwz_rand_initstate(unsigned long seed, char *arg_state, long n)
 	//char *arg_state;		/* pointer to state array */
 	//long n;				/* # bytes of state info */
 {
-	register char *ostate = (char *)(&state[-1]);
+	register char *ostate;
 	register long *long_arg_state = (long *) arg_state;
 
+	if (!state) irislwz_rand_InitThread();
+	ostate = (char *)(&state[-1]);
+
 	if (rand_type == TYPE_0)
 		state[-1] = rand_type;
 	else
@@ -381,7 +411,7 @@ char * irislwz_rand_initstate(unsigned long seed, char *arg_state, long n)
 	}
 	state = (long *) (long_arg_state + 1); /* first location */
 	end_ptr = &state[rand_deg];	/* must set end_ptr before srandom */
-	srand(seed);
+	irislwz_srand(seed);
 	if (rand_type == TYPE_0)
 		long_arg_state[0] = rand_type;
 	else
@@ -416,7 +446,10 @@ char * irislwz_rand_setstate(char *arg_state)
 	register long *new_state = (long *) arg_state;
 	register long type = new_state[0] % MAX_TYPES;
 	register long rear = new_state[0] / MAX_TYPES;
-	char *ostate = (char *)(&state[-1]);
+	char *ostate;
+
+	if (!state) irislwz_rand_InitThread();
+	ostate = (char *)(&state[-1]);
 
 	if (rand_type == TYPE_0)
 		state[-1] = rand_type;
@@ -445,6 +478,26 @@ char * irislwz_rand_setstate(char *arg_state)
 	return(ostate);
 }
 
+static unsigned int irislwz_rand_Seed()
+/*
+ * Each thread gets its own seed from the operating system. If this is not possible, the
+ * seed is made of the time, the process id and the address of the thread local state,
+ * which is different on each thread.
+ */
+{
+	unsigned int seed=0;
+#ifndef _WIN32
+	int fd=open("/dev/urandom",O_RDONLY);
+	if (fd>=0) {
+		int ret=(int)read(fd,&seed,sizeof(seed));
+		close(fd);
+		if (ret==(int)sizeof(seed)) return seed;
+	}
+	seed=(unsigned int)getpid();
+#endif
+	return seed^(unsigned int)time(NULL)^(unsigned int)clock()^(unsigned int)(size_t)randtbl;
+}
+
 /*
  * random:
  *
@@ -471,14 +524,7 @@ unsigned int irislwz_rand(unsigned int min, unsigned int max)
 	register long i;
 	register long *f, *r;
 
-	if (!dchksrand_called) {
-		#ifndef _WIN32
-			pid_t p=getpid();
-			irislwz_srand(time(NULL)+p);
-		#else
-			irislwz_srand((int)time(NULL));
-		#endif
-	}
+	if (!dchksrand_called) irislwz_srand(irislwz_rand_Seed());
 
 	if (rand_type == TYPE_0) {
 		i = state[0];
@@ -500,7 +546,7 @@ unsigned int irislwz_rand(unsigned int min, unsigned int max)
 
 		fptr = f; rptr = r;
 	}
-	return (unsigned int) (min+((long long)i*range/0x7fffffff));
+	return (unsigned int) (min+((long long)i*range/0x80000000LL));
 }
 
 
@@ -165,8 +165,10 @@ IN NAPTR  100    10    "s"   "DCHK1:iris.lwz"      ""     _iris-lwz._udp.de.
 	return buffer;
 }
 
-static char *dchk_GetNAPTR(IRISLWZ_HANDLE *handle, const char *tld)
+static char *dchk_GetNAPTR(IRISLWZ_HANDLE *handle, const char *tld, int *ttl)
 /*!\brief Finds NAPTR record for DCHK1
+ *
+ * The TTL of the record is stored in \p ttl.
  */
 {
 #ifdef _WIN32
@@ -193,6 +195,7 @@ static char *dchk_GetNAPTR(IRISLWZ_HANDLE *handle, const char *tld)
 			buffer=dchk_ParseNAPTRRecord(handle,(u_char*)&c->Data);
 			if (buffer) {
 				// We have found our NAPTR record for DCHK
+				*ttl=(int)c->dwTtl;
 				free(query);
 				DnsRecordListFree(r, DnsFreeRecordList);
 				return buffer;
@@ -246,6 +249,7 @@ static char *dchk_GetNAPTR(IRISLWZ_HANDLE *handle, const char *tld)
 				buffer=dchk_ParseNAPTRRecord(handle,(u_char*)ns_rr_rdata(rr));
 				if (buffer) {
 					// We have found our NAPTR record for DCHK
+					*ttl=(int)ns_rr_ttl(rr);
 					free(answer);
 					return buffer;
 				}
@@ -260,65 +264,59 @@ static char *dchk_GetNAPTR(IRISLWZ_HANDLE *handle, const char *tld)
 
 
 
-int dchk_SetHostByDNS(IRISLWZ_HANDLE *handle, const char *tld)
-/*!\brief Set hostname of DCHK server by using DNS
- *
- * If you don't know the hostname of the DCHK server you can use this function to
- * make a DNS lookup for the specified TLD. The function will query the nameserver for
- * the given TLD and check if there is a NAPTR- and a SRV record for "DCHK1:iris.lwz".
- *
- * \param[in] handle pointer to an IRISLWZ_HANDLE object
- * \param[in] tld pointer to a string with the desired TLD.
- * \returns If the function can find a suitable DCHK server, the server is automatically
- * configured by calling \ref irislwz_SetHost and the function returns 1 (success). You can use
- * the functions \ref irislwz_GetHostname and \ref irislwz_GetPort to get the results. If no DCHK
- * server can be found or if an error occured, the function will return 0.
- *
- * \remarks
- * This function will only succeed if the registry for the specified TLD has a NAPTR record
- * for "DCHK1:iris.lwz" and a SRV record in it's zonefile.
+static int dchk_LookupServers(IRISLWZ_HANDLE *handle, const char *tld, char **name, int *ttl)
+/*!\brief Fill the server pool with the SRV records of a TLD
  *
- * \ingroup DCHK_API_DCHK
+ * \internal
+ * The replacement of the NAPTR record is returned in \p name, the lowest TTL of the NAPTR and
+ * SRV records in \p ttl.
  */
 {
-	if (!handle) return 0;
-	if (!tld) {
-		irislwz_SetError(handle,74021,NULL);
-		return 0;
-	}
-	char *name=dchk_GetNAPTR(handle,tld);
-	if (!name) {
+	*name=dchk_GetNAPTR(handle,tld,ttl);
+	if (!*name) {
 		return 0;
 	}
 
 #ifdef _WIN32
 	int a;
 	PDNS_RECORD r;
-	DNS_STATUS ret=DnsQuery((const char*)name,DNS_TYPE_SRV,DNS_QUERY_STANDARD,NULL,&r,NULL);
+	DNS_STATUS ret=DnsQuery((const char*)*name,DNS_TYPE_SRV,DNS_QUERY_STANDARD,NULL,&r,NULL);
 	if (ret) {
-		free(name);
-		irislwz_SetError(handle,74007,"%s",name);
+		irislwz_SetError(handle,74007,"%s",*name);
 		return 0;
 	}
-	a=irislwz_SetHost(handle,(const char*)r->Data.SRV.pNameTarget,r->Data.SRV.wPort);
-	//printf ("server: %s:%i\n",r->Data.SRV.pNameTarget,r->Data.SRV.wPort);
+	PDNS_RECORD c;
+	int found=0;
+	a=1;
+	for (c=r;c!=NULL && a;c=c->pNext) {
+		if (c->wType!=DNS_TYPE_SRV) continue;
+		if (!c->Data.SRV.pNameTarget || strcmp(c->Data.SRV.pNameTarget,".")==0) continue;
+		if ((int)c->dwTtl<*ttl) *ttl=(int)c->dwTtl;
+		if (!found) irislwz_ClearServers(handle);
+		found++;
+		//printf ("server: %s:%i\n",c->Data.SRV.pNameTarget,c->Data.SRV.wPort);
+		a=irislwz_AddServer(handle,(const char*)c->Data.SRV.pNameTarget,c->Data.SRV.wPort,
+			c->Data.SRV.wPriority,c->Data.SRV.wWeight);
+	}
 	DnsRecordListFree(r, DnsFreeRecordList);
+	if (!found) {
+		irislwz_SetError(handle,74008,"%s",*name);
+		return 0;
+	}
 	return a;
 #else
     int res=res_init();
     if (res<0) {
-    	free(name);
     	irislwz_SetError(handle,74000,"%s",hstrerror(h_errno));
     	return 0;
     }
-    // we search for SRV-Records for the given name
+    // we search for SRV-Records for the given NAPTR replacement
     unsigned char *answer=(unsigned char *)malloc(PACKETSZ);
-    res=res_query(name,C_IN,ns_t_srv,answer, PACKETSZ);		//
+    res=res_query(*name,C_IN,ns_t_srv,answer, PACKETSZ);		//
     if (res<0) {
-    	if (h_errno==1) irislwz_SetError(handle,74006,"%s",name);
-    	else if (h_errno==4) irislwz_SetError(handle,74007,"%s",name);
+    	if (h_errno==1) irislwz_SetError(handle,74006,"%s",*name);
+    	else if (h_errno==4) irislwz_SetError(handle,74007,"%s",*name);
     	else irislwz_SetError(handle,74007,"%i: %s",h_errno,hstrerror(h_errno));
-    	free(name);
     	free(answer);
     	return 0;
     }
@@ -328,14 +326,12 @@ int dchk_SetHostByDNS(IRISLWZ_HANDLE *handle, const char *tld)
     if (res<0) {
     	irislwz_SetError(handle,74003,"%s",hstrerror(h_errno));
     	free(answer);
-    	free(name);
     	return 0;
     }
     int nr=dchk_bind_ns_msg_count(msg,ns_s_an);
     if (!nr) {
-    	irislwz_SetError(handle,74008,"%s",name);
+    	irislwz_SetError(handle,74008,"%s",*name);
     	free(answer);
-    	free(name);
     	return 0;
     }
 
@@ -343,17 +339,22 @@ int dchk_SetHostByDNS(IRISLWZ_HANDLE *handle, const char *tld)
     ns_rr rr;
     const u_char *cp;
     int i;
-    int port;
+    int port, priority, weight;
+    int found=0;
     char *host=NULL;
     int hostbuffer=0;
     for (i=0;i<nr;i++) {
     	res=dchk_bind_ns_parserr(&msg,ns_s_an,i,&rr);
     	if (res==0) {
-    		// we search for a SRV record
+    		// we search for SRV records, all of them are added to the server pool
     		if (ns_rr_type(rr)==ns_t_srv) {
+    			if ((int)ns_rr_ttl(rr)<*ttl) *ttl=(int)ns_rr_ttl(rr);
     			cp=ns_rr_rdata(rr);
     			//ppl6::HexDump((void*)cp,ns_rr_rdlen(rr));
-    			cp+=4;	// Skip prev and weight
+    			priority=ns_get16(cp);	// priority
+    			cp+=2;
+    			weight=ns_get16(cp);	// weight
+    			cp+=2;
     			port=ns_get16(cp);		// port
     			cp+=2;	// jump over port
    	    		// build hostname
@@ -379,17 +380,78 @@ int dchk_SetHostByDNS(IRISLWZ_HANDLE *handle, const char *tld)
     	    		hostbuffer-=cp[0];
     	    		cp+=cp[0]+1;	// next lable
     	    	}
-    	    	free(answer);
-    	    	free(name);
-    	    	i=irislwz_SetHost(handle,(const char *)host,port);
-    	    	free(host);
-    	    	return i;
+    	    	// A target of "." means, that the service is not available
+    	    	if (!host || !host[0]) continue;
+    	    	if (!found) irislwz_ClearServers(handle);
+    	    	found++;
+    	    	if (!irislwz_AddServer(handle,(const char *)host,port,priority,weight)) {
+    	    		free(host);
+    	    		free(answer);
+    	    		return 0;
+    	    	}
     		}
     	}
     }
-    irislwz_SetError(handle,74008,"%s",name);
+    if (host) free(host);
     free(answer);
-    return 0;
+    if (!found) {
+    	irislwz_SetError(handle,74008,"%s",*name);
+    	return 0;
+    }
+    return 1;
 #endif
 }
 
+int dchk_SetHostByDNS(IRISLWZ_HANDLE *handle, const char *tld)
+/*!\brief Set hostname of DCHK server by using DNS
+ *
+ * If you don't know the hostname of the DCHK server you can use this function to
+ * make a DNS lookup for the specified TLD. The function will query the nameserver for
+ * the given TLD and check if there is a NAPTR- and a SRV record for "DCHK1:iris.lwz".
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] tld pointer to a string with the desired TLD.
+ * \returns If the function can find a suitable DCHK server, the server is automatically
+ * configured and the function returns 1 (success). You can use
+ * the functions \ref irislwz_GetHostname and \ref irislwz_GetPort to get the results. If no DCHK
+ * server can be found or if an error occured, the function will return 0.
+ *
+ * If the registry publishes more than one SRV record, all servers are added to the server pool
+ * (see \ref irislwz_AddServer) with their priority and weight, and one of them is selected as
+ * described in RFC 2782. Use \ref irislwz_GetServerCount and \ref irislwz_GetServer to get
+ * the complete list.
+ *
+ * If the handle has a discovery cache (see \ref dchk_SetDNSCache), the servers and their
+ * addresses are taken from the cache as long as the DNS records are valid, and TLDs without
+ * DCHK server fail without a DNS lookup.
+ *
+ * \remarks
+ * This function will only succeed if the registry for the specified TLD has a NAPTR record
+ * for "DCHK1:iris.lwz" and a SRV record in it's zonefile.
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!handle) return 0;
+	if (!tld) {
+		irislwz_SetError(handle,74021,NULL);
+		return 0;
+	}
+	DCHK_DNSCACHE *cache=(DCHK_DNSCACHE*)handle->dnscache;
+	int ret;
+	if (cache) {
+		ret=dchk_GetCachedServers(handle,cache,tld);
+		if (ret==0) return 0;
+		if (ret>0) return irislwz_SelectServer(handle);
+	}
+	char *name=NULL;
+	int ttl=0;
+	ret=dchk_LookupServers(handle,tld,&name,&ttl);
+	if (cache) {
+		if (ret) dchk_CacheServers(handle,cache,tld,name,ttl);
+		else dchk_CacheFailure(handle,cache,tld);
+	}
+	if (name) free(name);
+	if (!ret) return 0;
+	return irislwz_SelectServer(handle);
+}
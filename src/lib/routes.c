@@ -0,0 +1,583 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+#ifdef HAVE_STRINGS_H
+	#include <strings.h>
+#endif
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <windows.h>
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+
+#define dchk_routes_Lower(c)	((c)>='A' && (c)<='Z' ? (c)+('a'-'A') : (c))
+
+/*!\brief A suffix of the routing table
+ *
+ * \internal
+ */
+typedef struct {
+	char *key;						//!< Suffix in lower case and reversed
+	char *authority;
+	char **hosts;
+	int *ports;
+	int numservers;
+} DCHK_ROUTES_ENTRY;
+
+/*!\brief Node of the compiled suffix trie
+ *
+ * \internal
+ * The children of a node are stored one after the other, their characters in the same order
+ * in a separate array, so the characters of a node are scanned in one short loop over
+ * consecutive bytes.
+ */
+typedef struct {
+	int first;						//!< Index of the first child
+	int route;						//!< Route of the suffix ending in this node or -1
+	int num;						//!< Number of children
+} DCHK_TRIE_NODE;
+
+struct __dchk_routes {
+	DCHK_ROUTES_ENTRY *entries;
+	int num;
+	int size;
+	int chars;						//!< Sum of the length of all keys
+	DCHK_TRIE_NODE *nodes;			//!< NULL, if the table has to be compiled
+	unsigned char *edges;			//!< Character, which leads to the node with the same index
+	int numnodes;
+	volatile long refcount;			//!< Owner and configurations using the table
+};
+
+DCHK_ROUTES *dchk_NewRoutes()
+/*!\brief Create an empty routing table
+ *
+ * A routing table maps domains to the authority, which is responsible for them, and optionally
+ * to the servers of the authority. It is filled with \ref dchk_AddRoute or
+ * \ref dchk_LoadRoutes and used by a handle after \ref dchk_SetRoutes.
+ *
+ * Each route has a suffix of one or more labels, like "de" or "9.4.e164.arpa". A domain
+ * belongs to the route with the longest suffix matching complete labels at the end of the
+ * domain name. The suffixes are compiled into a trie, which is walked once from the last
+ * character of a domain name to the first, so the time needed to find the route of a domain
+ * does not depend on the size of the table.
+ *
+ * \returns Pointer to the new table or NULL, if not enough memory is available.
+ *
+ * \example
+ * \code
+IRISLWZ_HANDLE handle;
+irislwz_Init(&handle);
+DCHK_ROUTES *routes=dchk_NewRoutes();
+dchk_AddRoute(routes,"de",NULL,NULL);
+dchk_AddRoute(routes,"e164.arpa",NULL,NULL);
+dchk_AddRoute(routes,"9.4.e164.arpa",NULL,"enum1.example.com,enum2.example.com:7150");
+dchk_SetRoutes(&handle,routes);
+...
+dchk_QueryDomainListByAuthority(&handle,list,0,0);
+...
+irislwz_Exit(&handle);
+dchk_FreeRoutes(routes);
+ * \endcode
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	DCHK_ROUTES *routes=(DCHK_ROUTES*)calloc(1,sizeof(DCHK_ROUTES));
+	if (routes) routes->refcount=1;
+	return routes;
+}
+
+DCHK_ROUTES *dchk_RetainRoutes(DCHK_ROUTES *routes)
+/*!\brief Add a reference to a routing table
+ *
+ * \internal
+ * Used by configurations, which keep the table of their handle. Each call must be followed by
+ * a call to \ref dchk_FreeRoutes.
+ */
+{
+	if (routes) irislwz_AtomicIncrement(&routes->refcount);
+	return routes;
+}
+
+static void dchk_routes_Uncompile(DCHK_ROUTES *routes)
+{
+	if (routes->nodes) free(routes->nodes);
+	if (routes->edges) free(routes->edges);
+	routes->nodes=NULL;
+	routes->edges=NULL;
+	routes->numnodes=0;
+}
+
+void dchk_FreeRoutes(DCHK_ROUTES *routes)
+/*!\brief Free a routing table
+ *
+ * The table must not be used by a handle anymore. If configurations created with
+ * \ref irislwz_NewConfig still use the table, it is freed after the last of them.
+ *
+ * \param[in] routes pointer to a table created with \ref dchk_NewRoutes
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!routes) return;
+	if (irislwz_AtomicDecrement(&routes->refcount)>0) return;
+	int i, s;
+	for (i=0;i<routes->num;i++) {
+		DCHK_ROUTES_ENTRY *e=&routes->entries[i];
+		free(e->key);
+		free(e->authority);
+		for (s=0;s<e->numservers;s++) free(e->hosts[s]);
+		if (e->hosts) free(e->hosts);
+		if (e->ports) free(e->ports);
+	}
+	if (routes->entries) free(routes->entries);
+	dchk_routes_Uncompile(routes);
+	free(routes);
+}
+
+static int dchk_routes_AddServers(DCHK_ROUTES_ENTRY *e, const char *servers)
+/*!\brief Add a comma separated list of servers to a route
+ *
+ * \internal
+ * A server is given as "host", "host:port" or "[address]:port". A host with more than one
+ * colon is an IPv6 address without port, which has to be enclosed in brackets to add a port.
+ */
+{
+	const char *s=servers, *end, *host, *hostend, *colon, *d;
+	int colons;
+	while (*s) {
+		while (*s==',' || *s==' ' || *s=='\t') s++;
+		if (!*s) break;
+		end=s;
+		while (*end && *end!=',' && *end!=' ' && *end!='\t') end++;
+		if (*s=='[') {
+			host=s+1;
+			hostend=host;
+			while (hostend<end && *hostend!=']') hostend++;
+			if (hostend==end) return 0;
+			colon=hostend+1;
+			if (colon<end && *colon!=':') return 0;
+		} else {
+			host=s;
+			colons=0;
+			colon=end;
+			for (d=s;d<end;d++) {
+				if (*d==':') {
+					colons++;
+					colon=d;
+				}
+			}
+			if (colons>1) colon=end;
+			hostend=colon;
+		}
+		int port=0;
+		if (colon<end) {
+			if (colon+1==end) return 0;
+			for (d=colon+1;d<end;d++) {
+				if (*d<'0' || *d>'9') return 0;
+				port=port*10+(*d-'0');
+				if (port>65535) return 0;
+			}
+		}
+		if (hostend==host) return 0;
+		char **hosts=(char**)realloc(e->hosts,(e->numservers+1)*sizeof(char*));
+		if (!hosts) return 0;
+		e->hosts=hosts;
+		int *ports=(int*)realloc(e->ports,(e->numservers+1)*sizeof(int));
+		if (!ports) return 0;
+		e->ports=ports;
+		e->hosts[e->numservers]=strndup(host,hostend-host);
+		if (!e->hosts[e->numservers]) return 0;
+		e->ports[e->numservers]=port;
+		e->numservers++;
+		s=end;
+	}
+	return 1;
+}
+
+int dchk_AddRoute(DCHK_ROUTES *routes, const char *suffix, const char *authority, const char *servers)
+/*!\brief Add a route to a routing table
+ *
+ * \param[in] routes pointer to a table created with \ref dchk_NewRoutes
+ * \param[in] suffix one or more labels at the end of a domain name, like "de" or
+ * "9.4.e164.arpa". A leading or trailing dot is ignored, upper and lower case are not
+ * distinguished.
+ * \param[in] authority authority of the domains of this route. If it is NULL or "-", the
+ * suffix is used as authority.
+ * \param[in] servers optional comma separated list of servers in the form
+ * "host[:port]", which serve the domains of this route. IPv6 addresses with a port are
+ * written as "[address]:port". If it is NULL or empty, the servers are taken from the handle
+ * or found with \ref dchk_SetHostByDNS.
+ * \returns Number of the new route, which is 0 or greater, on success. If one of the
+ * parameters is invalid or not enough memory is available, -1 is returned.
+ *
+ * \remarks
+ * If a suffix is added more than once, the last route is used. The table is compiled again on
+ * the next use, see \ref dchk_SetRoutes.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!routes || !suffix) return -1;
+	while (*suffix=='.') suffix++;
+	int i, len=(int)strlen(suffix);
+	if (len>0 && suffix[len-1]=='.') len--;
+	if (len==0 || len>255) return -1;
+	for (i=0;i<len;i++) {
+		if ((unsigned char)suffix[i]<=' ' || (suffix[i]=='.' && suffix[i+1]=='.')) return -1;
+	}
+	if (routes->num>=routes->size) {
+		int size=routes->size ? routes->size*2 : 64;
+		DCHK_ROUTES_ENTRY *entries=(DCHK_ROUTES_ENTRY*)realloc(routes->entries,size*sizeof(DCHK_ROUTES_ENTRY));
+		if (!entries) return -1;
+		routes->entries=entries;
+		routes->size=size;
+	}
+	DCHK_ROUTES_ENTRY *e=&routes->entries[routes->num];
+	bzero(e,sizeof(DCHK_ROUTES_ENTRY));
+	e->key=(char*)malloc(len+1);
+	if (authority && (authority[0]==0 || strcmp(authority,"-")==0)) authority=NULL;
+	e->authority=authority ? strdup(authority) : strndup(suffix,len);
+	if (!e->key || !e->authority || (servers && !dchk_routes_AddServers(e,servers))) {
+		free(e->key);
+		free(e->authority);
+		for (i=0;i<e->numservers;i++) free(e->hosts[i]);
+		if (e->hosts) free(e->hosts);
+		if (e->ports) free(e->ports);
+		return -1;
+	}
+	for (i=0;i<len;i++) e->key[i]=dchk_routes_Lower(suffix[len-1-i]);
+	e->key[len]=0;
+	routes->chars+=len;
+	dchk_routes_Uncompile(routes);
+	return routes->num++;
+}
+
+/*!\brief Sort key of a route
+ *
+ * \internal
+ */
+typedef struct {
+	const char *key;
+	int route;
+} DCHK_ROUTES_KEY;
+
+static int dchk_routes_Compare(const void *a, const void *b)
+{
+	const DCHK_ROUTES_KEY *ka=(const DCHK_ROUTES_KEY*)a, *kb=(const DCHK_ROUTES_KEY*)b;
+	int cmp=strcmp(ka->key,kb->key);
+	if (cmp) return cmp;
+	return ka->route-kb->route;
+}
+
+static void dchk_routes_Build(DCHK_ROUTES *routes, int node, const DCHK_ROUTES_KEY *order, int lo, int hi, int depth)
+/*!\brief Create the children of a node from a sorted range of keys with a common prefix
+ *
+ * \internal
+ */
+{
+	// Keys ending in this node are sorted first, the last one added wins
+	while (lo<hi && order[lo].key[depth]==0) routes->nodes[node].route=order[lo++].route;
+	int i, start, child;
+	unsigned char c;
+	int num=0;
+	for (i=lo;i<hi;i++) {
+		if (i==lo || order[i].key[depth]!=order[i-1].key[depth]) num++;
+	}
+	routes->nodes[node].first=routes->numnodes;
+	routes->nodes[node].num=num;
+	routes->numnodes+=num;
+	child=routes->nodes[node].first;
+	for (start=lo;start<hi;child++) {
+		c=(unsigned char)order[start].key[depth];
+		for (i=start+1;i<hi && (unsigned char)order[i].key[depth]==c;i++) ;
+		routes->edges[child]=c;
+		routes->nodes[child].route=-1;
+		dchk_routes_Build(routes,child,order,start,i,depth+1);
+		start=i;
+	}
+}
+
+static int dchk_routes_Compile(DCHK_ROUTES *routes)
+/*!\brief Compile the suffixes of the table into a trie
+ *
+ * \internal
+ * The keys are sorted, so the children of each node can be stored in one block.
+ */
+{
+	int i;
+	if (routes->nodes) return 1;
+	DCHK_ROUTES_KEY *order=(DCHK_ROUTES_KEY*)malloc((routes->num+1)*sizeof(DCHK_ROUTES_KEY));
+	routes->nodes=(DCHK_TRIE_NODE*)malloc((routes->chars+1)*sizeof(DCHK_TRIE_NODE));
+	routes->edges=(unsigned char*)malloc(routes->chars+1);
+	if (!order || !routes->nodes || !routes->edges) {
+		if (order) free(order);
+		dchk_routes_Uncompile(routes);
+		return 0;
+	}
+	for (i=0;i<routes->num;i++) {
+		order[i].key=routes->entries[i].key;
+		order[i].route=i;
+	}
+	qsort(order,routes->num,sizeof(DCHK_ROUTES_KEY),dchk_routes_Compare);
+	routes->numnodes=1;
+	routes->nodes[0].route=-1;
+	routes->edges[0]=0;
+	dchk_routes_Build(routes,0,order,0,routes->num,0);
+	free(order);
+	return 1;
+}
+
+int dchk_LoadRoutes(IRISLWZ_HANDLE *handle, DCHK_ROUTES *routes, const char *filename)
+/*!\brief Add the routes of a file to a routing table
+ *
+ * Each line of the file contains one route. It starts with the suffix, followed by the
+ * authority and optionally by one or more servers, separated by spaces or tabs (see
+ * \ref dchk_AddRoute). If the authority is missing or "-", the suffix is used. Empty lines
+ * and lines starting with "#" are ignored.
+ *
+ * \code
+# suffix            authority       servers
+de
+at                  -
+e164.arpa           -
+9.4.e164.arpa       -               enum1.example.com enum2.example.com:7150 [2001:db8::1]:7150
+co.uk               uk
+ * \endcode
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object, which receives the error
+ * \param[in] routes pointer to a table created with \ref dchk_NewRoutes
+ * \param[in] filename name of the file
+ * \returns On success, the function returns 1, otherwise 0. Routes of the file in front of an
+ * invalid line stay in the table.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!handle) return 0;
+	if (!routes) {
+		irislwz_SetError(handle,74025,"int dchk_LoadRoutes(IRISLWZ_HANDLE *handle, ==> DCHK_ROUTES *routes <==, const char *filename)");
+		return 0;
+	}
+	if (!filename) {
+		irislwz_SetError(handle,74025,"int dchk_LoadRoutes(IRISLWZ_HANDLE *handle, DCHK_ROUTES *routes, ==> const char *filename <==)");
+		return 0;
+	}
+	FILE *fp=fopen(filename,"rb");
+	if (!fp) {
+		irislwz_SetError(handle,74059,"%s",filename);
+		return 0;
+	}
+	char line[2048];
+	char *suffix, *authority, *servers, *p;
+	int len, num=0;
+	while (fgets(line,sizeof(line),fp)) {
+		num++;
+		len=(int)strlen(line);
+		if (len==sizeof(line)-1 && line[len-1]!='\n' && !feof(fp)) {
+			fclose(fp);
+			irislwz_SetError(handle,74108,"%s:%i: line too long",filename,num);
+			return 0;
+		}
+		while (len>0 && (unsigned char)line[len-1]<=' ') line[--len]=0;
+		p=line;
+		while (*p==' ' || *p=='\t') p++;
+		if (*p==0 || *p=='#') continue;
+		suffix=p;
+		while (*p && *p!=' ' && *p!='\t') p++;
+		authority=NULL;
+		servers=NULL;
+		if (*p) {
+			*p++=0;
+			while (*p==' ' || *p=='\t') p++;
+			authority=p;
+			while (*p && *p!=' ' && *p!='\t') p++;
+			if (*p) {
+				*p++=0;
+				servers=p;
+			}
+		}
+		if (dchk_AddRoute(routes,suffix,authority,servers)<0) {
+			fclose(fp);
+			irislwz_SetError(handle,74108,"%s:%i: %s",filename,num,suffix);
+			return 0;
+		}
+	}
+	fclose(fp);
+	return 1;
+}
+
+int dchk_SetRoutes(IRISLWZ_HANDLE *handle, DCHK_ROUTES *routes)
+/*!\brief Use a routing table to find the authority of domains
+ *
+ * After this call, \ref irislwz_SetAuthorityByDomain and \ref dchk_QueryDomainListByAuthority
+ * take the authority of a domain from the matching route of the table. Domains without a
+ * matching route get the authority of their TLD, as without a table.
+ * \ref dchk_QueryDomainListByAuthority queries the domains of each route as a group of their
+ * own and sends them to the servers of the route, if it has any.
+ *
+ * The table is compiled by this function. It is not copied, it must not be changed as long as
+ * it is used, and it must not be freed as long as it is used by the handle or by handles
+ * cloned from it. Configurations created from the handle keep their own reference to the
+ * table (see \ref irislwz_NewConfig). Any number of handles and threads can use the same
+ * table at the same time.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] routes pointer to a table created with \ref dchk_NewRoutes or NULL to remove the
+ * table from the handle
+ * \returns On success, the function returns 1, otherwise 0.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!handle) return 0;
+	if (routes && !dchk_routes_Compile(routes)) {
+		irislwz_SetError(handle,74024,NULL);
+		return 0;
+	}
+	handle->routes=routes;
+	return 1;
+}
+
+int dchk_FindRoute(DCHK_ROUTES *routes, const char *domain)
+/*!\brief Find the route of a domain
+ *
+ * \param[in] routes pointer to a table created with \ref dchk_NewRoutes
+ * \param[in] domain domain name
+ * \returns Number of the route with the longest suffix matching \p domain or -1, if no route
+ * matches.
+ *
+ * \remarks
+ * If the table was changed after it was compiled, it is compiled again, which is not thread
+ * safe. Tables used by several threads should be compiled once with \ref dchk_SetRoutes.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!routes || !domain) return -1;
+	if (!routes->nodes && !dchk_routes_Compile(routes)) return -1;
+	const DCHK_TRIE_NODE *nodes=routes->nodes, *node=nodes;
+	const unsigned char *edges=routes->edges, *edge, *end;
+	int len=(int)strlen(domain);
+	int route=-1;
+	unsigned char c;
+	if (len>0 && domain[len-1]=='.') len--;
+	while (len>0) {
+		c=(unsigned char)domain[--len];
+		c=dchk_routes_Lower(c);
+		edge=edges+node->first;
+		end=edge+node->num;
+		while (edge<end && *edge!=c) edge++;
+		if (edge==end) break;
+		node=nodes+(edge-edges);
+		// Suffixes only match complete labels
+		if (node->route>=0 && (len==0 || domain[len-1]=='.')) route=node->route;
+	}
+	return route;
+}
+
+int dchk_GetRouteCount(DCHK_ROUTES *routes)
+/*!\brief Returns the number of routes in a table
+ *
+ * \param[in] routes pointer to a table created with \ref dchk_NewRoutes
+ * \returns Number of routes. Routes are numbered from 0 to the number of routes minus 1.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!routes) return 0;
+	return routes->num;
+}
+
+const char *dchk_GetRouteAuthority(DCHK_ROUTES *routes, int route)
+/*!\brief Returns the authority of a route
+ *
+ * \param[in] routes pointer to a table created with \ref dchk_NewRoutes
+ * \param[in] route number of the route, see \ref dchk_FindRoute
+ * \returns Pointer to the authority or NULL, if the route does not exist.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_DCHK
+ */
+{
+	if (!routes || route<0 || route>=routes->num) return NULL;
+	return routes->entries[route].authority;
+}
+
+int dchk_SetRouteServers(IRISLWZ_HANDLE *handle, DCHK_ROUTES *routes, int route)
+/*!\brief Replace the server pool of a handle with the servers of a route
+ *
+ * \internal
+ * \returns 1, if the servers were set, 0 on error and -1, if the route has no servers. In this
+ * case the handle is not changed.
+ */
+{
+	if (!routes || route<0 || route>=routes->num) return -1;
+	DCHK_ROUTES_ENTRY *e=&routes->entries[route];
+	if (!e->numservers) return -1;
+	int i;
+	irislwz_ClearServers(handle);
+	for (i=0;i<e->numservers;i++) {
+		if (!irislwz_AddServer(handle,e->hosts[i],e->ports[i] ? e->ports[i] : handle->port,0,0)) return 0;
+	}
+	return irislwz_SelectServer(handle);
+}
@@ -0,0 +1,650 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+#ifdef HAVE_STRINGS_H
+	#include <strings.h>
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+
+/*
+ * Fast path for parsing answers
+ *
+ * DCHK servers only send a few different documents: resultSets with nameNotFound, invalidName
+ * or a dchk1:domain answer, and the "size" and "other" documents of the transport. This
+ * scanner reads these documents directly from the payload without allocating memory. All
+ * strings are views into the payload.
+ *
+ * The scanner is strict. Anything it does not know, like comments, DOCTYPE, CDATA, entity
+ * references, undeclared namespace prefixes or documents nested too deep, makes it give up,
+ * and the answer is parsed by libxml2 as before (see xmlparser.c).
+ */
+
+#define DCHK_SCAN_MAXDEPTH	16
+#define DCHK_SCAN_MAXNS		16
+#define DCHK_SCAN_MAXATTR	16
+
+#define DCHK_TOKEN_ERROR	-1
+#define DCHK_TOKEN_EOF		0
+#define DCHK_TOKEN_START	1
+#define DCHK_TOKEN_END		2
+#define DCHK_TOKEN_TEXT		3
+
+static const char DCHK_NS_IRIS1[]="urn:ietf:params:xml:ns:iris1";
+static const char DCHK_NS_DCHK1[]="urn:ietf:params:xml:ns:dchk1";
+
+typedef struct {
+	const char *p;
+	int len;
+} DCHK_VIEW;
+
+typedef struct {
+	DCHK_VIEW prefix;
+	DCHK_VIEW uri;
+	int depth;
+} DCHK_SCAN_NS;
+
+typedef struct {
+	const char *pos;
+	const char *end;
+	int depth;
+	int pendingEnd;				// last start tag was empty, the end token is still to come
+	int seenRoot;
+	DCHK_VIEW open[DCHK_SCAN_MAXDEPTH];
+	DCHK_SCAN_NS ns[DCHK_SCAN_MAXNS];
+	int nscount;
+	// current token
+	DCHK_VIEW name;				// local name of the element
+	DCHK_VIEW uri;				// namespace of the element
+	DCHK_VIEW attr;				// attributes of a start tag
+	DCHK_VIEW text;				// content of a text token
+} DCHK_SCANNER;
+
+
+static int dchk_ViewEquals(const DCHK_VIEW *v, const char *s)
+{
+	int len=(int)strlen(s);
+	return (v->len==len && memcmp(v->p,s,len)==0);
+}
+
+static int dchk_IsSpace(char c)
+{
+	return (c==' ' || c=='\t' || c=='\r' || c=='\n');
+}
+
+static int dchk_IsNameChar(unsigned char c)
+{
+	return ((c>='a' && c<='z') || (c>='A' && c<='Z') || (c>='0' && c<='9')
+			|| c=='_' || c=='-' || c=='.' || c==':');
+}
+
+static int dchk_CheckChars(const char *p, const char *end)
+/*!\brief Check characters of text and attribute values
+ *
+ * \internal
+ * Entity references, markup characters and control characters are not handled by the
+ * scanner. Bytes above 127 must be characters libxml2 accepts, see \ref dchk_DecodeUTF8.
+ */
+{
+	const char *start=p;
+	while (p<end) {
+		unsigned char c=(unsigned char)*p;
+		if (c<128) {
+			if (c<32 && c!='\t' && c!='\r' && c!='\n') return 0;
+			if (c=='&' || c=='<') return 0;
+			if (c=='>' && p-start>=2 && p[-1]==']' && p[-2]==']') return 0;
+			p++;
+			continue;
+		}
+		if (dchk_DecodeUTF8((const unsigned char**)&p,(const unsigned char*)end)<0) return 0;
+	}
+	return 1;
+}
+
+static int dchk_ScanName(DCHK_SCANNER *s, DCHK_VIEW *name)
+{
+	const char *p=s->pos;
+	if (p>=s->end || !dchk_IsNameChar((unsigned char)*p) || *p=='-' || *p=='.' || *p==':'
+		|| (*p>='0' && *p<='9')) return 0;
+	while (p<s->end && dchk_IsNameChar((unsigned char)*p)) p++;
+	name->p=s->pos;
+	name->len=(int)(p-s->pos);
+	s->pos=p;
+	return 1;
+}
+
+static void dchk_SkipSpace(DCHK_SCANNER *s)
+{
+	while (s->pos<s->end && dchk_IsSpace(*s->pos)) s->pos++;
+}
+
+static int dchk_SplitName(const DCHK_VIEW *qname, DCHK_VIEW *prefix, DCHK_VIEW *local)
+/*!\brief Split a qualified name into prefix and local name
+ *
+ * \internal
+ */
+{
+	const char *colon=(const char*)memchr(qname->p,':',qname->len);
+	if (!colon) {
+		prefix->p=qname->p;
+		prefix->len=0;
+		*local=*qname;
+		return 1;
+	}
+	prefix->p=qname->p;
+	prefix->len=(int)(colon-qname->p);
+	local->p=colon+1;
+	local->len=qname->len-prefix->len-1;
+	if (prefix->len==0 || local->len==0 || memchr(local->p,':',local->len)) return 0;
+	return 1;
+}
+
+static int dchk_ResolvePrefix(DCHK_SCANNER *s, const DCHK_VIEW *prefix, DCHK_VIEW *uri)
+{
+	for (int i=s->nscount-1;i>=0;i--) {
+		if (s->ns[i].prefix.len==prefix->len && memcmp(s->ns[i].prefix.p,prefix->p,prefix->len)==0) {
+			*uri=s->ns[i].uri;
+			return 1;
+		}
+	}
+	// Element without prefix and without default namespace
+	if (prefix->len==0) {
+		uri->p=NULL;
+		uri->len=0;
+		return 1;
+	}
+	return 0;
+}
+
+static int dchk_ScanAttributes(DCHK_SCANNER *s)
+/*!\brief Scan the attributes of a start tag
+ *
+ * \internal
+ * Namespace declarations are pushed on the namespace stack of the scanner. The position is
+ * left at "/>" or ">".
+ */
+{
+	DCHK_VIEW names[DCHK_SCAN_MAXATTR];
+	int count=0;
+	s->attr.p=s->pos;
+	while (1) {
+		int space=(s->pos<s->end && dchk_IsSpace(*s->pos));
+		dchk_SkipSpace(s);
+		if (s->pos>=s->end) return 0;
+		if (*s->pos=='>' || *s->pos=='/') break;
+		if (!space) return 0;
+		DCHK_VIEW name, value;
+		if (!dchk_ScanName(s,&name)) return 0;
+		dchk_SkipSpace(s);
+		if (s->pos>=s->end || *s->pos!='=') return 0;
+		s->pos++;
+		dchk_SkipSpace(s);
+		if (s->pos>=s->end || (*s->pos!='"' && *s->pos!='\'')) return 0;
+		char quote=*s->pos++;
+		const char *q=(const char*)memchr(s->pos,quote,s->end-s->pos);
+		if (!q) return 0;
+		value.p=s->pos;
+		value.len=(int)(q-s->pos);
+		if (!dchk_CheckChars(value.p,q)) return 0;
+		s->pos=q+1;
+		// duplicate attributes are not allowed
+		if (count>=DCHK_SCAN_MAXATTR) return 0;
+		for (int i=0;i<count;i++) {
+			if (names[i].len==name.len && memcmp(names[i].p,name.p,name.len)==0) return 0;
+		}
+		names[count++]=name;
+		// namespace declaration?
+		if (name.len>=5 && memcmp(name.p,"xmlns",5)==0) {
+			if (name.len>5 && name.p[5]!=':') continue;
+			if (s->nscount>=DCHK_SCAN_MAXNS) return 0;
+			DCHK_SCAN_NS *ns=&s->ns[s->nscount++];
+			ns->prefix.p=name.p+6;
+			ns->prefix.len=(name.len>5 ? name.len-6 : 0);
+			if (name.len>5 && ns->prefix.len==0) return 0;
+			ns->uri=value;
+			ns->depth=s->depth;
+		}
+	}
+	s->attr.len=(int)(s->pos-s->attr.p);
+	return 1;
+}
+
+static int dchk_ScanNext(DCHK_SCANNER *s)
+/*!\brief Read the next token
+ *
+ * \internal
+ * Every start token is followed by an end token, also for empty elements. Whitespace
+ * outside of the root element is skipped. Returns DCHK_TOKEN_ERROR, if the document
+ * contains anything the scanner does not handle.
+ */
+{
+	if (s->pendingEnd) {
+		s->pendingEnd=0;
+		goto endelement;
+	}
+	if (s->depth==0) {
+		dchk_SkipSpace(s);
+		if (s->pos>=s->end) return (s->seenRoot ? DCHK_TOKEN_EOF : DCHK_TOKEN_ERROR);
+		if (s->seenRoot || *s->pos!='<') return DCHK_TOKEN_ERROR;
+	}
+	if (s->pos>=s->end) return DCHK_TOKEN_ERROR;
+	if (*s->pos!='<') {
+		// Text
+		const char *q=(const char*)memchr(s->pos,'<',s->end-s->pos);
+		if (!q) return DCHK_TOKEN_ERROR;
+		if (!dchk_CheckChars(s->pos,q)) return DCHK_TOKEN_ERROR;
+		s->text.p=s->pos;
+		s->text.len=(int)(q-s->pos);
+		s->pos=q;
+		return DCHK_TOKEN_TEXT;
+	}
+	s->pos++;
+	if (s->pos>=s->end) return DCHK_TOKEN_ERROR;
+	if (*s->pos=='/') {
+		// End tag
+		DCHK_VIEW qname;
+		s->pos++;
+		if (s->depth==0 || !dchk_ScanName(s,&qname)) return DCHK_TOKEN_ERROR;
+		dchk_SkipSpace(s);
+		if (s->pos>=s->end || *s->pos!='>') return DCHK_TOKEN_ERROR;
+		s->pos++;
+		DCHK_VIEW *open=&s->open[s->depth-1];
+		if (open->len!=qname.len || memcmp(open->p,qname.p,qname.len)!=0) return DCHK_TOKEN_ERROR;
+		goto endelement;
+	}
+	// Start tag. Comments, CDATA, DOCTYPE and processing instructions are not handled.
+	if (*s->pos=='!' || *s->pos=='?') return DCHK_TOKEN_ERROR;
+	if (s->depth>=DCHK_SCAN_MAXDEPTH) return DCHK_TOKEN_ERROR;
+	DCHK_VIEW qname, prefix;
+	if (!dchk_ScanName(s,&qname)) return DCHK_TOKEN_ERROR;
+	if (!dchk_SplitName(&qname,&prefix,&s->name)) return DCHK_TOKEN_ERROR;
+	s->depth++;
+	s->open[s->depth-1]=qname;
+	if (!dchk_ScanAttributes(s)) return DCHK_TOKEN_ERROR;
+	if (*s->pos=='/') {
+		s->pos++;
+		if (s->pos>=s->end || *s->pos!='>') return DCHK_TOKEN_ERROR;
+		s->pendingEnd=1;
+	}
+	s->pos++;
+	if (!dchk_ResolvePrefix(s,&prefix,&s->uri)) return DCHK_TOKEN_ERROR;
+	s->seenRoot=1;
+	return DCHK_TOKEN_START;
+
+endelement:
+	{
+		DCHK_VIEW prefix;
+		dchk_SplitName(&s->open[s->depth-1],&prefix,&s->name);
+		if (!dchk_ResolvePrefix(s,&prefix,&s->uri)) return DCHK_TOKEN_ERROR;
+		// remove namespace declarations of this element
+		while (s->nscount>0 && s->ns[s->nscount-1].depth>=s->depth) s->nscount--;
+		s->depth--;
+		return DCHK_TOKEN_END;
+	}
+}
+
+static int dchk_ScanStart(DCHK_SCANNER *s, const char *xml, int size)
+/*!\brief Initialize the scanner and skip the XML declaration
+ *
+ * \internal
+ */
+{
+	memset(s,0,sizeof(DCHK_SCANNER));
+	s->pos=xml;
+	s->end=xml+size;
+	if (size>=5 && memcmp(xml,"<?xml",5)==0 && (size==5 || dchk_IsSpace(xml[5]))) {
+		const char *p=xml+5;
+		while (p+1<s->end && !(p[0]=='?' && p[1]=='>')) {
+			if (*p=='<' || *p=='>') return 0;
+			p++;
+		}
+		if (p+1>=s->end) return 0;
+		// Only UTF-8 is handled
+		const char *enc=xml+5;
+		while (enc+8<p && memcmp(enc,"encoding",8)!=0) enc++;
+		if (enc+8<p) {
+			enc+=8;
+			while (enc<p && *enc!='"' && *enc!='\'') enc++;
+			if (p-enc<7 || strncasecmp(enc+1,"UTF-8",5)!=0 || enc[6]!=enc[0]) return 0;
+		}
+		s->pos=p+2;
+	}
+	return 1;
+}
+
+static int dchk_ScanElementIs(DCHK_SCANNER *s, const char *name, const char *uri)
+{
+	if (!dchk_ViewEquals(&s->name,name)) return 0;
+	if (!uri) return 1;
+	return (s->uri.p!=NULL && dchk_ViewEquals(&s->uri,uri));
+}
+
+static int dchk_ScanSkip(DCHK_SCANNER *s)
+/*!\brief Skip the element, whose start token was just read
+ *
+ * \internal
+ */
+{
+	int depth=1, token;
+	while (depth>0) {
+		token=dchk_ScanNext(s);
+		if (token==DCHK_TOKEN_START) depth++;
+		else if (token==DCHK_TOKEN_END) depth--;
+		else if (token!=DCHK_TOKEN_TEXT) return 0;
+	}
+	return 1;
+}
+
+static int dchk_ScanText(DCHK_SCANNER *s, DCHK_VIEW *text)
+/*!\brief Read the text content of the element, whose start token was just read
+ *
+ * \internal
+ * Like the libxml2 parser, the last text of the element is used.
+ */
+{
+	int token;
+	text->p=NULL;
+	text->len=0;
+	while (1) {
+		token=dchk_ScanNext(s);
+		if (token==DCHK_TOKEN_END) return 1;
+		if (token==DCHK_TOKEN_TEXT) *text=s->text;
+		else if (token==DCHK_TOKEN_START) {
+			if (!dchk_ScanSkip(s)) return 0;
+		} else return 0;
+	}
+}
+
+static int dchk_ScanDomain(DCHK_SCANNER *s, DCHK_VIEW *status, DCHK_VIEW *update)
+/*!\brief Scan a dchk1:domain element
+ *
+ * \internal
+ * Finds status and lastDatabaseUpdateDateTime like \ref dchk_XML_ParseDomain. \p status is
+ * left empty, if the domain has no status or domainName.
+ */
+{
+	DCHK_VIEW text, name={NULL,0};
+	int token, havestatus=0, havename=0;
+	status->p=update->p=NULL;
+	status->len=update->len=0;
+	while ((token=dchk_ScanNext(s))!=DCHK_TOKEN_END) {
+		if (token==DCHK_TOKEN_TEXT) continue;
+		if (token!=DCHK_TOKEN_START) return 0;
+		if (dchk_ViewEquals(&s->name,"domainName")) {
+			if (!dchk_ScanText(s,&text)) return 0;
+			if (text.p) havename=1;
+		} else if (dchk_ViewEquals(&s->name,"lastDatabaseUpdateDateTime")) {
+			if (!dchk_ScanText(s,&text)) return 0;
+			if (text.p) *update=text;
+		} else if (dchk_ViewEquals(&s->name,"status")) {
+			// The name of the last element within status is the status
+			name.len=0;
+			while ((token=dchk_ScanNext(s))!=DCHK_TOKEN_END) {
+				havestatus=1;
+				if (token==DCHK_TOKEN_TEXT) continue;
+				if (token!=DCHK_TOKEN_START) return 0;
+				name=s->name;
+				if (!dchk_ScanSkip(s)) return 0;
+			}
+		} else {
+			if (!dchk_ScanSkip(s)) return 0;
+		}
+	}
+	if (havestatus && havename) *status=name;
+	return 1;
+}
+
+static int dchk_ScanResultSets(DCHK_SCANNER *s, DCHK_DOMAINLIST *domainset)
+/*!\brief Scan an iris1:response document
+ *
+ * \internal
+ * Works like \ref dchk_XML_ParseResult. If \p domainset is NULL, the document is only
+ * checked.
+ */
+{
+	int token, i=0;
+	DCHK_RECORD *r=NULL;
+	if (domainset) r=domainset->first;
+	if (dchk_ScanNext(s)!=DCHK_TOKEN_START || !dchk_ScanElementIs(s,"response",DCHK_NS_IRIS1)) return 0;
+	while ((token=dchk_ScanNext(s))!=DCHK_TOKEN_END) {
+		if (token==DCHK_TOKEN_TEXT) continue;
+		if (token!=DCHK_TOKEN_START) return 0;
+		if (!dchk_ScanElementIs(s,"resultSet",DCHK_NS_IRIS1)) {
+			if (!dchk_ScanSkip(s)) return 0;
+			continue;
+		}
+		// nameNotFound takes precedence over invalidName, which takes precedence over an answer
+		int nameNotFound=0, invalidName=0, domain=0;
+		DCHK_VIEW status={NULL,0}, update={NULL,0};
+		while ((token=dchk_ScanNext(s))!=DCHK_TOKEN_END) {
+			if (token==DCHK_TOKEN_TEXT) continue;
+			if (token!=DCHK_TOKEN_START) return 0;
+			if (dchk_ScanElementIs(s,"nameNotFound",DCHK_NS_IRIS1)) {
+				nameNotFound=1;
+				if (!dchk_ScanSkip(s)) return 0;
+			} else if (dchk_ScanElementIs(s,"invalidName",DCHK_NS_IRIS1)) {
+				invalidName=1;
+				if (!dchk_ScanSkip(s)) return 0;
+			} else if (!domain && dchk_ScanElementIs(s,"answer",DCHK_NS_IRIS1)) {
+				while ((token=dchk_ScanNext(s))!=DCHK_TOKEN_END) {
+					if (token==DCHK_TOKEN_TEXT) continue;
+					if (token!=DCHK_TOKEN_START) return 0;
+					if (!domain && dchk_ScanElementIs(s,"domain",DCHK_NS_DCHK1)) {
+						domain=1;
+						if (!dchk_ScanDomain(s,&status,&update)) return 0;
+					} else if (!dchk_ScanSkip(s)) return 0;
+				}
+			} else {
+				if (!dchk_ScanSkip(s)) return 0;
+			}
+		}
+		// Records, which were found invalid locally, have not been sent
+		while (r && i<domainset->num && r->checkedLocally) {
+			i++;
+			r=r->next;
+		}
+		if (r && i<domainset->num) {
+			if (nameNotFound) r->status=strdup("free");
+			else if (invalidName) r->status=strdup("invalid");
+			else if (status.len) {
+				r->status=strndup(status.p,status.len);
+				if (update.p) r->lastdatabaseupdate=strndup(update.p,update.len);
+			}
+			r=r->next;
+		}
+		i++;
+	}
+	return (dchk_ScanNext(s)==DCHK_TOKEN_EOF);
+}
+
+static int dchk_ScanSizeDocument(DCHK_SCANNER *s, int *octets)
+/*!\brief Scan a size information document
+ *
+ * \internal
+ */
+{
+	int token;
+	DCHK_VIEW text={NULL,0};
+	if (dchk_ScanNext(s)!=DCHK_TOKEN_START || !dchk_ViewEquals(&s->name,"size")) return 0;
+	while ((token=dchk_ScanNext(s))!=DCHK_TOKEN_END) {
+		if (token==DCHK_TOKEN_TEXT) continue;
+		if (token!=DCHK_TOKEN_START) return 0;
+		if (!text.len && dchk_ViewEquals(&s->name,"response")) {
+			while ((token=dchk_ScanNext(s))!=DCHK_TOKEN_END) {
+				if (token==DCHK_TOKEN_TEXT) continue;
+				if (token!=DCHK_TOKEN_START) return 0;
+				if (!text.len && dchk_ViewEquals(&s->name,"octets")) {
+					if (!dchk_ScanText(s,&text)) return 0;
+				} else if (!dchk_ScanSkip(s)) return 0;
+			}
+		} else if (!dchk_ScanSkip(s)) return 0;
+	}
+	if (dchk_ScanNext(s)!=DCHK_TOKEN_EOF) return 0;
+	// Without octets we let libxml2 report the error
+	if (!text.len) return 0;
+	if (octets) {
+		*octets=0;
+		for (int i=0;i<text.len && text.p[i]>='0' && text.p[i]<='9';i++) *octets=*octets*10+(text.p[i]-'0');
+	}
+	return 1;
+}
+
+static int dchk_ScanAttribute(const DCHK_VIEW *attr, const char *name, DCHK_VIEW *value)
+/*!\brief Find an attribute in the attributes of a start tag
+ *
+ * \internal
+ * The attributes have already been checked by \ref dchk_ScanAttributes.
+ */
+{
+	DCHK_SCANNER s;
+	memset(&s,0,sizeof(s));
+	s.pos=attr->p;
+	s.end=attr->p+attr->len;
+	while (1) {
+		DCHK_VIEW n;
+		dchk_SkipSpace(&s);
+		if (!dchk_ScanName(&s,&n)) return 0;
+		dchk_SkipSpace(&s);
+		s.pos++;	// =
+		dchk_SkipSpace(&s);
+		char quote=*s.pos++;
+		const char *q=(const char*)memchr(s.pos,quote,s.end-s.pos);
+		if (dchk_ViewEquals(&n,name)) {
+			value->p=s.pos;
+			value->len=(int)(q-s.pos);
+			return 1;
+		}
+		s.pos=q+1;
+	}
+}
+
+static int dchk_ScanOtherDocument(DCHK_SCANNER *s, DCHK_VIEW *type, DCHK_VIEW *desc)
+/*!\brief Scan an other information document
+ *
+ * \internal
+ */
+{
+	int token, havedesc=0;
+	if (dchk_ScanNext(s)!=DCHK_TOKEN_START || !dchk_ViewEquals(&s->name,"other")) return 0;
+	if (!dchk_ScanAttribute(&s->attr,"type",type)) return 0;
+	desc->p=NULL;
+	desc->len=0;
+	while ((token=dchk_ScanNext(s))!=DCHK_TOKEN_END) {
+		if (token==DCHK_TOKEN_TEXT) continue;
+		if (token!=DCHK_TOKEN_START) return 0;
+		if (!havedesc && dchk_ViewEquals(&s->name,"description")) {
+			// libxml2 uses the first text of the description
+			while ((token=dchk_ScanNext(s))!=DCHK_TOKEN_END) {
+				if (token==DCHK_TOKEN_TEXT) {
+					if (!havedesc) *desc=s->text;
+					havedesc=1;
+				} else if (token!=DCHK_TOKEN_START || !dchk_ScanSkip(s)) return 0;
+			}
+			havedesc=1;
+		} else if (!dchk_ScanSkip(s)) return 0;
+	}
+	return (dchk_ScanNext(s)==DCHK_TOKEN_EOF);
+}
+
+int irislwz_ScanPacket(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *packet)
+/*!\brief Check an answer with the fast path scanner
+ *
+ * \internal
+ * \returns Returns 1, if the scanner knows the document and it is well-formed. In this case
+ * IRISLWZ_PACKET::scanned is set, and the functions in xmlparser.c get their data from the
+ * scanner. Otherwise 0 is returned and no error is set.
+ */
+{
+	DCHK_SCANNER s;
+	DCHK_VIEW type, desc;
+	int ret=0;
+	packet->scanned=0;
+	if (!packet->uncompressed_payload || !packet->header) return 0;
+	if (!dchk_ScanStart(&s,packet->uncompressed_payload,packet->size_uncompressed)) return 0;
+	switch (packet->header->header&3) {
+		case 0: ret=dchk_ScanResultSets(&s,NULL); break;
+		case 2: ret=dchk_ScanSizeDocument(&s,NULL); break;
+		case 3: ret=dchk_ScanOtherDocument(&s,&type,&desc); break;
+		default: ret=0; break;
+	}
+	if (ret) packet->scanned=1;
+	return ret;
+}
+
+int dchk_ScanResult(IRISLWZ_HANDLE *handle, DCHK_DOMAINLIST *domainset)
+/*!\brief Store the results of a scanned answer in the domainset
+ *
+ * \internal
+ * The answer must have been checked with \ref irislwz_ScanPacket.
+ */
+{
+	DCHK_SCANNER s;
+	if (!dchk_ScanStart(&s,handle->response.uncompressed_payload,handle->response.size_uncompressed)) return 0;
+	return dchk_ScanResultSets(&s,domainset);
+}
+
+int dchk_ScanSize(IRISLWZ_HANDLE *handle)
+/*!\brief Returns the octets of a scanned size information
+ *
+ * \internal
+ */
+{
+	DCHK_SCANNER s;
+	int octets=0;
+	if (!dchk_ScanStart(&s,handle->response.uncompressed_payload,handle->response.size_uncompressed)) return 0;
+	if (!dchk_ScanSizeDocument(&s,&octets)) return 0;
+	return octets;
+}
+
+int dchk_ScanOther(IRISLWZ_HANDLE *handle, char *type, int typesize, char *desc, int descsize)
+/*!\brief Returns type and description of a scanned other information
+ *
+ * \internal
+ * Both strings are truncated to the given buffer sizes.
+ */
+{
+	DCHK_SCANNER s;
+	DCHK_VIEW t, d;
+	if (!dchk_ScanStart(&s,handle->response.uncompressed_payload,handle->response.size_uncompressed)) return 0;
+	if (!dchk_ScanOtherDocument(&s,&t,&d)) return 0;
+	if (t.len>=typesize) t.len=typesize-1;
+	if (d.len>=descsize) d.len=descsize-1;
+	memcpy(type,t.p,t.len);
+	type[t.len]=0;
+	memcpy(desc,d.p,d.len);
+	desc[d.len]=0;
+	return 1;
+}
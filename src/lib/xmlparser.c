@@ -96,13 +96,40 @@
 #endif
 	#include <libxml/parser.h>
 	#include <libxml/tree.h>
-	#include <libxml/xpath.h>
-	#include <libxml/xpathInternals.h>
 #endif
 
-void irislwz_xmlGenericErrorFunc (void * ctx, const char * msg, ...)
+/*
+ * Errors are suppressed by the parser options of each call. The global error handler of
+ * libxml2 is left alone, so the library can be used on multiple threads and by programs,
+ * which use libxml2 themselves.
+ */
+#define IRISLWZ_XML_OPTIONS (XML_PARSE_NONET|XML_PARSE_NOERROR|XML_PARSE_NOWARNING)
+
+static xmlDoc *irislwz_ParseXML(IRISLWZ_HANDLE *handle, const char *xml, int size, char **beautified)
+/*!\brief Parse XML and optionally beautify it
+ *
+ * \internal
+ * \returns Pointer to the parsed document, which must be freed with xmlFreeDoc, or NULL, if
+ * the XML is invalid.
+ */
 {
-	return;
+	// Blanks are only dropped for the beautified version, so it can be indented
+	xmlDoc *doc = xmlReadMemory (xml, size,
+				 NULL,
+				 "UTF-8",
+				 IRISLWZ_XML_OPTIONS|(beautified?XML_PARSE_NOBLANKS:0));
+	if (doc == NULL) {
+		irislwz_SetError(handle,74044,NULL);
+		return NULL;
+	}
+	if (beautified) {
+		xmlChar *mem;
+		int memsize;
+		xmlDocDumpFormatMemoryEnc(doc, &mem, &memsize, handle->localcharset,1);
+		*beautified=strdup((char*)mem);
+		xmlFree(mem);
+	}
+	return doc;
 }
 
 int irislwz_Validate(IRISLWZ_HANDLE *handle, const char *xml, char **beautified)
@@ -139,33 +166,156 @@ if (beautified) free(beautified);
  * \ingroup DCHK_API_IRISLWZ
  */
 {
-	xmlSetGenericErrorFunc(handle,irislwz_xmlGenericErrorFunc);
-    xmlDoc *doc = NULL;
-	//xmlNode *root_element = NULL;
-    int size=(int)strlen(xml);
-    //printf ("Query: >>%s<<\n",xml);
-    //printf ("Size: %i Bytes\n",size);
-    doc = xmlReadMemory (xml, size,
-				 NULL,
-				 "UTF-8",
-				 XML_PARSE_NONET);
-	if (doc == NULL) {
-		irislwz_SetError(handle,74044,NULL);
-		return 0;
+	xmlDoc *doc=irislwz_ParseXML(handle,xml,(int)strlen(xml),beautified);
+	if (doc == NULL) return 0;
+	xmlFreeDoc(doc);
+	return 1;
+
+}
+
+int irislwz_ParsePacket(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *packet)
+/*!\brief Parse the payload of a packet
+ *
+ * \internal
+ * The uncompressed payload of \p packet is parsed and the document is stored in
+ * IRISLWZ_PACKET::doc, so \ref irislwz_CheckResponse and \ref dchk_XML_ParseResult can use it
+ * without parsing the payload again. The beautified version is only created on demand by
+ * \ref irislwz_GetBeautified.
+ *
+ * \returns If the XML is valid, the function returns 1, otherwise 0.
+ */
+{
+	irislwz_FreeDocument(packet->doc);
+	packet->doc=irislwz_ParseXML(handle,packet->uncompressed_payload,packet->size_uncompressed,NULL);
+	if (packet->doc == NULL) return 0;
+	return 1;
+}
+
+const char *irislwz_GetBeautified(IRISLWZ_HANDLE *handle, IRISLWZ_PACKET *packet)
+/*!\brief Returns a beautified version of the payload of a packet
+ *
+ * Answers are not beautified when they are received, as most of them are never read by
+ * humans. This function creates the beautified version of the uncompressed payload on the
+ * first call and stores it in IRISLWZ_PACKET::beautified, where it stays until the packet
+ * is freed.
+ *
+ * \param[in] handle pointer to an IRISLWZ_HANDLE object
+ * \param[in] packet pointer to an IRISLWZ_PACKET, usually handle->request or handle->response
+ * \returns Pointer to the beautified XML or NULL, if the packet has no payload or the payload
+ * is not valid XML.
+ *
+ * \since
+ * Version 0.5.8
+ *
+ * \ingroup DCHK_API_IRISLWZ
+ */
+{
+	if (!handle) return NULL;
+	if (!packet) {
+		irislwz_SetError(handle,74025,NULL);
+		return NULL;
 	}
-	if (beautified) {
-		xmlChar *mem;
-		int size;
-		xmlKeepBlanksDefault(0);
-		xmlDocDumpFormatMemoryEnc(doc, &mem, &size, handle->localcharset,1);
-		*beautified=strdup((char*)mem);
-		xmlFree(mem);
+	if (packet->beautified) return packet->beautified;
+	if (!packet->uncompressed_payload) {
+		irislwz_SetError(handle,74025,NULL);
+		return NULL;
 	}
+	xmlDoc *doc=irislwz_ParseXML(handle,packet->uncompressed_payload,packet->size_uncompressed,
+			&packet->beautified);
+	if (doc == NULL) return NULL;
 	xmlFreeDoc(doc);
-	return 1;
+	return packet->beautified;
+}
+
+void irislwz_FreeDocument(void *doc)
+/*!\brief Free a parsed document
+ *
+ * \internal
+ */
+{
+	if (doc) xmlFreeDoc((xmlDoc*)doc);
+}
 
+static xmlDoc *dchk_XML_GetDocument(IRISLWZ_HANDLE *handle)
+/*!\brief Returns the parsed document of the response
+ *
+ * \internal
+ * The response is usually parsed already, when it is received. Otherwise it is parsed now
+ * and the document is kept in the response for further calls.
+ */
+{
+	if (!handle->response.doc) {
+		handle->response.doc=xmlReadMemory (handle->response.uncompressed_payload,
+			handle->response.size_uncompressed, NULL, "UTF-8", IRISLWZ_XML_OPTIONS);
+		if (!handle->response.doc) {
+			irislwz_SetError(handle,74014,NULL);
+			return NULL;
+		}
+	}
+	return (xmlDoc*)handle->response.doc;
+}
+
+
+static int dchk_XML_IsElement(xmlNode *node, const char *name, const char *ns)
+/*!\brief Check name and namespace of an element
+ *
+ * \internal
+ */
+{
+	if (node->type!=XML_ELEMENT_NODE) return 0;
+	if (strcmp((const char*)node->name,name)!=0) return 0;
+	if (!node->ns || !node->ns->href) return 0;
+	if (strcmp((const char*)node->ns->href,ns)!=0) return 0;
+	return 1;
 }
 
+static int dchk_XML_WalkResultSets(IRISLWZ_HANDLE *handle,DCHK_DOMAINLIST *domainset)
+/*!\brief Store the results of the parsed response in the domainset
+ *
+ * \internal
+ */
+{
+	static const char *iris1="urn:ietf:params:xml:ns:iris1";
+	static const char *dchk1="urn:ietf:params:xml:ns:dchk1";
+	xmlDoc *doc = dchk_XML_GetDocument(handle);
+	if (doc == NULL) return 0;
+	xmlNode *response=xmlDocGetRootElement(doc);
+	if (!response || !dchk_XML_IsElement(response,"response",iris1)) return 1;
+
+	xmlNode *resultSet, *node, *answer;
+	int i=0;
+	DCHK_RECORD *r=domainset->first;
+	for (resultSet=response->children; resultSet && i<domainset->num; resultSet=resultSet->next) {
+		if (!dchk_XML_IsElement(resultSet,"resultSet",iris1)) continue;
+		// Records, which were found invalid locally, have not been sent
+		while (i<domainset->num && r->checkedLocally) {
+			i++;
+			r=r->next;
+		}
+		if (i>=domainset->num) break;
+		// nameNotFound takes precedence over invalidName, which takes precedence over an answer
+		int nameNotFound=0, invalidName=0;
+		xmlNode *domain=NULL;
+		for (node=resultSet->children; node; node=node->next) {
+			if (dchk_XML_IsElement(node,"nameNotFound",iris1)) nameNotFound=1;
+			else if (dchk_XML_IsElement(node,"invalidName",iris1)) invalidName=1;
+			else if (!domain && dchk_XML_IsElement(node,"answer",iris1)) {
+				for (answer=node->children; answer; answer=answer->next) {
+					if (dchk_XML_IsElement(answer,"domain",dchk1)) {
+						domain=answer;
+						break;
+					}
+				}
+			}
+		}
+		if (nameNotFound) r->status=strdup("free");
+		else if (invalidName) r->status=strdup("invalid");
+		else if (domain) dchk_XML_ParseDomain(handle,domain,r);
+		i++;
+		r=r->next;
+	}
+	return 1;
+}
 
 int dchk_XML_ParseResult(IRISLWZ_HANDLE *handle,DCHK_DOMAINLIST *domainset)
 /*!\brief Parse DCHK response
@@ -173,6 +323,13 @@ int dchk_XML_ParseResult(IRISLWZ_HANDLE *handle,DCHK_DOMAINLIST *domainset)
  * This function is internally used. It parses the response of a DCHK query and stores various
  * information in the DCHK_DOMAINLIST.
  *
+ * The resultSets of the response are walked once in document order. As resultSets are
+ * guaranteed to come in the same order as the searchSets, the n-th resultSet belongs to the
+ * n-th domain of the \p domainset.
+ *
+ * Afterwards the packets are freed according to the retention policy of the handle
+ * (see \ref irislwz_SetRetention).
+ *
  * \param[in] handle pointer to an IRISLWZ_HANDLE object
  * \param[in,out] domainset pointer to a DCHK_DOMAINLIST
  * \returns On success, the function returns 1, otherwise 0.
@@ -180,84 +337,11 @@ int dchk_XML_ParseResult(IRISLWZ_HANDLE *handle,DCHK_DOMAINLIST *domainset)
  * \ingroup DCHK_API_DCHK
  */
 {
-	xmlDoc *doc = NULL;
-	xmlXPathContext *xpathCtx;
-	xmlXPathObject  *xpathObj;
-	doc = xmlReadMemory (handle->response.uncompressed_payload,
-			handle->response.size_uncompressed, NULL, NULL, 0);
-	if (doc == NULL) {
-		irislwz_SetError(handle,74014,NULL);
-		return 0;
-	}
-	//printf ("answer: >>>%s<<<\n",handle->response.uncompressed_payload);
-    //Create xpath evaluation context
-    xpathCtx = xmlXPathNewContext(doc);
-    if(xpathCtx == NULL) {
-    	irislwz_SetError(handle,74015,NULL);
-        xmlFreeDoc(doc);
-        return(0);
-    }
-    /* do register namespace */
-    if (xmlXPathRegisterNs(xpathCtx, (const xmlChar*)"iris1",(const xmlChar*)"urn:ietf:params:xml:ns:iris1") != 0) {
-    	irislwz_SetError(handle,74018,"iris1");
-    	xmlXPathFreeContext(xpathCtx);
-        xmlFreeDoc(doc);
-        return(0);
-    }
-    if (xmlXPathRegisterNs(xpathCtx, (const xmlChar*)"dchk1",(const xmlChar*)"urn:ietf:params:xml:ns:dchk1") != 0) {
-    	irislwz_SetError(handle,74018,"dchk1");
-    	xmlXPathFreeContext(xpathCtx);
-        xmlFreeDoc(doc);
-        return(0);
-    }
-    if (xmlXPathRegisterNs(xpathCtx, (const xmlChar*)"urn",(const xmlChar*)"urn:ietf:params:xml:ns:dchk1") != 0) {
-    	irislwz_SetError(handle,74018,"urn");
-    	xmlXPathFreeContext(xpathCtx);
-        xmlFreeDoc(doc);
-        return(0);
-    }
-
-    int ret=0;
-    int i;
-    char expr[1024];
-    DCHK_RECORD *r=domainset->first;
-
-    // resultSets are guaranteed to come in the same order as searchSets
-    for (i=1;i<=domainset->num;i++,r=r->next) {
-    	// check nameNotFound
-    	sprintf(expr,"//iris1:response/iris1:resultSet[%i]/iris1:nameNotFound",i);
-    	xpathObj = xmlXPathEvalExpression((const xmlChar *)expr, xpathCtx);
-    	if(xpathObj!=NULL && xpathObj->nodesetval && xpathObj->nodesetval->nodeNr>0) {
-    		xmlXPathFreeObject(xpathObj);
-    		r->status=strdup("free");
-    		continue;
-    	}
-    	xmlXPathFreeObject(xpathObj);
-    	// check invalidName
-    	sprintf(expr,"//iris1:response/iris1:resultSet[%i]/iris1:invalidName",i);
-    	xpathObj = xmlXPathEvalExpression((const xmlChar *)expr, xpathCtx);
-    	if(xpathObj!=NULL && xpathObj->nodesetval && xpathObj->nodesetval->nodeNr>0) {
-    		xmlXPathFreeObject(xpathObj);
-    		r->status=strdup("invalid");
-    		continue;
-    	}
-    	xmlXPathFreeObject(xpathObj);
-    	// check answer/domain
-    	sprintf(expr,"//iris1:response/iris1:resultSet[%i]/iris1:answer/urn:domain",i);
-    	xpathObj = xmlXPathEvalExpression((const xmlChar *)expr, xpathCtx);
-    	if(xpathObj!=NULL && xpathObj->nodesetval && xpathObj->nodesetval->nodeNr>0) {
-    		ret=dchk_XML_ParseDomain(handle,xpathObj->nodesetval->nodeTab[0],r);
-    		xmlXPathFreeObject(xpathObj);
-    		continue;
-    	}
-    	xmlXPathFreeObject(xpathObj);
-    }
-    /* Cleanup of XPath data */
-    xmlXPathFreeContext(xpathCtx);
-	xmlFreeDoc(doc);
-
-	return 1;
-
+	int ret;
+	if (handle->response.scanned) ret=dchk_ScanResult(handle,domainset);
+	else ret=dchk_XML_WalkResultSets(handle,domainset);
+	if (ret) irislwz_ReleasePackets(handle);
+	return ret;
 }
 
 int dchk_XML_ParseSize(IRISLWZ_HANDLE *handle)
@@ -281,13 +365,9 @@ The payload of a size information looks like this:
  * \ingroup DCHK_API_DCHK
  */
 {
-	xmlDoc *doc = NULL;
-	doc = xmlReadMemory (handle->response.uncompressed_payload,
-			handle->response.size_uncompressed, NULL, NULL, 0);
-	if (doc == NULL) {
-		irislwz_SetError(handle,74014,NULL);
-		return 0;
-	}
+	if (handle->response.scanned) return dchk_ScanSize(handle);
+	xmlDoc *doc = dchk_XML_GetDocument(handle);
+	if (doc == NULL) return 0;
 	/* TODO: I wanted to use XPath to capture the octets value, but for some reason
 	 * it didn't work. xmlXPathEvalExpression returned a value, but the nodesetval
 	 * always pointed to NULL.
@@ -307,9 +387,7 @@ The payload of a size information looks like this:
 						if (node3->type==XML_ELEMENT_NODE && strcmp((char*)node3->name,"octets")==0) {
 							for (node4 = node3->children; node4; node4 = node4->next) {
 								if (node4->type==XML_TEXT_NODE) {
-									int octets=atoi((char*)node4->content);
-									xmlFreeDoc(doc);
-									return octets;
+									return atoi((char*)node4->content);
 								}
 							}
 						}
@@ -318,11 +396,32 @@ The payload of a size information looks like this:
 			}
 		}
 	}
-	xmlFreeDoc(doc);
 	irislwz_SetError(handle,74041,NULL);
 	return 0;
 }
 
+static int dchk_XML_SetOtherError(IRISLWZ_HANDLE *handle, const char *type, const char *desc)
+/*!\brief Set the error code for the type of an other information
+ *
+ * \internal
+ */
+{
+	if (!type) {
+		irislwz_SetError(handle,74053,NULL);
+		return 0;
+	}
+	if (strcasecmp(type,"descriptor-error")==0) irislwz_SetError(handle,74048,desc);
+	else if (strcasecmp(type,"payload-error")==0) irislwz_SetError(handle,74049,desc);
+	else if (strcasecmp(type,"system-error")==0) irislwz_SetError(handle,74050,desc);
+	else if (strcasecmp(type,"authority-error")==0) irislwz_SetError(handle,74051,desc);
+	else if (strcasecmp(type,"no-inflation-support-error")==0) irislwz_SetError(handle,74052,desc);
+	else {
+		irislwz_SetError(handle,74053,NULL);
+		return 0;
+	}
+	return 1;
+}
+
 int dchk_XML_ParseOther(IRISLWZ_HANDLE *handle)
 /*!\brief Parse other information
  *
@@ -388,13 +487,13 @@ types:
  * \ingroup DCHK_API_DCHK
  */
 {
-	xmlDoc *doc = NULL;
-	doc = xmlReadMemory (handle->response.uncompressed_payload,
-			handle->response.size_uncompressed, NULL, NULL, 0);
-	if (doc == NULL) {
-		irislwz_SetError(handle,74014,NULL);
-		return 0;
+	if (handle->response.scanned) {
+		char type[64], desc[1024];
+		if (!dchk_ScanOther(handle,type,sizeof(type),desc,sizeof(desc))) return 0;
+		return dchk_XML_SetOtherError(handle,type,desc);
 	}
+	xmlDoc *doc = dchk_XML_GetDocument(handle);
+	if (doc == NULL) return 0;
 	char *type=NULL;
 	char *desc=NULL;
 	xmlNode *node1, *node2, *node3 = NULL;
@@ -430,18 +529,7 @@ types:
 			break;
 		}
 	}
-	if (strcasecmp(type,"descriptor-error")==0) irislwz_SetError(handle,74048,desc);
-	else if (strcasecmp(type,"payload-error")==0) irislwz_SetError(handle,74049,desc);
-	else if (strcasecmp(type,"system-error")==0) irislwz_SetError(handle,74050,desc);
-	else if (strcasecmp(type,"authority-error")==0) irislwz_SetError(handle,74051,desc);
-	else if (strcasecmp(type,"no-inflation-support-error")==0) irislwz_SetError(handle,74052,desc);
-	else {
-		xmlFreeDoc(doc);
-		irislwz_SetError(handle,74053,NULL);
-		return 0;
-	}
-	xmlFreeDoc(doc);
-	return 1;
+	return dchk_XML_SetOtherError(handle,type,desc);
 }
 
 int dchk_XML_ParseDomain(IRISLWZ_HANDLE *handle, void *node, DCHK_RECORD *r)
@@ -0,0 +1,70 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#include <stdio.h>
+
+#include "dchk.h"
+#include "tests.h"
+
+/*
+ * Unit tests of the parts of the library, which don't need a DCHK server or DNS. They are
+ * run by "make check", the exit code is 0 if all tests passed.
+ */
+
+typedef struct {
+	const char *name;
+	int (*run)();
+} DCHK_TEST;
+
+static DCHK_TEST tests[]={
+	{"RFC 2782 weighted server selection",test_Pool},
+	{"RFC 3492 Punycode sample strings",test_IDNA},
+	{"Longest suffix match of routing tables",test_Routes},
+	{"Discovery cache file round trip",test_DNSCache},
+	{"Scanner and libxml2 give the same results",test_Scanner},
+	{"Inflate limit with a grown buffer",test_Codec},
+	{NULL,NULL}
+};
+
+int main(int argc, char **argv)
+{
+	int i, failed, total=0;
+	for (i=0;tests[i].name;i++) {
+		printf("%s\n",tests[i].name);
+		failed=tests[i].run();
+		printf("  %s\n",failed ? "FAILED" : "ok");
+		total+=failed;
+	}
+	if (total) {
+		printf("%i checks failed\n",total);
+		return 1;
+	}
+	printf("All tests passed\n");
+	return 0;
+}
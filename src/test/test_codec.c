@@ -0,0 +1,94 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <windows.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+    #include <sys/socket.h>
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+#include "tests.h"
+
+#define TEST_CODEC_SIZE		(1024*1024)
+
+static int test_Codec_Inflate(IRISLWZ_HANDLE *handle, char *compressed, int size)
+/*!\brief Inflates a compressed payload like a received answer
+ */
+{
+	IRISLWZ_PACKET response;
+	memset(&response,0,sizeof(response));
+	response.payload=compressed;
+	response.size_payload=size;
+	if (!irislwz_Inflate(handle,&response)) return -1;
+	return response.size_uncompressed;
+}
+
+int test_Codec()
+{
+	int rfc1950, size, ret, failed=0;
+	char *plain=(char*)malloc(TEST_CODEC_SIZE);
+	char *compressed=(char*)malloc(TEST_CODEC_SIZE);
+	IRISLWZ_HANDLE handle;
+	irislwz_Init(&handle);
+	memset(plain,'a',TEST_CODEC_SIZE);
+	for (rfc1950=0;rfc1950<2;rfc1950++) {
+		handle.rfc1950_workaround=rfc1950;
+		size=TEST_CODEC_SIZE;
+		ret=irislwz_Deflate(&handle,compressed,&size,plain,TEST_CODEC_SIZE);
+		DCHK_CHECK(ret==1,"RFC 1950 %i: deflate failed with %i",rfc1950,handle.error);
+		if (!ret) continue;
+		// Without a limit the buffer of the handle grows to the full size
+		irislwz_SetMaxInflateRatio(&handle,0);
+		ret=test_Codec_Inflate(&handle,compressed,size);
+		DCHK_CHECK(ret==TEST_CODEC_SIZE,"RFC 1950 %i: inflated %i bytes, error %i",rfc1950,ret,handle.error);
+		DCHK_CHECK(ret<0 || memcmp(handle.inflatebuffer,plain,TEST_CODEC_SIZE)==0,
+			"RFC 1950 %i: inflated data differs",rfc1950);
+		// The big buffer must not let the same answer pass a low ratio
+		irislwz_SetMaxInflateRatio(&handle,10);
+		ret=test_Codec_Inflate(&handle,compressed,size);
+		DCHK_CHECK(ret==-1 && handle.error==74068,"RFC 1950 %i: ratio 10 returned %i, error %i",
+			rfc1950,ret,handle.error);
+	}
+	irislwz_Exit(&handle);
+	free(plain);
+	free(compressed);
+	return failed;
+}
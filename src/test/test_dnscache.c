@@ -0,0 +1,154 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+#include <time.h>
+#ifdef HAVE_SYS_STAT_H
+	#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <Ws2tcpip.h>
+	#include <windows.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+    #include <sys/socket.h>
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+#include "tests.h"
+
+#define TEST_DNSCACHE_FILE1		"dchktest1.cache"
+#define TEST_DNSCACHE_FILE2		"dchktest2.cache"
+
+static char *test_DNSCache_Read(const char *filename)
+/*
+ * Returns the content of a file, which must be freed, or NULL.
+ */
+{
+	FILE *fp=fopen(filename,"rb");
+	if (!fp) return NULL;
+	char *buffer=(char*)calloc(1,65536);
+	if (buffer) fread(buffer,1,65535,fp);
+	fclose(fp);
+	return buffer;
+}
+
+static int test_DNSCache_Write(const char *filename, const char *content)
+{
+	FILE *fp=fopen(filename,"wb");
+	if (!fp) return 0;
+	fputs(content,fp);
+	fclose(fp);
+	return 1;
+}
+
+int test_DNSCache()
+{
+	int port, priority, weight, failed=0;
+	const char *host;
+	const struct sockaddr_storage *addr;
+	const int *addrlen;
+	char *file1, *file2, line[512];
+	IRISLWZ_HANDLE handle, loaded;
+	irislwz_Init(&handle);
+	irislwz_Init(&loaded);
+	DCHK_DNSCACHE *cache=dchk_NewDNSCache();
+	DCHK_DNSCACHE *copy=dchk_NewDNSCache();
+
+	// Servers found for "de", a TLD without DCHK server and a temporary error
+	irislwz_AddServer(&handle,"192.0.2.10",4343,10,20);
+	irislwz_AddServer(&handle,"2001:db8::10",4344,20,0);
+	dchk_CacheServers(&handle,cache,"de","_dchk._udp.de.",3600);
+	handle.error=74004;
+	dchk_CacheFailure(&handle,cache,"xx");
+	handle.error=74020;
+	dchk_CacheFailure(&handle,cache,"tmp");
+
+	// Save, load and save again must give the same file
+	DCHK_CHECK(dchk_SaveDNSCache(&handle,cache,TEST_DNSCACHE_FILE1),"save failed with %i",handle.error);
+	DCHK_CHECK(dchk_LoadDNSCache(&loaded,copy,TEST_DNSCACHE_FILE1),"load failed with %i",loaded.error);
+	DCHK_CHECK(dchk_SaveDNSCache(&loaded,copy,TEST_DNSCACHE_FILE2),"second save failed with %i",loaded.error);
+	file1=test_DNSCache_Read(TEST_DNSCACHE_FILE1);
+	file2=test_DNSCache_Read(TEST_DNSCACHE_FILE2);
+	DCHK_CHECK(file1 && file2 && strcmp(file1,file2)==0,"files differ:\n%s\n%s",file1,file2);
+	DCHK_CHECK(file1 && strstr(file1,"server 192.0.2.10 4343 10 20 192.0.2.10\n")!=NULL,"IPv4 server missing");
+	DCHK_CHECK(file1 && strstr(file1,"server 2001:db8::10 4344 20 0 2001:db8::10\n")!=NULL,"IPv6 server missing");
+	DCHK_CHECK(file1 && strstr(file1,"tld tmp ")==NULL,"temporary error was cached");
+	if (file1) free(file1);
+	if (file2) free(file2);
+
+#ifndef _WIN32
+	// A new file gets the permissions allowed by the umask, saving keeps the permissions of
+	// the existing file
+	struct stat st;
+	mode_t mask=umask(0);
+	umask(mask);
+	DCHK_CHECK(stat(TEST_DNSCACHE_FILE1,&st)==0 && (st.st_mode&07777)==(0666&~mask),"new file mode %o",(unsigned int)(st.st_mode&07777));
+	chmod(TEST_DNSCACHE_FILE1,0644);
+	DCHK_CHECK(dchk_SaveDNSCache(&handle,cache,TEST_DNSCACHE_FILE1),"save failed with %i",handle.error);
+	DCHK_CHECK(stat(TEST_DNSCACHE_FILE1,&st)==0 && (st.st_mode&07777)==0644,"mode %o",(unsigned int)(st.st_mode&07777));
+#endif
+
+	// The loaded cache fills the server pool with the resolved addresses
+	DCHK_CHECK(dchk_GetCachedServers(&loaded,copy,"de")==1,"de not cached");
+	DCHK_CHECK(irislwz_GetServerCount(&loaded)==2,"%i servers",irislwz_GetServerCount(&loaded));
+	DCHK_CHECK(irislwz_GetServer(&loaded,0,&host,&port,&priority,&weight)
+		&& strcmp(host,"192.0.2.10")==0 && port==4343 && priority==10 && weight==20,"first server");
+	DCHK_CHECK(irislwz_GetServer(&loaded,1,&host,&port,&priority,&weight)
+		&& strcmp(host,"2001:db8::10")==0 && port==4344 && priority==20 && weight==0,"second server");
+	DCHK_CHECK(irislwz_GetServerAddresses(&loaded,1,&addr,&addrlen)==1 && addr[0].ss_family==AF_INET6,"IPv6 address");
+	DCHK_CHECK(dchk_GetCachedServers(&loaded,copy,"xx")==0 && loaded.error==74004,"failure of xx, error %i",loaded.error);
+	DCHK_CHECK(dchk_GetCachedServers(&loaded,copy,"tmp")==-1,"tmp is cached");
+
+	// Expired entries are skipped, invalid lines are rejected, a missing file is no error
+	sprintf(line,"tld old %ld 0 _dchk._udp.old.\nserver 192.0.2.1 4343 0 0 -\n",(long)time(NULL)-1);
+	test_DNSCache_Write(TEST_DNSCACHE_FILE2,line);
+	DCHK_CHECK(dchk_LoadDNSCache(&loaded,copy,TEST_DNSCACHE_FILE2),"load of expired entry failed");
+	DCHK_CHECK(dchk_GetCachedServers(&loaded,copy,"old")==-1,"expired entry was loaded");
+	test_DNSCache_Write(TEST_DNSCACHE_FILE2,"server 192.0.2.1 4343 0 0 -\n");
+	DCHK_CHECK(!dchk_LoadDNSCache(&loaded,copy,TEST_DNSCACHE_FILE2) && loaded.error==74109,"server without tld, error %i",loaded.error);
+	remove(TEST_DNSCACHE_FILE1);
+	remove(TEST_DNSCACHE_FILE2);
+	DCHK_CHECK(dchk_LoadDNSCache(&loaded,copy,TEST_DNSCACHE_FILE1),"missing file, error %i",loaded.error);
+
+	dchk_FreeDNSCache(cache);
+	dchk_FreeDNSCache(copy);
+	irislwz_Exit(&handle);
+	irislwz_Exit(&loaded);
+	return failed;
+}
@@ -0,0 +1,173 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+#ifdef HAVE_STRINGS_H
+	#include <strings.h>
+#endif
+
+#include "dchk.h"
+#include "tests.h"
+
+#ifdef _WIN32
+	#define strcasecmp _stricmp
+#endif
+
+typedef struct {
+	char name;
+	const char *punycode;
+	int codepoints[41];
+} TEST_IDNA_VECTOR;
+
+/*
+ * Sample strings of RFC 3492 section 7.1. (S) is left out, it contains spaces, which are not
+ * allowed in domain names. The upper case letters are mapped to lower case by dchk_ToASCII,
+ * which does not change the Punycode encoding of the other characters, so the results are
+ * compared without case.
+ */
+static TEST_IDNA_VECTOR vectors[]={
+	{'A',"egbpdaj6bu4bxfgehfvwxn",{
+			0x0644,0x064A,0x0647,0x0645,0x0627,0x0628,0x062A,0x0643,0x0644,0x0645,0x0648,0x0634,
+			0x0639,0x0631,0x0628,0x064A,0x061F,0}},
+	{'B',"ihqwcrb4cv8a8dqg056pqjye",{
+			0x4ED6,0x4EEC,0x4E3A,0x4EC0,0x4E48,0x4E0D,0x8BF4,0x4E2D,0x6587,0}},
+	{'C',"ihqwctvzc91f659drss3x8bo0yb",{
+			0x4ED6,0x5011,0x7232,0x4EC0,0x9EBD,0x4E0D,0x8AAA,0x4E2D,0x6587,0}},
+	{'D',"Proprostnemluvesky-uyb24dma41a",{
+			0x0050,0x0072,0x006F,0x010D,0x0070,0x0072,0x006F,0x0073,0x0074,0x011B,0x006E,0x0065,
+			0x006D,0x006C,0x0075,0x0076,0x00ED,0x010D,0x0065,0x0073,0x006B,0x0079,0}},
+	{'E',"4dbcagdahymbxekheh6e0a7fei0b",{
+			0x05DC,0x05DE,0x05D4,0x05D4,0x05DD,0x05E4,0x05E9,0x05D5,0x05D8,0x05DC,0x05D0,0x05DE,
+			0x05D3,0x05D1,0x05E8,0x05D9,0x05DD,0x05E2,0x05D1,0x05E8,0x05D9,0x05EA,0}},
+	{'F',"i1baa7eci9glrd9b2ae1bj0hfcgg6iyaf8o0a1dig0cd",{
+			0x092F,0x0939,0x0932,0x094B,0x0917,0x0939,0x093F,0x0928,0x094D,0x0926,0x0940,0x0915,
+			0x094D,0x092F,0x094B,0x0902,0x0928,0x0939,0x0940,0x0902,0x092C,0x094B,0x0932,0x0938,
+			0x0915,0x0924,0x0947,0x0939,0x0948,0x0902,0}},
+	{'G',"n8jok5ay5dzabd5bym9f0cm5685rrjetr6pdxa",{
+			0x306A,0x305C,0x307F,0x3093,0x306A,0x65E5,0x672C,0x8A9E,0x3092,0x8A71,0x3057,0x3066,
+			0x304F,0x308C,0x306A,0x3044,0x306E,0x304B,0}},
+	{'H',"989aomsvi5e83db1d2a355cv1e0vak1dwrv93d5xbh15a0dt30a5jpsd879ccm6fea98c",{
+			0xC138,0xACC4,0xC758,0xBAA8,0xB4E0,0xC0AC,0xB78C,0xB4E4,0xC774,0xD55C,0xAD6D,0xC5B4,
+			0xB97C,0xC774,0xD574,0xD55C,0xB2E4,0xBA74,0xC5BC,0xB9C8,0xB098,0xC88B,0xC744,0xAE4C,0}},
+	{'I',"b1abfaaepdrnnbgefbaDotcwatmq2g4l",{
+			0x043F,0x043E,0x0447,0x0435,0x043C,0x0443,0x0436,0x0435,0x043E,0x043D,0x0438,0x043D,
+			0x0435,0x0433,0x043E,0x0432,0x043E,0x0440,0x044F,0x0442,0x043F,0x043E,0x0440,0x0443,
+			0x0441,0x0441,0x043A,0x0438,0}},
+	{'J',"PorqunopuedensimplementehablarenEspaol-fmd56a",{
+			0x0050,0x006F,0x0072,0x0071,0x0075,0x00E9,0x006E,0x006F,0x0070,0x0075,0x0065,0x0064,
+			0x0065,0x006E,0x0073,0x0069,0x006D,0x0070,0x006C,0x0065,0x006D,0x0065,0x006E,0x0074,
+			0x0065,0x0068,0x0061,0x0062,0x006C,0x0061,0x0072,0x0065,0x006E,0x0045,0x0073,0x0070,
+			0x0061,0x00F1,0x006F,0x006C,0}},
+	{'K',"TisaohkhngthchnitingVit-kjcr8268qyxafd2f1b9g",{
+			0x0054,0x1EA1,0x0069,0x0073,0x0061,0x006F,0x0068,0x1ECD,0x006B,0x0068,0x00F4,0x006E,
+			0x0067,0x0074,0x0068,0x1EC3,0x0063,0x0068,0x1EC9,0x006E,0x00F3,0x0069,0x0074,0x0069,
+			0x1EBF,0x006E,0x0067,0x0056,0x0069,0x1EC7,0x0074,0}},
+	{'L',"3B-ww4c5e180e575a65lsy2b",{
+			0x0033,0x5E74,0x0042,0x7D44,0x91D1,0x516B,0x5148,0x751F,0}},
+	{'M',"-with-SUPER-MONKEYS-pc58ag80a8qai00g7n9n",{
+			0x5B89,0x5BA4,0x5948,0x7F8E,0x6075,0x002D,0x0077,0x0069,0x0074,0x0068,0x002D,0x0053,
+			0x0055,0x0050,0x0045,0x0052,0x002D,0x004D,0x004F,0x004E,0x004B,0x0045,0x0059,0x0053,0}},
+	{'N',"Hello-Another-Way--fc4qua05auwb3674vfr0b",{
+			0x0048,0x0065,0x006C,0x006C,0x006F,0x002D,0x0041,0x006E,0x006F,0x0074,0x0068,0x0065,
+			0x0072,0x002D,0x0057,0x0061,0x0079,0x002D,0x305D,0x308C,0x305E,0x308C,0x306E,0x5834,
+			0x6240,0}},
+	{'O',"2-u9tlzr9756bt3uc0v",{
+			0x3072,0x3068,0x3064,0x5C4B,0x6839,0x306E,0x4E0B,0x0032,0}},
+	{'P',"MajiKoi5-783gue6qz075azm5e",{
+			0x004D,0x0061,0x006A,0x0069,0x3067,0x004B,0x006F,0x0069,0x3059,0x308B,0x0035,0x79D2,
+			0x524D,0}},
+	{'Q',"de-jg4avhby1noc0d",{
+			0x30D1,0x30D5,0x30A3,0x30FC,0x0064,0x0065,0x30EB,0x30F3,0x30D0,0}},
+	{'R',"d9juau41awczczp",{
+			0x305D,0x306E,0x30B9,0x30D4,0x30FC,0x30C9,0x3067,0}},
+	{0,NULL,{0}}
+};
+
+static int test_IDNA_Encode(const int *codepoints, char *utf8)
+/*
+ * Converts the code points into UTF-8, returns the number of bytes.
+ */
+{
+	int c, o=0;
+	for (;*codepoints;codepoints++) {
+		c=*codepoints;
+		if (c<0x80) {
+			utf8[o++]=(char)c;
+		} else if (c<0x800) {
+			utf8[o++]=(char)(0xc0|(c>>6));
+			utf8[o++]=(char)(0x80|(c&0x3f));
+		} else {
+			utf8[o++]=(char)(0xe0|(c>>12));
+			utf8[o++]=(char)(0x80|((c>>6)&0x3f));
+			utf8[o++]=(char)(0x80|(c&0x3f));
+		}
+	}
+	utf8[o]=0;
+	return o;
+}
+
+int test_IDNA()
+{
+	int i, ok, failed=0;
+	char utf8[256], ace[254], expected[80];
+	IRISLWZ_HANDLE handle;
+	irislwz_Init(&handle);
+	for (i=0;vectors[i].name;i++) {
+		test_IDNA_Encode(vectors[i].codepoints,utf8);
+		ok=dchk_ToASCII(&handle,utf8,ace,sizeof(ace));
+		sprintf(expected,"xn--%s",vectors[i].punycode);
+		if (strlen(expected)>63) {
+			// (H) is too long for a label
+			DCHK_CHECK(!ok && handle.error==74107,"(%c) label longer than 63 characters accepted",vectors[i].name);
+			continue;
+		}
+		DCHK_CHECK(ok,"(%c) conversion failed",vectors[i].name);
+		if (ok) DCHK_CHECK(strcasecmp(ace,expected)==0,"(%c) got %s, expected %s",vectors[i].name,ace,expected);
+	}
+	// Domain names with several labels
+	ok=dchk_ToASCII(&handle,"M\xc3\x9cller.DE.",ace,sizeof(ace));
+	DCHK_CHECK(ok && strcmp(ace,"xn--mller-kva.de")==0,"M\\xc3\\x9cller.DE. -> %s",ok ? ace : "error");
+	ok=dchk_ToASCII(&handle,"www.denic.de",ace,sizeof(ace));
+	DCHK_CHECK(ok && strcmp(ace,"www.denic.de")==0,"www.denic.de -> %s",ok ? ace : "error");
+	// Invalid UTF-8, empty labels and a buffer, which is too small
+	DCHK_CHECK(!dchk_ToASCII(&handle,"m\xfcller.de",ace,sizeof(ace)),"Latin-1 accepted");
+	// Sequences, which are not allowed in XML, either
+	DCHK_CHECK(!dchk_ToASCII(&handle,"a\xe0\x80\x80.de",ace,sizeof(ace)),"overlong sequence accepted");
+	DCHK_CHECK(!dchk_ToASCII(&handle,"a\xed\xa0\x80.de",ace,sizeof(ace)),"surrogate accepted");
+	DCHK_CHECK(!dchk_ToASCII(&handle,"a\xf4\x90\x80\x80.de",ace,sizeof(ace)),"code point above U+10FFFF accepted");
+	DCHK_CHECK(!dchk_ToASCII(&handle,"a\xef\xbf\xbe.de",ace,sizeof(ace)),"U+FFFE accepted");
+	DCHK_CHECK(!dchk_ToASCII(&handle,"a\xef\xbf\xbf.de",ace,sizeof(ace)),"U+FFFF accepted");
+	DCHK_CHECK(!dchk_ToASCII(&handle,"m\xc3\xbc..de",ace,sizeof(ace)),"empty label accepted");
+	DCHK_CHECK(!dchk_ToASCII(&handle,"m\xc3\xbcller.de",ace,10),"buffer overflow");
+	irislwz_Exit(&handle);
+	return failed;
+}
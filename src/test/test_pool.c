@@ -0,0 +1,82 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+
+#include "dchk.h"
+#include "tests.h"
+
+#define TEST_POOL_ROUNDS	41000
+
+int test_Pool()
+/*
+ * Servers with the lowest priority must be selected with a probability of weight/(sum+1),
+ * the servers with weight 0 together with 1/(sum+1) (RFC 2782). Servers with a higher
+ * priority must not be selected at all.
+ */
+{
+	static const char *hosts[]={"192.0.2.1","192.0.2.2","192.0.2.3","192.0.2.4"};
+	static const int priorities[]={10,10,10,20};
+	static const int weights[]={0,10,30,100};
+	int count[4]={0,0,0,0};
+	int i, k, failed=0;
+	IRISLWZ_HANDLE handle;
+	irislwz_Init(&handle);
+	DCHK_CHECK(irislwz_SelectServer(&handle)==0 && handle.error==74067,"empty pool, error %i",handle.error);
+	for (i=0;i<4;i++) {
+		DCHK_CHECK(irislwz_AddServer(&handle,hosts[i],4343,priorities[i],weights[i]),"AddServer %s",hosts[i]);
+	}
+	DCHK_CHECK(irislwz_GetServerCount(&handle)==4,"%i servers",irislwz_GetServerCount(&handle));
+	for (i=0;i<TEST_POOL_ROUNDS;i++) {
+		if (!irislwz_SelectServer(&handle)) {
+			DCHK_CHECK(0,"SelectServer failed with %i",handle.error);
+			break;
+		}
+		for (k=0;k<4;k++) {
+			if (strcmp(handle.server,hosts[k])==0) count[k]++;
+		}
+	}
+	// Expected: 1/41, 10/41, 30/41 and 0 of all selections
+	DCHK_CHECK(count[3]==0,"server with priority 20 selected %i times",count[3]);
+	DCHK_CHECK(count[0]>500 && count[0]<1500,"weight 0 selected %i times, expected 1000",count[0]);
+	DCHK_CHECK(count[1]>9200 && count[1]<10800,"weight 10 selected %i times, expected 10000",count[1]);
+	DCHK_CHECK(count[2]>29000 && count[2]<31000,"weight 30 selected %i times, expected 30000",count[2]);
+	DCHK_CHECK(count[0]+count[1]+count[2]==TEST_POOL_ROUNDS,"%i selections",count[0]+count[1]+count[2]);
+	// When all servers of the lowest priority failed, the next priority is used
+	for (k=0;k<3;k++) {
+		for (i=0;i<TEST_POOL_ROUNDS && strcmp(handle.server,hosts[k])!=0;i++) irislwz_SelectServer(&handle);
+		irislwz_ServerFailed(&handle);
+	}
+	DCHK_CHECK(irislwz_SelectServer(&handle) && strcmp(handle.server,hosts[3])==0,"failover to %s",handle.server);
+	irislwz_Exit(&handle);
+	return failed;
+}
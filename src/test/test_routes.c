@@ -0,0 +1,149 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <windows.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+    #include <sys/socket.h>
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+#include "tests.h"
+
+#define TEST_ROUTES_NAMES	20000
+
+static const char *suffixes[]={"de","co.uk","uk","e164.arpa","9.4.e164.arpa","1.9.4.e164.arpa",
+	"com","example.com","a","b.a","xn--mller-kva.de",NULL};
+static const char *labels[]={"de","uk","co","com","example","e164","arpa","9","4","1","a","b",
+	"xde","ade","xn--mller-kva","denic","www",NULL};
+
+static int test_Routes_Naive(const char *domain)
+/*
+ * Returns the index of the longest suffix matching complete labels of \p domain, by comparing
+ * all suffixes.
+ */
+{
+	int i, best=-1, bestlen=0, len=(int)strlen(domain), slen;
+	for (i=0;suffixes[i];i++) {
+		slen=(int)strlen(suffixes[i]);
+		if (slen>len || slen<=bestlen) continue;
+		if (strcmp(domain+len-slen,suffixes[i])!=0) continue;
+		if (slen<len && domain[len-slen-1]!='.') continue;
+		best=i;
+		bestlen=slen;
+	}
+	return best;
+}
+
+static int test_Routes_Servers(DCHK_ROUTES *routes, int route, const char *host, int port)
+/*
+ * Returns 1, if the first server of the route has the given host and port.
+ */
+{
+	int ret=0, p, priority, weight;
+	const char *h;
+	IRISLWZ_HANDLE handle;
+	irislwz_Init(&handle);
+	irislwz_SetHost(&handle,"default.example",4343);
+	if (dchk_SetRouteServers(&handle,routes,route) && irislwz_GetServer(&handle,0,&h,&p,&priority,&weight)) {
+		ret=(strcmp(h,host)==0 && p==port);
+	}
+	irislwz_Exit(&handle);
+	return ret;
+}
+
+int test_Routes()
+{
+	int i, k, n, route, failed=0;
+	unsigned int seed=1;
+	char domain[256];
+	DCHK_ROUTES *routes=dchk_NewRoutes();
+	for (i=0;suffixes[i];i++) {
+		route=dchk_AddRoute(routes,suffixes[i],NULL,NULL);
+		DCHK_CHECK(route==i,"route %i of %s",route,suffixes[i]);
+	}
+	DCHK_CHECK(dchk_GetRouteCount(routes)==i,"%i routes",dchk_GetRouteCount(routes));
+	// Longest suffix, complete labels only, upper case and trailing dots
+	DCHK_CHECK(dchk_FindRoute(routes,"denic.de")==0,"denic.de");
+	DCHK_CHECK(dchk_FindRoute(routes,"DENIC.DE.")==0,"DENIC.DE.");
+	DCHK_CHECK(dchk_FindRoute(routes,"de")==0,"de");
+	DCHK_CHECK(dchk_FindRoute(routes,"xde")==-1,"xde");
+	DCHK_CHECK(dchk_FindRoute(routes,"bbc.co.uk")==1,"bbc.co.uk");
+	DCHK_CHECK(dchk_FindRoute(routes,"example.uk")==2,"example.uk");
+	DCHK_CHECK(dchk_FindRoute(routes,"xco.uk")==2,"xco.uk");
+	DCHK_CHECK(dchk_FindRoute(routes,"3.2.1.9.4.e164.arpa")==5,"3.2.1.9.4.e164.arpa");
+	DCHK_CHECK(dchk_FindRoute(routes,"3.2.9.4.e164.arpa")==4,"3.2.9.4.e164.arpa");
+	DCHK_CHECK(dchk_FindRoute(routes,"1.4.e164.arpa")==3,"1.4.e164.arpa");
+	DCHK_CHECK(dchk_FindRoute(routes,"arpa")==-1,"arpa");
+	DCHK_CHECK(dchk_FindRoute(routes,"")==-1,"empty name");
+	// Compare with all suffixes on random names built from labels, which share characters
+	// with the suffixes
+	for (i=0;i<TEST_ROUTES_NAMES;i++) {
+		domain[0]=0;
+		seed=seed*1103515245+12345;
+		n=1+(seed>>16)%5;
+		for (k=0;k<n;k++) {
+			seed=seed*1103515245+12345;
+			if (k) strcat(domain,".");
+			strcat(domain,labels[(seed>>16)%(sizeof(labels)/sizeof(char*)-1)]);
+		}
+		route=dchk_FindRoute(routes,domain);
+		k=test_Routes_Naive(domain);
+		if (route!=k) {
+			DCHK_CHECK(0,"%s: route %i, expected %i",domain,route,k);
+			break;
+		}
+	}
+	// The last route of a suffix is used, authority and servers
+	route=dchk_AddRoute(routes,"DE.","denic","[2001:db8::1]:4344,192.0.2.1");
+	DCHK_CHECK(route>=0 && dchk_FindRoute(routes,"denic.de")==route,"replaced route of de");
+	DCHK_CHECK(strcmp(dchk_GetRouteAuthority(routes,route),"denic")==0,"authority %s",dchk_GetRouteAuthority(routes,route));
+	DCHK_CHECK(strcmp(dchk_GetRouteAuthority(routes,1),"co.uk")==0,"authority %s",dchk_GetRouteAuthority(routes,1));
+	DCHK_CHECK(test_Routes_Servers(routes,route,"2001:db8::1",4344),"IPv6 address with port");
+	route=dchk_AddRoute(routes,"at",NULL,"2001:db8::2");
+	DCHK_CHECK(test_Routes_Servers(routes,route,"2001:db8::2",4343),"IPv6 address without port");
+	route=dchk_AddRoute(routes,"ch",NULL,"dchk.example:4345");
+	DCHK_CHECK(test_Routes_Servers(routes,route,"dchk.example",4345),"host with port");
+	DCHK_CHECK(dchk_AddRoute(routes,"de..",NULL,NULL)<0,"empty label accepted");
+	DCHK_CHECK(dchk_AddRoute(routes,"li",NULL,"[2001:db8::1")<0,"missing bracket accepted");
+	DCHK_CHECK(dchk_AddRoute(routes,"li",NULL,"host:99999")<0,"invalid port accepted");
+	dchk_FreeRoutes(routes);
+	return failed;
+}
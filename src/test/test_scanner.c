@@ -0,0 +1,176 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifdef _MSC_VER
+#include "msvc-config.h"
+#else
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+	#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+	#include <string.h>
+#endif
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <windows.h>
+#endif
+#ifdef HAVE_SYS_SOCKET_H
+    #include <sys/socket.h>
+#endif
+
+#include "dchk.h"
+#include "compat.h"
+#include "tests.h"
+
+#define TEST_SCANNER_DOMAINS	6
+
+#define XML_HEAD	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" \
+	"<iris1:response xmlns:iris1=\"urn:ietf:params:xml:ns:iris1\">"
+#define XML_TAIL	"</iris1:response>"
+#define XML_FREE	"<iris1:resultSet><iris1:nameNotFound/></iris1:resultSet>"
+#define XML_INVALID	"<iris1:resultSet><iris1:invalidName/></iris1:resultSet>"
+#define XML_ANSWER(domain,status,update) "<iris1:resultSet><iris1:answer>" \
+	"<dchk1:domain xmlns:dchk1=\"urn:ietf:params:xml:ns:dchk1\">" \
+	"<dchk1:domainName>" domain "</dchk1:domainName>" \
+	"<dchk1:status><dchk1:" status "/></dchk1:status>" \
+	"<dchk1:lastDatabaseUpdateDateTime>" update "</dchk1:lastDatabaseUpdateDateTime>" \
+	"</dchk1:domain></iris1:answer></iris1:resultSet>"
+
+typedef struct {
+	const char *name;
+	int scan;				// 1, if the scanner must handle the answer, 0 if it must fall back
+	int wellformed;			// 1, if libxml2 must accept the answer
+	const char *locally;	// Records, which were checked locally and are not in the answer
+	const char *xml;
+} TEST_SCANNER_ANSWER;
+
+static TEST_SCANNER_ANSWER answers[]={
+	{"nameNotFound, invalidName and answers",1,1,"",
+		XML_HEAD XML_FREE XML_INVALID XML_ANSWER("a.de","active","2010-01-01T00:00:00+01:00")
+		XML_ANSWER("b.de","inactive","2011-02-03T04:05:06Z") XML_FREE XML_FREE XML_TAIL},
+	{"precedence inside a resultSet",1,1,"",
+		XML_HEAD "<iris1:resultSet><iris1:answer/><iris1:invalidName/><iris1:nameNotFound/></iris1:resultSet>"
+		"<iris1:resultSet>" XML_ANSWER("c.de","active","x") "<iris1:invalidName/></iris1:resultSet>"
+		"<iris1:resultSet><iris1:answer><iris1:other/></iris1:answer></iris1:resultSet>"
+		"<iris1:resultSet></iris1:resultSet>\n  " XML_INVALID "<iris1:bulkAnswer/>" XML_FREE XML_TAIL},
+	{"records checked locally are skipped",1,1,"145",
+		XML_HEAD XML_FREE XML_INVALID XML_ANSWER("d.de","active","2010-01-01") XML_TAIL},
+	{"fewer resultSets than domains",1,1,"0",XML_HEAD XML_FREE XML_TAIL},
+	{"default namespace and other prefixes",-1,1,"",
+		"<response xmlns=\"urn:ietf:params:xml:ns:iris1\"><resultSet><nameNotFound/></resultSet>"
+		"<x:resultSet xmlns:x=\"urn:ietf:params:xml:ns:iris1\"><x:invalidName/></x:resultSet></response>"},
+	{"comment",0,1,"",XML_HEAD "<!-- c -->" XML_FREE XML_TAIL},
+	{"CDATA section",0,1,"",
+		XML_HEAD XML_ANSWER("<![CDATA[e.de]]>","active","2010") XML_TAIL},
+	{"entity reference",0,1,"",
+		XML_HEAD XML_ANSWER("f.de","active","2010&#45;01") XML_TAIL},
+	{"undeclared prefix",0,1,"",
+		XML_HEAD "<iris2:resultSet><iris2:nameNotFound/></iris2:resultSet>" XML_FREE XML_TAIL},
+	{"overlong UTF-8 sequence",0,0,"",XML_HEAD XML_ANSWER("\xe0\x80\x80.de","active","x") XML_TAIL},
+	{"UTF-8 encoded surrogate",0,0,"",XML_HEAD XML_ANSWER("\xed\xa0\x80.de","active","x") XML_TAIL},
+	{"U+FFFF",0,0,"",XML_HEAD XML_ANSWER("\xef\xbf\xbf.de","active","x") XML_TAIL},
+	{"code point above U+10FFFF",0,0,"",XML_HEAD XML_ANSWER("\xf4\x90\x80\x80.de","active","x") XML_TAIL},
+	{NULL,0,0,NULL,NULL}
+};
+
+static DCHK_DOMAINLIST *test_Scanner_List(const char *locally)
+{
+	char name[32];
+	int i;
+	DCHK_RECORD *r;
+	DCHK_DOMAINLIST *list=dchk_NewDomainList();
+	for (i=0;i<TEST_SCANNER_DOMAINS;i++) {
+		sprintf(name,"d%i.de",i);
+		dchk_AddDomain(list,name);
+	}
+	for (i=0,r=list->first;r;i++,r=r->next) {
+		if (strchr(locally,'0'+i)) r->checkedLocally=1;
+	}
+	return list;
+}
+
+static int test_Scanner_Parse(IRISLWZ_HANDLE *handle, const char *xml, DCHK_DOMAINLIST *list, int scan)
+/*
+ * Stores the results of the answer \p xml in \p list, with the scanner if \p scan is 1 and
+ * with libxml2 otherwise. Returns 1, if the scanner accepted the answer, 0 if not and -1 if
+ * the results could not be stored.
+ */
+{
+	static IRISLWZ_HEADER header;
+	int scanned, ret;
+	irislwz_FreePacket(&handle->response);
+	handle->response.header=&header;
+	handle->response.uncompressed_payload=strdup(xml);
+	handle->response.size_uncompressed=(int)strlen(xml);
+	scanned=irislwz_ScanPacket(handle,&handle->response);
+	if (!scan) handle->response.scanned=0;
+	else if (!scanned) return 0;
+	ret=dchk_XML_ParseResult(handle,list);
+	if (!ret) return -1;
+	return scanned;
+}
+
+static int test_Scanner_Equal(const char *a, const char *b)
+{
+	if (!a || !b) return (a==b);
+	return (strcmp(a,b)==0);
+}
+
+int test_Scanner()
+{
+	int i, k, scanned, ret, failed=0;
+	DCHK_DOMAINLIST *scanner, *libxml;
+	DCHK_RECORD *s, *l;
+	IRISLWZ_HANDLE handle;
+	irislwz_Init(&handle);
+	for (i=0;answers[i].name;i++) {
+		TEST_SCANNER_ANSWER *a=&answers[i];
+		scanner=test_Scanner_List(a->locally);
+		libxml=test_Scanner_List(a->locally);
+		scanned=test_Scanner_Parse(&handle,a->xml,scanner,1);
+		ret=test_Scanner_Parse(&handle,a->xml,libxml,0);
+		if (a->scan>=0) DCHK_CHECK(scanned==a->scan,"%s: scanner returned %i",a->name,scanned);
+		if (!a->wellformed) {
+			DCHK_CHECK(ret==-1 && handle.error==74014,"%s: libxml2 returned %i, error %i",a->name,ret,handle.error);
+		} else {
+			DCHK_CHECK(ret>=0,"%s: libxml2 failed with %i",a->name,handle.error);
+		}
+		if (scanned==1 && ret>=0) {
+			for (k=0,s=scanner->first,l=libxml->first;s && l;k++,s=s->next,l=l->next) {
+				DCHK_CHECK(test_Scanner_Equal(s->status,l->status),"%s: status of record %i: %s, libxml2 %s",
+					a->name,k,s->status,l->status);
+				DCHK_CHECK(test_Scanner_Equal(s->lastdatabaseupdate,l->lastdatabaseupdate),
+					"%s: update of record %i: %s, libxml2 %s",a->name,k,s->lastdatabaseupdate,l->lastdatabaseupdate);
+			}
+		}
+		dchk_FreeDomainList(scanner);
+		dchk_FreeDomainList(libxml);
+	}
+	irislwz_Exit(&handle);
+	return failed;
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of the Domain CHecK Client (DCHK) from Patrick Fedick
+ * (http://dchk.sourceforge.net/). It can be used to check the availability
+ * of domains by using the DCHK protocol described in RFC 5144.
+ *
+ *
+ * Copyright (C) 2008-2011 Patrick Fedick <dchk@pfp.de>
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * SoftwareFoundation; either version 3 of the License, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DCHK_TESTS_H_
+#define DCHK_TESTS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Each test group returns the number of failed checks. DCHK_CHECK prints the location and
+ * a message of a failed check and counts it in the variable "failed" of the test group.
+ */
+#define DCHK_CHECK(cond, ...) do { \
+		if (!(cond)) { \
+			failed++; \
+			printf("  FAILED %s:%i: ",__FILE__,__LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\n"); \
+		} \
+	} while (0)
+
+int test_Pool();
+int test_IDNA();
+int test_Routes();
+int test_DNSCache();
+int test_Scanner();
+int test_Codec();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*DCHK_TESTS_H_*/